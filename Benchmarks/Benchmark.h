@@ -0,0 +1,210 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+///Helpers shared by the benchmark executables
+namespace Benchmarks
+{
+	using namespace std;
+
+	///High resolution stopwatch
+	class Timer
+	{
+		chrono::high_resolution_clock::time_point start;
+
+	public:
+		Timer() { Reset(); }
+
+		///Restart the timer
+		void Reset() { start = chrono::high_resolution_clock::now(); }
+
+		///Elapsed time in milliseconds
+		double Milliseconds() const
+		{
+			return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+		}
+
+		///Elapsed time in nanoseconds
+		double Nanoseconds() const
+		{
+			return chrono::duration<double, nano>(chrono::high_resolution_clock::now() - start).count();
+		}
+	};
+
+	///Summary of a set of samples
+	struct Distribution
+	{
+		double min, mean, p50, p90, p99, max, total;
+		size_t count;
+
+		Distribution() : min(0), mean(0), p50(0), p90(0), p99(0), max(0), total(0), count(0) {}
+
+		Distribution(vector<double> samples) : Distribution()
+		{
+			count = samples.size();
+			if (!count)
+				return;
+
+			sort(samples.begin(), samples.end());
+			for (size_t i = 0; i < count; i++)
+				total += samples[i];
+
+			min = samples.front();
+			max = samples.back();
+			mean = total / count;
+			p50 = Percentile(samples, .50);
+			p90 = Percentile(samples, .90);
+			p99 = Percentile(samples, .99);
+		}
+
+		///Percentile of sorted samples: the sample at p * (count - 1), rounded to the closest index (no interpolation)
+		static double Percentile(const vector<double>& sorted, double p)
+		{
+			size_t rank = (size_t)(p * (sorted.size() - 1) + .5);
+			return sorted[std::min(rank, sorted.size() - 1)];
+		}
+	};
+
+	///Minimal streaming JSON writer (objects, arrays, numbers and strings), non-finite numbers are written as null
+	class JsonWriter
+	{
+		FILE* file;
+		vector<bool> first;
+		bool key_pending;
+
+		void Separator()
+		{
+			if (key_pending)
+			{
+				key_pending = false;
+				return;
+			}
+			if (!first.empty())
+			{
+				if (!first.back())
+					fputc(',', file);
+				first.back() = false;
+				fprintf(file, "\n%*s", (int)first.size() * 2, "");
+			}
+		}
+
+		void Escaped(const string& text)
+		{
+			fputc('"', file);
+			for (size_t i = 0; i < text.size(); i++)
+			{
+				char c = text[i];
+				if ((c == '"') || (c == '\\'))
+					fputc('\\', file);
+				if ((unsigned char)c < 0x20)
+					fprintf(file, "\\u%04x", (int)(unsigned char)c);
+				else
+					fputc(c, file);
+			}
+			fputc('"', file);
+		}
+
+	public:
+		JsonWriter(FILE* _file) : file(_file), key_pending(false) {}
+
+		void BeginObject() { Separator(); fputc('{', file); first.push_back(true); }
+
+		void EndObject() { first.pop_back(); fprintf(file, "\n%*s}", (int)first.size() * 2, ""); }
+
+		void BeginArray() { Separator(); fputc('[', file); first.push_back(true); }
+
+		void EndArray() { first.pop_back(); fprintf(file, "\n%*s]", (int)first.size() * 2, ""); }
+
+		void Key(const string& name) { Separator(); Escaped(name); fputs(": ", file); key_pending = true; }
+
+		void Value(const string& value) { Separator(); Escaped(value); }
+
+		void Value(const char* value) { Value(string(value)); }
+
+		void Value(double value)
+		{
+			Separator();
+			//JSON has no inf or nan
+			if (std::isfinite(value))
+				fprintf(file, "%.6g", value);
+			else
+				fputs("null", file);
+		}
+
+		void Value(unsigned long long value) { Separator(); fprintf(file, "%llu", value); }
+
+		void Value(unsigned long value) { Value((unsigned long long)value); }
+
+		void Value(unsigned int value) { Value((unsigned long long)value); }
+
+		void Value(int value) { Separator(); fprintf(file, "%d", value); }
+
+		void Value(bool value) { Separator(); fputs(value ? "true" : "false", file); }
+
+		template<class T>
+		void Field(const string& name, T value) { Key(name); Value(value); }
+
+		void Field(const string& name, const Distribution& d)
+		{
+			Key(name);
+			BeginObject();
+			Field("min", d.min);
+			Field("mean", d.mean);
+			Field("p50", d.p50);
+			Field("p90", d.p90);
+			Field("p99", d.p99);
+			Field("max", d.max);
+			Field("total", d.total);
+			Field("count", d.count);
+			EndObject();
+		}
+
+		///Finish the document
+		void End() { fputc('\n', file); fflush(file); }
+	};
+
+	///Command line options of the form --name value
+	class Options
+	{
+		vector<string> args;
+
+	public:
+		Options(int argc, char** argv) : args(argv + 1, argv + argc) {}
+
+		///Is the flag present
+		bool Has(const string& name) const
+		{
+			return find(args.begin(), args.end(), "--" + name) != args.end();
+		}
+
+		///Get a string value or the default
+		string String(const string& name, const string& default_value="") const
+		{
+			for (size_t i = 0; i + 1 < args.size(); i++)
+				if (args[i] == "--" + name)
+					return args[i + 1];
+			return default_value;
+		}
+
+		///Get an integer value or the default
+		long Int(const string& name, long default_value) const
+		{
+			string value = String(name);
+			return value.empty() ? default_value : strtol(value.c_str(), 0, 10);
+		}
+
+		///Get a floating point value or the default
+		double Real(const string& name, double default_value) const
+		{
+			string value = String(name);
+			return value.empty() ? default_value : strtod(value.c_str(), 0);
+		}
+	};
+}
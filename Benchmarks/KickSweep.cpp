@@ -0,0 +1,499 @@
+#include "Benchmark.h"
+#include "MyPhysicsEngine.h"
+#include "SceneLoader.h"
+#include "SceneFarm.h"
+#include <iostream>
+#include <random>
+
+///Headless sweep of the swing-joint kick (F1 in Tutorial 2) over its parameters
+///
+///Usage: "Kick Sweep" [--velocity 100] [--angle 45] [--ball_x 0] [--ball_z 0] [--ball_yaw 0] [--restitution 0.828]
+///                    [--friction 1] [--samples 0] [--seed 1] [--threads 0] [--batch 0] [--max_time 6]
+///                    [--scene "../Tutorial 2/Scenes/pitch.scene"] [--table kicks.csv] [--tag name] [--output summary.json]
+///
+///Every parameter is a value, "min:max" or "min:max:count". Without --samples the trials are the grid of all
+///combinations (count values from min to max, 2 when the count is missing), with --samples N they are N random
+///samples drawn uniformly from the ranges. velocity is the drive velocity of the swing joint, angle the
+///starting angle of the truncheon in degrees, ball_x/ball_z/ball_yaw move and turn the ball from its spawn point,
+///restitution and friction (a factor of the friction of its material in the scene file) set the ball material.
+///
+///The trials run in a SceneFarm on all cores, which also loads the scenes of the next trials; a trial stops as
+///soon as the ball enters the goal, the in-goal area or the out of play zones, comes to rest, or after max_time
+///seconds. Every trial is a row of the table, the outcome counts and the throughput go to the JSON summary.
+namespace Benchmarks
+{
+	using namespace PhysicsEngine;
+
+	///Swept parameters
+	struct Parameter
+	{
+		enum Enum
+		{
+			VELOCITY,
+			ANGLE,
+			BALL_X,
+			BALL_Z,
+			BALL_YAW,
+			RESTITUTION,
+			FRICTION,
+			COUNT
+		};
+	};
+
+	static const char* parameter_names[Parameter::COUNT] = { "velocity", "angle", "ball_x", "ball_z", "ball_yaw", "restitution", "friction" };
+	static const char* parameter_defaults[Parameter::COUNT] = { "100", "45", "0", "0", "0", "0.828", "1" };
+
+	///Range of a parameter, parsed from "value", "min:max" or "min:max:count"
+	struct Range
+	{
+		PxReal min, max;
+		PxU32 count;
+
+		Range(const string& text) : count(1)
+		{
+			char* end = 0;
+			min = max = (PxReal)strtod(text.c_str(), &end);
+			if (*end == ':')
+			{
+				max = (PxReal)strtod(end + 1, &end);
+				count = 2;
+				if (*end == ':')
+					count = PxMax((PxU32)strtol(end + 1, &end, 10), 1u);
+			}
+			if (*end)
+				throw new Exception("Range, could not read \"" + text + "\".");
+		}
+
+		PxReal Value(PxU32 index) const
+		{
+			return (count > 1) ? min + (max - min)*index/(count - 1) : min;
+		}
+	};
+
+	struct Trial
+	{
+		PxU32 index;
+		PxReal values[Parameter::COUNT];
+	};
+
+	struct Outcome
+	{
+		enum Enum
+		{
+			//the ball entered the goal zone, between the posts and over the crossbar
+			GOAL,
+			//landed in the in-goal area without scoring
+			IN_GOAL,
+			//left the field of play
+			OUT,
+			//came to rest on the field
+			SHORT,
+			//came to rest where it was spawned, the truncheon missed it
+			MISS,
+			//still moving after max_time
+			TIMEOUT,
+			COUNT
+		};
+	};
+
+	static const char* outcome_names[Outcome::COUNT] = { "goal", "in_goal", "out", "short", "miss", "timeout" };
+
+	struct KickResult
+	{
+		Outcome::Enum outcome;
+		PxU32 steps;
+		PxReal max_height;
+		PxU32 crossbar_hits, post_hits;
+		PxVec3 position;
+	};
+
+	///The kick of MyScene, loaded from a scene file with the layout of the pitch (Scenes/pitch.scene by default)
+	///
+	///The named actors of the file are used: the ball, the truncheon and the swing_top_bar it swings from, the
+	///goal_zone, the in-goal areas try_zone_0, try_zone_1... and the out of play zones out_zone_0, out_zone_1...
+	///The cloth and the heightfields are skipped, they do not change the outcome before it is decided. The swept
+	///pose and material are applied after the load and the swing joint is driven from the first step, like F1
+	///pressed at the start.
+	class KickScene : public Scene
+	{
+		Trial trial;
+		string scene_file;
+		PxU32 max_steps;
+		SceneLoader loader;
+		RevoluteJoint* swing;
+		PxMaterial* ball_material;
+		Actor* ball;
+		PxActor* goal_zone;
+		std::vector<PxActor*> try_zones, out_zones;
+		PxVec3 spawn;
+		//steps simulated, and steps in a row with the ball at rest
+		PxU32 step, rest_steps;
+		bool decided;
+		KickResult result;
+
+		Actor* Named(const string& name)
+		{
+			Actor* actor = loader.Find(name);
+			if (!actor)
+				throw new Exception("KickScene::CustomInit, " + scene_file + " has no actor " + name + ".");
+			return actor;
+		}
+
+		//actors named prefix0, prefix1... up to the first missing one
+		void NamedSeries(const string& prefix, std::vector<PxActor*>& series)
+		{
+			for (PxU32 i = 0; Actor* actor = loader.Find(prefix + std::to_string(i)); i++)
+				series.push_back(actor->Get());
+		}
+
+		void Decide(Outcome::Enum outcome)
+		{
+			result.outcome = outcome;
+			result.steps = step;
+			decided = true;
+			//the following updates return right away
+			Pause(true);
+		}
+
+	public:
+		KickScene(const Trial& _trial, const string& _scene_file, PxU32 _max_steps)
+			: trial(_trial), scene_file(_scene_file), max_steps(_max_steps), loader(this), swing(0), ball_material(0), ball(0), goal_zone(0),
+			step(0), rest_steps(0), decided(false)
+		{
+			result.outcome = Outcome::TIMEOUT;
+			result.steps = 0;
+			result.max_height = 0.f;
+			result.crossbar_hits = result.post_hits = 0;
+		}
+
+		~KickScene()
+		{
+			//the joint goes before the actors released by the loader
+			if (swing)
+			{
+				swing->Get()->release();
+				delete swing;
+			}
+			loader.Clear();
+			if (ball_material)
+				ball_material->release();
+		}
+
+		const Trial& GetTrial() const { return trial; }
+
+		bool Decided() const { return decided; }
+
+		const KickResult& Result() const { return result; }
+
+		virtual void CustomInit()
+		{
+			loader.Skip("cloth");
+			loader.Skip("heightfield");
+			loader.Load(scene_file);
+
+			ball = Named("ball");
+			Actor* truncheon = Named("truncheon");
+			Actor* top_bar = Named("swing_top_bar");
+			goal_zone = Named("goal_zone")->Get();
+			NamedSeries("try_zone_", try_zones);
+			NamedSeries("out_zone_", out_zones);
+
+			const PxReal* values = trial.values;
+
+			//the ball is moved and turned from its spawn point, friction scales the friction of its material
+			PxRigidDynamic* ball_body = ball->Get()->is<PxRigidDynamic>();
+			PxTransform ball_pose = ball_body->getGlobalPose();
+			spawn = ball_pose.p + PxVec3(values[Parameter::BALL_X], 0.f, values[Parameter::BALL_Z]);
+			ball_body->setGlobalPose(PxTransform(spawn, PxQuat(values[Parameter::BALL_YAW] * PxPi / 180.f, PxVec3(0.f, 1.f, 0.f)) * ball_pose.q));
+
+			PxMaterial* material = 0;
+			ball->GetShape()->getMaterials(&material, 1);
+			ball_material = CreateMaterial(material->getStaticFriction()*values[Parameter::FRICTION],
+				material->getDynamicFriction()*values[Parameter::FRICTION], values[Parameter::RESTITUTION]);
+			ball->Material(ball_material);
+
+			//the angle replaces the rotation of the truncheon
+			PxRigidDynamic* truncheon_body = truncheon->Get()->is<PxRigidDynamic>();
+			truncheon_body->setGlobalPose(PxTransform(truncheon_body->getGlobalPose().p, PxQuat(values[Parameter::ANGLE] * PxPi / 180.f, PxVec3(-1.f, 0.f, 0.f))));
+
+			//MyScene::SwingJoint, the truncheon is spawned without gravity until it swings
+			swing = new RevoluteJoint(top_bar, PxTransform(PxVec3(0.f, 8.f, 0.f)), truncheon, PxTransform(PxVec3(0.f, 6.f, -1.f)));
+			truncheon_body->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, false);
+			swing->DriveVelocity(values[Parameter::VELOCITY]);
+		}
+
+		//decide the outcome from the events of the last step
+		virtual void CustomUpdate()
+		{
+			TriggerEvent event;
+			while (PollTrigger(event))
+			{
+				if (decided || !event.enter || (event.other_actor != ball->Get()))
+					continue;
+				if (event.trigger_actor == goal_zone)
+					Decide(Outcome::GOAL);
+				else if (std::find(try_zones.begin(), try_zones.end(), event.trigger_actor) != try_zones.end())
+					Decide(Outcome::IN_GOAL);
+				else if (std::find(out_zones.begin(), out_zones.end(), event.trigger_actor) != out_zones.end())
+					Decide(Outcome::OUT);
+			}
+
+			const ContactBuffer& contacts = GetContacts();
+			for (const ContactReport& contact : contacts)
+			{
+				if (!(contact.events & PxPairFlag::eNOTIFY_TOUCH_FOUND))
+					continue;
+				PxU32 groups = contact.shapes[0]->getSimulationFilterData().word0 | contact.shapes[1]->getSimulationFilterData().word0;
+				if (groups == (FilterGroup::BALL | FilterGroup::CROSSBAR))
+					result.crossbar_hits++;
+				else if (groups == (FilterGroup::BALL | FilterGroup::GOALPOST))
+					result.post_hits++;
+			}
+
+			PxRigidDynamic* body = ball->Get()->is<PxRigidDynamic>();
+			result.position = body->getGlobalPose().p;
+			result.max_height = PxMax(result.max_height, result.position.y);
+			if (decided)
+				return;
+
+			//at rest for half a second, once the truncheon had the time to come down
+			if (body->isSleeping() || (body->getLinearVelocity().magnitudeSquared() < .01f))
+				rest_steps++;
+			else
+				rest_steps = 0;
+
+			if ((step >= 60) && (rest_steps >= 30))
+				Decide(((result.position - spawn).magnitude() < .5f) ? Outcome::MISS : Outcome::SHORT);
+			else if (step >= max_steps)
+				Decide(Outcome::TIMEOUT);
+			else
+				step++;
+		}
+	};
+
+	///All combinations of the ranges
+	vector<Trial> GridTrials(const vector<Range>& ranges)
+	{
+		PxU32 total = 1;
+		for (unsigned int p = 0; p < ranges.size(); p++)
+			total *= ranges[p].count;
+
+		vector<Trial> trials(total);
+		for (PxU32 i = 0; i < total; i++)
+		{
+			trials[i].index = i;
+			//mixed radix digits of the index, the first parameter changes slowest
+			PxU32 rest = i;
+			for (int p = (int)ranges.size() - 1; p >= 0; p--)
+			{
+				trials[i].values[p] = ranges[p].Value(rest % ranges[p].count);
+				rest /= ranges[p].count;
+			}
+		}
+		return trials;
+	}
+
+	///Random samples from the ranges
+	vector<Trial> RandomTrials(const vector<Range>& ranges, PxU32 samples, PxU32 seed)
+	{
+		std::mt19937 generator(seed);
+		vector<Trial> trials(samples);
+		for (PxU32 i = 0; i < samples; i++)
+		{
+			trials[i].index = i;
+			for (unsigned int p = 0; p < ranges.size(); p++)
+				trials[i].values[p] = std::uniform_real_distribution<PxReal>(ranges[p].min, PxMax(ranges[p].min, ranges[p].max))(generator);
+		}
+		return trials;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace Benchmarks;
+
+	Options options(argc, argv);
+	PxU32 samples = (PxU32)options.Int("samples", 0);
+	PxU32 seed = (PxU32)options.Int("seed", 1);
+	PxU32 threads = (PxU32)options.Int("threads", 0);
+	PxReal max_time = (PxReal)options.Real("max_time", 6.);
+	PxReal dt = 1.f/60.f;
+	PxU32 max_steps = (PxU32)(max_time / dt);
+	string scene_file = options.String("scene", "../Tutorial 2/Scenes/pitch.scene");
+	string table_file = options.String("table", "kicks.csv");
+	string output = options.String("output");
+
+	FILE* file = output.empty() ? stdout : fopen(output.c_str(), "w");
+	FILE* table = fopen(table_file.c_str(), "w");
+	if (!file || !table)
+	{
+		cerr << "Could not open " << (file ? table_file : output) << endl;
+		return 1;
+	}
+
+	try
+	{
+		vector<Range> ranges;
+		for (PxU32 p = 0; p < Parameter::COUNT; p++)
+			ranges.push_back(Range(options.String(parameter_names[p], parameter_defaults[p])));
+		vector<Trial> trials = samples ? RandomTrials(ranges, samples, seed) : GridTrials(ranges);
+
+		PhysicsEngine::PxInit();
+
+		SceneFarm farm(threads);
+		//enough scenes in flight to keep every thread busy while the finished ones are replaced
+		PxU32 batch = (PxU32)options.Int("batch", 0);
+		if (!batch)
+			batch = 8*farm.Threads();
+		batch = PxMin(batch, (PxU32)trials.size());
+		cerr << "Running " << trials.size() << " kicks on " << farm.Threads() << " threads..." << endl;
+
+		vector<KickResult> results(trials.size());
+		vector<KickScene*> running;
+		double setup_ms = 0.;
+		PxU32 next_trial = 0, finished = 0;
+		Timer total;
+		{
+			//the scenes are loaded on all threads of the farm
+			Timer setup;
+			for (; next_trial < batch; next_trial++)
+				running.push_back(new KickScene(trials[next_trial], scene_file, max_steps));
+			farm.Add(vector<Scene*>(running.begin(), running.end()));
+			setup_ms += setup.Milliseconds();
+		}
+
+		PxU64 simulated_steps = 0;
+		PxU32 reported = 0;
+		while (finished < trials.size())
+		{
+			farm.Step(dt);
+
+			//collect the decided trials and start the next ones in their place
+			vector<PxU32> indices;
+			vector<Scene*> next;
+			for (PxU32 i = 0; i < running.size(); i++)
+			{
+				if (!running[i] || !running[i]->Decided())
+					continue;
+
+				const KickResult& result = running[i]->Result();
+				results[running[i]->GetTrial().index] = result;
+				simulated_steps += result.steps;
+				finished++;
+
+				if (next_trial < trials.size())
+				{
+					indices.push_back(i);
+					next.push_back(new KickScene(trials[next_trial++], scene_file, max_steps));
+				}
+				//the last ones stay in the farm, paused, until the end
+				else
+					running[i] = 0;
+			}
+
+			//the new scenes are loaded side by side on the threads of the farm, not one after the other here
+			if (indices.size())
+			{
+				Timer setup;
+				vector<Scene*> replaced = farm.Replace(indices, next);
+				setup_ms += setup.Milliseconds();
+				for (PxU32 i = 0; i < indices.size(); i++)
+				{
+					delete replaced[i];
+					running[indices[i]] = (KickScene*)next[i];
+				}
+			}
+
+			if (finished / 1000 != reported)
+			{
+				reported = finished / 1000;
+				cerr << "\r" << finished << "/" << trials.size() << flush;
+			}
+		}
+		double total_ms = total.Milliseconds();
+		cerr << endl;
+
+		//the finished scenes left in the farm
+		for (PxU32 i = 0; i < farm.Count(); i++)
+			delete (KickScene*)farm.Get(i);
+		farm.Clear();
+
+		PxU32 counts[Outcome::COUNT] = {};
+		fprintf(table, "trial");
+		for (PxU32 p = 0; p < Parameter::COUNT; p++)
+			fprintf(table, ",%s", parameter_names[p]);
+		fprintf(table, ",outcome,time,max_height,crossbar_hits,post_hits,x,y,z\n");
+		for (PxU32 i = 0; i < trials.size(); i++)
+		{
+			const KickResult& result = results[i];
+			counts[result.outcome]++;
+			fprintf(table, "%u", i);
+			for (PxU32 p = 0; p < Parameter::COUNT; p++)
+				fprintf(table, ",%g", trials[i].values[p]);
+			fprintf(table, ",%s,%g,%g,%u,%u,%g,%g,%g\n", outcome_names[result.outcome], result.steps*dt, result.max_height,
+				result.crossbar_hits, result.post_hits, result.position.x, result.position.y, result.position.z);
+		}
+
+		JsonWriter json(file);
+		json.BeginObject();
+		json.Field("benchmark", "kick_sweep");
+		json.Field("tag", options.String("tag"));
+		json.Field("physx_version", (unsigned int)PX_PHYSICS_VERSION);
+#ifdef _DEBUG
+		json.Field("configuration", "debug");
+#else
+		json.Field("configuration", "release");
+#endif
+		json.Field("mode", samples ? "random" : "grid");
+		json.Field("seed", seed);
+		json.Field("scene", scene_file);
+		json.Key("parameters");
+		json.BeginObject();
+		for (PxU32 p = 0; p < Parameter::COUNT; p++)
+		{
+			json.Key(parameter_names[p]);
+			json.BeginObject();
+			json.Field("min", (double)ranges[p].min);
+			json.Field("max", (double)ranges[p].max);
+			if (!samples)
+				json.Field("count", ranges[p].count);
+			json.EndObject();
+		}
+		json.EndObject();
+		json.Field("table", table_file);
+		json.Key("outcomes");
+		json.BeginObject();
+		for (PxU32 o = 0; o < Outcome::COUNT; o++)
+			json.Field(outcome_names[o], counts[o]);
+		json.EndObject();
+		json.Key("throughput");
+		json.BeginObject();
+		json.Field("trials", (unsigned int)trials.size());
+		json.Field("threads", farm.Threads());
+		json.Field("batch", batch);
+		json.Field("dt", (double)dt);
+		json.Field("max_steps", max_steps);
+		json.Field("total_ms", total_ms);
+		json.Field("setup_ms", setup_ms);
+		json.Field("trials_per_second", total_ms > 0. ? trials.size() * 1000. / total_ms : 0.);
+		json.Field("simulated_steps", (unsigned long long)simulated_steps);
+		json.Field("steps_per_second", total_ms > 0. ? simulated_steps * 1000. / total_ms : 0.);
+		json.Field("mean_steps", trials.size() ? (double)simulated_steps / trials.size() : 0.);
+		//the share of the steps saved by stopping the decided trials
+		json.Field("early_stop_savings", trials.size() ? 1. - (double)simulated_steps / ((double)trials.size() * max_steps) : 0.);
+		json.EndObject();
+		json.EndObject();
+		json.End();
+	}
+	catch (Exception* exc)
+	{
+		cerr << exc->what() << endl;
+		return 1;
+	}
+
+	fclose(table);
+	if (file != stdout)
+		fclose(file);
+
+	return 0;
+}
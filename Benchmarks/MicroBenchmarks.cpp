@@ -0,0 +1,318 @@
+#include "Benchmark.h"
+#include "BasicActors.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <atomic>
+#include <new>
+
+///Micro benchmarks of the Actor and Scene wrapper calls
+///
+///Usage: "Micro Benchmarks" [--actors 10,100,1000,10000] [--shapes 1,8,32] [--min-time 100]
+///                          [--baseline micro_baseline.txt] [--alloc-threshold 0.01] [--save-baseline file]
+///                          [--output results.json]
+///
+///Reports ns/op, heap allocations/op (operator new) and PhysX allocations/op for each call.
+///A call regresses when its heap allocations/op grow by more than --alloc-threshold (absolute, allocations
+///per op) over the baseline. The timings depend on the machine and are reported only, never checked.
+///Returns 2 when a result regresses against the baseline.
+
+//count every heap allocation made by the process
+static std::atomic<unsigned long long> heap_allocations(0);
+
+void* operator new(size_t size)
+{
+	heap_allocations++;
+	void* ptr = malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+namespace Benchmarks
+{
+	using namespace PhysicsEngine;
+
+	///Scene with a number of dynamic actors made of a number of box shapes
+	class MicroScene : public Scene
+	{
+		PxU32 num_actors, num_shapes;
+
+	public:
+		std::vector<DynamicActor*> actors;
+
+		MicroScene(PxU32 _num_actors, PxU32 _num_shapes) : num_actors(_num_actors), num_shapes(_num_shapes) {}
+
+		~MicroScene()
+		{
+			for (unsigned int i = 0; i < actors.size(); i++)
+			{
+				PxActor* px_actor = actors[i]->Get();
+				delete actors[i];
+				px_actor->release();
+			}
+		}
+
+		virtual void CustomInit()
+		{
+			for (PxU32 i = 0; i < num_actors; i++)
+			{
+				DynamicActor* actor = new DynamicActor(PxTransform(PxVec3((PxReal)(i % 100), 1.f, (PxReal)(i / 100))));
+				for (PxU32 j = 0; j < num_shapes; j++)
+					actor->CreateShape(PxBoxGeometry(.1f, .1f, .1f), 1.f);
+				actors.push_back(actor);
+				Add(actor);
+			}
+		}
+	};
+
+	struct Result
+	{
+		string name;
+		double ns_per_op;
+		double heap_allocs_per_op;
+		double physx_allocs_per_op;
+		unsigned long long ops;
+	};
+
+	///Run op(i) in growing batches until min_ms has passed; each call of op counts as ops_per_call operations
+	template<class Op>
+	Result Measure(const string& name, double min_ms, Op op, PxU32 ops_per_call=1)
+	{
+		//warm up, grows any buffers that are reused afterwards
+		op(0);
+
+		unsigned long long calls = 0, batch = 1;
+		unsigned long long heap_start = heap_allocations;
+		size_t physx_start = GetAllocationCount();
+		Timer timer;
+		while (true)
+		{
+			for (unsigned long long i = 0; i < batch; i++)
+				op((PxU32)(calls + i));
+			calls += batch;
+			if (timer.Milliseconds() >= min_ms)
+				break;
+			batch *= 2;
+		}
+		double ns = timer.Nanoseconds();
+
+		Result result;
+		result.name = name;
+		result.ops = calls * ops_per_call;
+		result.ns_per_op = ns / result.ops;
+		result.heap_allocs_per_op = (double)(heap_allocations - heap_start) / result.ops;
+		result.physx_allocs_per_op = (double)(GetAllocationCount() - physx_start) / result.ops;
+		return result;
+	}
+
+	///Benchmark all the wrapper calls for a single scene size
+	void RunScene(PxU32 num_actors, PxU32 num_shapes, double min_ms, vector<Result>& results)
+	{
+		stringstream suffix;
+		suffix << "/actors=" << num_actors << "/shapes=" << num_shapes;
+
+		//make sure there are as many materials as actors
+		while (GetPhysics()->getNbMaterials() < num_actors)
+			CreateMaterial(.5f, .5f, .5f);
+
+		MicroScene* scene = new MicroScene(num_actors, num_shapes);
+		scene->Init();
+		std::vector<DynamicActor*>& actors = scene->actors;
+		volatile size_t sink = 0;
+
+		results.push_back(Measure("GetShape" + suffix.str(), min_ms, [&](PxU32 i) {
+			sink += (size_t)actors[i % num_actors]->GetShape(num_shapes - 1);
+		}));
+
+		results.push_back(Measure("GetShapes" + suffix.str(), min_ms, [&](PxU32 i) {
+			sink += actors[i % num_actors]->GetShapes().size();
+		}));
+
+		results.push_back(Measure("GetMaterial" + suffix.str(), min_ms, [&](PxU32 i) {
+			sink += (size_t)GetMaterial(i % num_actors);
+		}));
+
+		PxMaterial* materials[2] = { GetMaterial(0), GetMaterial(1) };
+		results.push_back(Measure("Material" + suffix.str(), min_ms, [&](PxU32 i) {
+			actors[i % num_actors]->Material(materials[i & 1]);
+		}));
+
+		results.push_back(Measure("GetAllActors" + suffix.str(), min_ms, [&](PxU32 i) {
+			sink += scene->GetAllActors().size();
+		}));
+
+		results.push_back(Measure("SelectNextActor" + suffix.str(), min_ms, [&](PxU32 i) {
+			scene->SelectNextActor();
+		}));
+
+		//build new actors shape by shape, one op per CreateShape call
+		std::vector<DynamicActor*> created;
+		results.push_back(Measure("CreateShape" + suffix.str(), min_ms, [&](PxU32 i) {
+			DynamicActor* actor = new DynamicActor(PxTransform(PxIdentity));
+			for (PxU32 j = 0; j < num_shapes; j++)
+				actor->CreateShape(PxBoxGeometry(.1f, .1f, .1f), 1.f);
+			created.push_back(actor);
+		}, num_shapes));
+
+		for (unsigned int i = 0; i < created.size(); i++)
+		{
+			PxActor* px_actor = created[i]->Get();
+			delete created[i];
+			px_actor->release();
+		}
+
+		delete scene;
+	}
+
+	///Baseline entry, a negative value means the metric is not checked
+	struct Baseline
+	{
+		double heap_allocs_per_op;
+	};
+
+	///Read a baseline file: "name heap_allocs_per_op" per line, '-' for unchecked values
+	///A name without parameters (e.g. "GetShape") applies to all sizes of that call.
+	map<string, Baseline> LoadBaseline(const string& filename)
+	{
+		map<string, Baseline> baseline;
+		ifstream file(filename.c_str());
+		string line;
+		while (getline(file, line))
+		{
+			if (line.empty() || (line[0] == '#'))
+				continue;
+
+			stringstream stream(line);
+			string name, allocs;
+			if (!(stream >> name >> allocs))
+				continue;
+
+			Baseline entry;
+			entry.heap_allocs_per_op = (allocs == "-") ? -1. : atof(allocs.c_str());
+			baseline[name] = entry;
+		}
+		return baseline;
+	}
+
+	void SaveBaseline(const string& filename, const vector<Result>& results)
+	{
+		ofstream file(filename.c_str());
+		file << "# name heap_allocs_per_op" << endl;
+		for (unsigned int i = 0; i < results.size(); i++)
+			file << results[i].name << " " << results[i].heap_allocs_per_op << endl;
+	}
+
+	///Find the baseline for a result, exact names take precedence over call names
+	const Baseline* FindBaseline(const map<string, Baseline>& baseline, const string& name)
+	{
+		map<string, Baseline>::const_iterator it = baseline.find(name);
+		if (it == baseline.end())
+			it = baseline.find(name.substr(0, name.find('/')));
+		return (it == baseline.end()) ? 0 : &it->second;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace Benchmarks;
+
+	Options options(argc, argv);
+	double min_ms = options.Real("min-time", 100.);
+	double alloc_threshold = options.Real("alloc-threshold", .01);
+	string output = options.String("output");
+
+	vector<PxU32> actor_counts, shape_counts;
+	{
+		stringstream actors(options.String("actors", "10,100,1000,10000")), shapes(options.String("shapes", "1,8,32"));
+		string value;
+		while (getline(actors, value, ','))
+			actor_counts.push_back((PxU32)atoi(value.c_str()));
+		while (getline(shapes, value, ','))
+			shape_counts.push_back((PxU32)atoi(value.c_str()));
+	}
+
+	vector<Result> results;
+
+	try
+	{
+		PhysicsEngine::PxInit();
+
+		for (unsigned int s = 0; s < shape_counts.size(); s++)
+			for (unsigned int a = 0; a < actor_counts.size(); a++)
+				RunScene(actor_counts[a], shape_counts[s], min_ms, results);
+	}
+	catch (Exception* exc)
+	{
+		cerr << exc->what() << endl;
+		return 1;
+	}
+
+	//compare against the baseline
+	map<string, Baseline> baseline;
+	if (options.Has("baseline"))
+		baseline = LoadBaseline(options.String("baseline"));
+
+	vector<string> regressions;
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		const Baseline* b = FindBaseline(baseline, r.name);
+		bool regressed = b && (b->heap_allocs_per_op >= 0.) && (r.heap_allocs_per_op > b->heap_allocs_per_op + alloc_threshold);
+		if (regressed)
+			regressions.push_back(r.name);
+
+		fprintf(stderr, "%-48s %12.1f ns/op %8.2f allocs/op %8.2f physx allocs/op%s\n", r.name.c_str(),
+			r.ns_per_op, r.heap_allocs_per_op, r.physx_allocs_per_op, regressed ? "  REGRESSION" : "");
+	}
+
+	if (options.Has("save-baseline"))
+		SaveBaseline(options.String("save-baseline"), results);
+
+	FILE* file = output.empty() ? stdout : fopen(output.c_str(), "w");
+	if (file)
+	{
+		JsonWriter json(file);
+		json.BeginObject();
+		json.Field("benchmark", "micro");
+		json.Field("tag", options.String("tag"));
+#ifdef _DEBUG
+		json.Field("configuration", "debug");
+#else
+		json.Field("configuration", "release");
+#endif
+		json.Field("alloc_threshold", alloc_threshold);
+		json.Key("results");
+		json.BeginArray();
+		for (unsigned int i = 0; i < results.size(); i++)
+		{
+			json.BeginObject();
+			json.Field("name", results[i].name);
+			json.Field("ns_per_op", results[i].ns_per_op);
+			json.Field("heap_allocs_per_op", results[i].heap_allocs_per_op);
+			json.Field("physx_allocs_per_op", results[i].physx_allocs_per_op);
+			json.Field("ops", results[i].ops);
+			json.EndObject();
+		}
+		json.EndArray();
+		json.Key("regressions");
+		json.BeginArray();
+		for (unsigned int i = 0; i < regressions.size(); i++)
+			json.Value(regressions[i]);
+		json.EndArray();
+		json.EndObject();
+		json.End();
+		if (file != stdout)
+			fclose(file);
+	}
+
+	PhysicsEngine::PxRelease();
+
+	return regressions.empty() ? 0 : 2;
+}
@@ -0,0 +1,167 @@
+#include "Benchmark.h"
+#include "BasicActors.h"
+#include "Extras/Renderer.h"
+#include <iostream>
+
+///Rendering benchmark of a large static triangle mesh
+///
+///Usage: "Render Benchmarks" [--size 708] [--frames 200] [--shadows] [--tag name] [--output results.json]
+///
+///Cooks a rolling terrain of 2*size*size triangles (1M for the default size, 32 bit indices) into a static
+///TriangleMesh and draws it with flat and smooth normals. Reports the first frame (conversion and upload
+///of the render data) and the distribution of the following frame times, measured up to glFinish.
+namespace Benchmarks
+{
+	using namespace PhysicsEngine;
+	using namespace VisualDebugger;
+
+	///Terrain grid of size x size quads of 1m, centred around the origin
+	TriangleMesh* Terrain(PxU32 size)
+	{
+		std::vector<PxVec3> verts;
+		std::vector<PxU32> trigs;
+		verts.reserve((size+1)*(size+1));
+		trigs.reserve(size*size*6);
+
+		for (PxU32 z = 0; z <= size; z++)
+			for (PxU32 x = 0; x <= size; x++)
+				verts.push_back(PxVec3((PxReal)x - size*.5f, PxSin(x*.05f)*PxCos(z*.07f)*4.f, (PxReal)z - size*.5f));
+
+		for (PxU32 z = 0; z < size; z++)
+		{
+			for (PxU32 x = 0; x < size; x++)
+			{
+				PxU32 a = z*(size+1) + x;
+				PxU32 b = a + size + 1;
+				trigs.push_back(a); trigs.push_back(b); trigs.push_back(a+1);
+				trigs.push_back(a+1); trigs.push_back(b); trigs.push_back(b+1);
+			}
+		}
+
+		return new TriangleMesh(verts, trigs);
+	}
+
+	struct Result
+	{
+		string normals;
+		double first_frame_ms;
+		Distribution frame_ms;
+	};
+
+	///Draw a single frame of the terrain seen from above
+	void Frame(PxActor* actor, PxU32 size)
+	{
+		Renderer::Start(PxVec3(0.f, size*.4f, size*.6f), PxVec3(0.f, -.6f, -1.f));
+		Renderer::Render(&actor, 1);
+		glFinish();
+	}
+
+	Result Run(PxActor* actor, PxU32 size, bool smooth, PxU32 frames)
+	{
+		Result result;
+		result.normals = smooth ? "smooth" : "flat";
+
+		//clears the cached render data, the first frame builds it again
+		Renderer::SmoothMeshNormals(smooth);
+
+		Timer timer;
+		Frame(actor, size);
+		result.first_frame_ms = timer.Milliseconds();
+
+		vector<double> samples;
+		for (PxU32 i = 0; i < frames; i++)
+		{
+			timer.Reset();
+			Frame(actor, size);
+			samples.push_back(timer.Milliseconds());
+		}
+		result.frame_ms = Distribution(samples);
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace Benchmarks;
+
+	Options options(argc, argv);
+	PxU32 size = (PxU32)options.Int("size", 708);
+	PxU32 frames = (PxU32)options.Int("frames", 200);
+	string output = options.String("output");
+
+	vector<Result> results;
+	PxU32 triangles = 0, vertices = 0;
+
+	try
+	{
+		PhysicsEngine::PxInit();
+
+		Renderer::InitWindow("Render Benchmarks", 1280, 720);
+		Renderer::Init();
+		Renderer::ShowShadows(options.Has("shadows"));
+
+		Timer timer;
+		TriangleMesh* terrain = Terrain(size);
+		double cooking_ms = timer.Milliseconds();
+
+		PxTriangleMesh* mesh = terrain->GetShape()->getGeometry().triangleMesh().triangleMesh;
+		triangles = mesh->getNbTriangles();
+		vertices = mesh->getNbVertices();
+		fprintf(stderr, "terrain: %u triangles, %u vertices, cooked in %.0f ms\n", triangles, vertices, cooking_ms);
+
+		results.push_back(Run(terrain->Get(), size, false, frames));
+		results.push_back(Run(terrain->Get(), size, true, frames));
+
+		PxActor* px_actor = terrain->Get();
+		delete terrain;
+		px_actor->release();
+	}
+	catch (Exception* exc)
+	{
+		cerr << exc->what() << endl;
+		return 1;
+	}
+
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		fprintf(stderr, "%-8s first frame %8.1f ms   frames p50 %6.2f ms  p99 %6.2f ms\n", results[i].normals.c_str(),
+			results[i].first_frame_ms, results[i].frame_ms.p50, results[i].frame_ms.p99);
+	}
+
+	FILE* file = output.empty() ? stdout : fopen(output.c_str(), "w");
+	if (file)
+	{
+		JsonWriter json(file);
+		json.BeginObject();
+		json.Field("benchmark", "render");
+		json.Field("tag", options.String("tag"));
+#ifdef _DEBUG
+		json.Field("configuration", "debug");
+#else
+		json.Field("configuration", "release");
+#endif
+		json.Field("renderer", (const char*)glGetString(GL_RENDERER));
+		json.Field("triangles", triangles);
+		json.Field("vertices", vertices);
+		json.Field("shadows", options.Has("shadows"));
+		json.Key("results");
+		json.BeginArray();
+		for (unsigned int i = 0; i < results.size(); i++)
+		{
+			json.BeginObject();
+			json.Field("normals", results[i].normals);
+			json.Field("first_frame_ms", results[i].first_frame_ms);
+			json.Field("frame_ms", results[i].frame_ms);
+			json.EndObject();
+		}
+		json.EndArray();
+		json.EndObject();
+		json.End();
+		if (file != stdout)
+			fclose(file);
+	}
+
+	PhysicsEngine::PxRelease();
+
+	return 0;
+}
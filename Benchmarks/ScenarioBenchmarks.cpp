@@ -0,0 +1,542 @@
+#include "Benchmark.h"
+#include "BasicActors.h"
+#include "BinaryScene.h"
+#include "SceneFarm.h"
+#include <iostream>
+#include <cstdio>
+
+///Headless macro benchmarks of complete scenes built from BasicActors
+///
+///Usage: "Scenario Benchmarks" [--scenario all|pyramid|knights|rugby|pitchfork] [--steps 600] [--warmup 60]
+///                             [--threads 1] [--scale 1] [--tag name] [--output results.json]
+///       "Scenario Benchmarks" --startup 100000 [--file startup.pxscene] [--threads 1] [--tag name] [--output results.json]
+///       "Scenario Benchmarks" --farm 256 [--scenario pyramid] [--steps 600] [--threads 8] [--scale 1] [--tag name]
+///                             [--output results.json]
+///
+///--startup measures the time to the first step of a scene with the given number of bodies, built with
+///the actor classes and loaded from a binary scene file (see BinaryScene) written from the same scene.
+///--farm steps the given number of copies of a scenario in a SceneFarm with 1, 2, 4... up to --threads
+///threads and writes the scene steps per second and the scaling over a single thread.
+namespace Benchmarks
+{
+	using namespace PhysicsEngine;
+
+	///Base class for the benchmark scenes
+	///Keeps track of the created actors so they can be released between the runs.
+	class BenchmarkScene : public Scene
+	{
+	protected:
+		std::vector<Actor*> actors;
+		PxU32 scale;
+		PxU32 step;
+
+		///Add an actor to the scene and remember it for the clean up
+		void Spawn(Actor* actor)
+		{
+			actors.push_back(actor);
+			Add(actor);
+		}
+
+	public:
+		BenchmarkScene(PxU32 _scale) : scale(_scale), step(0) {}
+
+		virtual ~BenchmarkScene()
+		{
+			for (unsigned int i = 0; i < actors.size(); i++)
+			{
+				PxActor* px_actor = actors[i]->Get();
+				delete actors[i];
+				px_actor->release();
+			}
+		}
+
+		///Name used in the report
+		virtual const char* Name() const = 0;
+
+		virtual void CustomUpdate()
+		{
+			step++;
+		}
+	};
+
+	///Square pyramids of 1m boxes
+	class PyramidScene : public BenchmarkScene
+	{
+	public:
+		PyramidScene(PxU32 scale) : BenchmarkScene(scale) {}
+
+		const char* Name() const { return "pyramid"; }
+
+		virtual void CustomInit()
+		{
+			Spawn(new Plane());
+
+			const PxU32 base = 16;
+			for (PxU32 s = 0; s < 4*scale; s++)
+			{
+				PxVec3 origin(0.f, 0.f, -3.f*s);
+				for (PxU32 level = 0; level < base; level++)
+				{
+					for (PxU32 i = 0; i < base-level; i++)
+					{
+						PxVec3 position = origin + PxVec3((i - (base-level-1)*.5f)*1.01f, .5f + level*1.f, 0.f);
+						Spawn(new Box(PxTransform(position)));
+					}
+				}
+			}
+		}
+	};
+
+	///A wall of stacked Knights compounds
+	class KnightsScene : public BenchmarkScene
+	{
+	public:
+		KnightsScene(PxU32 scale) : BenchmarkScene(scale) {}
+
+		const char* Name() const { return "knights"; }
+
+		virtual void CustomInit()
+		{
+			Spawn(new Plane());
+
+			//each Knights compound is 19m wide and 4m high
+			for (PxU32 row = 0; row < 2*scale; row++)
+				for (PxU32 column = 0; column < 5; column++)
+					for (PxU32 layer = 0; layer < 4; layer++)
+						Spawn(new Knights(PxTransform(PxVec3(column*20.f - 40.f, 1.f + layer*4.01f, -2.f*row))));
+		}
+	};
+
+	///Rugby balls dropped onto the plane
+	class RugbyScene : public BenchmarkScene
+	{
+	public:
+		RugbyScene(PxU32 scale) : BenchmarkScene(scale) {}
+
+		const char* Name() const { return "rugby"; }
+
+		virtual void CustomInit()
+		{
+			Spawn(new Plane());
+
+			const PxU32 count = 2000*scale;
+			const PxU32 layers = 4;
+			const PxU32 side = (PxU32)ceil(sqrt((double)count/layers));
+
+			for (PxU32 i = 0; i < count; i++)
+			{
+				PxU32 x = i % side;
+				PxU32 z = (i / side) % side;
+				PxU32 y = i / (side*side);
+				PxVec3 position((x - side*.5f)*1.5f, 2.f + y*1.5f, (z - side*.5f)*1.5f);
+				RugbyBall* ball = new RugbyBall(PxTransform(position, PxQuat(i*.7f, PxVec3(0.f, 1.f, 0.f))));
+				ball->Get()->is<PxRigidDynamic>()->setMass(0.460f);
+				Spawn(ball);
+			}
+		}
+	};
+
+	///Pitchforks fired from the centre of the pitch into the barriers
+	class PitchforkScene : public BenchmarkScene
+	{
+	public:
+		PitchforkScene(PxU32 scale) : BenchmarkScene(scale) {}
+
+		const char* Name() const { return "pitchfork"; }
+
+		virtual void CustomInit()
+		{
+			Spawn(new Plane());
+			Spawn(new InnerBarrierLines());
+			Spawn(new OuterBarrierLines());
+		}
+
+		virtual void CustomUpdate()
+		{
+			BenchmarkScene::CustomUpdate();
+
+			//fire a volley every other step, the direction sweeps around the pitch
+			if ((step % 2) || (step > 400))
+				return;
+
+			for (PxU32 i = 0; i < scale; i++)
+			{
+				PxReal angle = (step*7 + i*13) * PxPi / 180.f;
+				PxVec3 dir(-PxSin(angle), .05f, -PxCos(angle));
+				Pitchfork* fork = new Pitchfork(PxTransform(PxVec3(0.f, 3.f + i*.5f, -35.f), PxQuat(angle, PxVec3(0.f, 1.f, 0.f))));
+				fork->Get()->is<PxRigidDynamic>()->setMass(3);
+				Spawn(fork);
+				fork->Get()->is<PxRigidDynamic>()->addForce(dir*100000);
+			}
+		}
+	};
+
+	///Box fixed in place
+	class StaticBox : public StaticActor
+	{
+	public:
+		StaticBox(const PxTransform& pose, PxVec3 dimensions=PxVec3(.5f, .5f, .5f)) : StaticActor(pose)
+		{
+			CreateShape(PxBoxGeometry(dimensions));
+		}
+	};
+
+	///Static boxes, dynamic boxes and convex pyramids on a grid, built one actor at a time
+	class StartupScene : public BenchmarkScene
+	{
+		PxU32 bodies;
+
+	public:
+		StartupScene(PxU32 _bodies) : BenchmarkScene(1), bodies(_bodies) {}
+
+		const char* Name() const { return "startup_actors"; }
+
+		virtual void CustomInit()
+		{
+			Spawn(new Plane());
+
+			std::vector<PxVec3> pyramid;
+			pyramid.push_back(PxVec3(-.5f, 0.f, -.5f));
+			pyramid.push_back(PxVec3(.5f, 0.f, -.5f));
+			pyramid.push_back(PxVec3(.5f, 0.f, .5f));
+			pyramid.push_back(PxVec3(-.5f, 0.f, .5f));
+			pyramid.push_back(PxVec3(0.f, 1.f, 0.f));
+
+			//every fourth body is a static box, every fourth a pyramid, spaced so nothing touches at the start
+			const PxU32 side = (PxU32)ceil(sqrt((double)bodies));
+			for (PxU32 i = 0; i < bodies; i++)
+			{
+				PxVec3 position(((i % side) - side*.5f)*2.f, 1.f, ((i / side) - side*.5f)*2.f);
+				if ((i % 4) == 0)
+					Spawn(new StaticBox(PxTransform(position)));
+				else if ((i % 4) == 3)
+					Spawn(new ConvexMesh(pyramid, PxTransform(position)));
+				else
+					Spawn(new Box(PxTransform(position)));
+			}
+		}
+	};
+
+	///The same scene mapped from a binary scene file
+	class BinaryStartupScene : public BenchmarkScene
+	{
+		string filename;
+		BinaryScene binary;
+
+	public:
+		BinaryStartupScene(const string& _filename) : BenchmarkScene(1), filename(_filename), binary(this) {}
+
+		const char* Name() const { return "startup_binary"; }
+
+		const SceneLoadStats& Stats() const { return binary.Stats(); }
+
+		virtual void CustomInit()
+		{
+			binary.Load(filename);
+		}
+	};
+
+	///Time the Init and the first step of a scene and write them, returns the total
+	double RunStartup(BenchmarkScene* scene, JsonWriter& json, PxU32 threads, PxReal dt)
+	{
+		Timer init;
+		scene->Threads(threads);
+		scene->Init();
+		double init_ms = init.Milliseconds();
+
+		Timer step;
+		scene->Update(dt);
+		double step_ms = step.Milliseconds();
+
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+		json.Field("actors", scene->Get()->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC | PxActorTypeSelectionFlag::eRIGID_STATIC));
+#else
+		json.Field("actors", scene->Get()->getNbActors(PxActorTypeFlag::eRIGID_DYNAMIC | PxActorTypeFlag::eRIGID_STATIC));
+#endif
+		json.Field("init_ms", init_ms);
+		json.Field("first_step_ms", step_ms);
+		json.Field("time_to_first_step_ms", init_ms + step_ms);
+		return init_ms + step_ms;
+	}
+
+	///Build a scene from the actor classes, write it as a binary scene and load it again
+	void Startup(PxU32 bodies, const string& filename, JsonWriter& json, PxU32 threads, PxReal dt)
+	{
+		json.BeginObject();
+		json.Field("bodies", bodies);
+
+		cerr << "Building " << bodies << " bodies..." << endl;
+		StartupScene* actors = new StartupScene(bodies);
+		json.Key("actors");
+		json.BeginObject();
+		double actors_ms = RunStartup(actors, json, threads, dt);
+		json.EndObject();
+
+		//the conversion starts from the poses of the first step, deselected so the highlight is not saved
+		actors->ClearSelection();
+		Timer write;
+		size_t file_bytes = BinaryScene::Write(*actors, filename);
+		json.Field("write_ms", write.Milliseconds());
+		json.Field("file_bytes", file_bytes);
+		delete actors;
+
+		cerr << "Loading " << filename << "..." << endl;
+		BinaryStartupScene* binary = new BinaryStartupScene(filename);
+		json.Key("binary");
+		json.BeginObject();
+		double binary_ms = RunStartup(binary, json, threads, dt);
+		json.Field("load_ms", binary->Stats().total_ms);
+		json.Field("add_ms", binary->Stats().add_ms);
+		json.Field("load_ms_per_10k", binary->Stats().PerTenThousand());
+		json.EndObject();
+		delete binary;
+
+		json.Field("speedup", binary_ms > 0. ? actors_ms / binary_ms : 0.);
+		json.EndObject();
+	}
+
+	BenchmarkScene* CreateScene(const string& name, PxU32 scale)
+	{
+		if (name == "pyramid")
+			return new PyramidScene(scale);
+		if (name == "knights")
+			return new KnightsScene(scale);
+		if (name == "rugby")
+			return new RugbyScene(scale);
+		if (name == "pitchfork")
+			return new PitchforkScene(scale);
+		return 0;
+	}
+
+	///Step copies of a scenario in a SceneFarm with a growing number of threads
+	void Farm(const string& name, PxU32 copies, JsonWriter& json, PxU32 max_threads, PxU32 scale, PxU32 warmup, PxU32 steps, PxReal dt)
+	{
+		vector<PxU32> thread_counts;
+		for (PxU32 threads = 1; threads < max_threads; threads *= 2)
+			thread_counts.push_back(threads);
+		thread_counts.push_back(PxMax(max_threads, 1u));
+
+		json.BeginArray();
+
+		double single_thread = 0.;
+		for (unsigned int run = 0; run < thread_counts.size(); run++)
+		{
+			PxU32 threads = thread_counts[run];
+			cerr << "Running " << copies << " " << name << " scenes on " << threads << " threads..." << endl;
+
+			//every run starts from new scenes, so all of them see the same steps
+			vector<BenchmarkScene*> scenes;
+			SceneFarm* farm = new SceneFarm(threads);
+			Timer setup;
+			for (PxU32 i = 0; i < copies; i++)
+			{
+				BenchmarkScene* scene = CreateScene(name, scale);
+				if (!scene)
+					throw new Exception("Farm, unknown scenario " + name + ".");
+				scenes.push_back(scene);
+				farm->Add(scene);
+			}
+			double setup_ms = setup.Milliseconds();
+
+			farm->Step(dt, warmup);
+			farm->ResetStats();
+
+			vector<double> step_ms;
+			step_ms.reserve(steps);
+			for (PxU32 i = 0; i < steps; i++)
+			{
+				Timer timer;
+				farm->Step(dt);
+				step_ms.push_back(timer.Milliseconds());
+			}
+
+			double throughput = farm->SceneStepsPerSecond();
+			if (threads == 1)
+				single_thread = throughput;
+
+			json.BeginObject();
+			json.Field("threads", threads);
+			json.Field("scenes", copies);
+			json.Field("setup_ms", setup_ms);
+			json.Field("farm_step_ms", Distribution(step_ms));
+			json.Field("scene_steps_per_second", throughput);
+			json.Field("speedup", single_thread > 0. ? throughput / single_thread : 0.);
+			json.Field("efficiency", single_thread > 0. ? throughput / single_thread / threads : 0.);
+			json.EndObject();
+
+			//the scenes simulate on the dispatcher of the farm, they go first
+			for (unsigned int i = 0; i < scenes.size(); i++)
+				delete scenes[i];
+			delete farm;
+		}
+
+		json.EndArray();
+	}
+
+	///Run a single scenario and write its results
+	void Run(BenchmarkScene* scene, JsonWriter& json, PxU32 threads, PxU32 warmup, PxU32 steps, PxReal dt)
+	{
+		ResetPeakAllocatedBytes();
+		size_t bytes_before = GetAllocatedBytes();
+
+		Timer setup;
+		scene->Threads(threads);
+		scene->Init();
+		double setup_ms = setup.Milliseconds();
+		size_t bytes_init = GetAllocatedBytes();
+
+		for (PxU32 i = 0; i < warmup; i++)
+			scene->Update(dt);
+
+		vector<double> step_ms, pairs, touching_pairs, new_touches;
+		step_ms.reserve(steps);
+		pairs.reserve(steps);
+		touching_pairs.reserve(steps);
+		new_touches.reserve(steps);
+
+		PxSimulationStatistics stats;
+		for (PxU32 i = 0; i < steps; i++)
+		{
+			Timer timer;
+			scene->Update(dt);
+			step_ms.push_back(timer.Milliseconds());
+
+			scene->Get()->getSimulationStatistics(stats);
+			pairs.push_back(stats.nbDiscreteContactPairsTotal);
+			touching_pairs.push_back(stats.nbDiscreteContactPairsWithContacts);
+			new_touches.push_back(stats.nbNewTouches);
+		}
+
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+		PxU32 dynamic_actors = scene->Get()->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC);
+		PxU32 static_actors = scene->Get()->getNbActors(PxActorTypeSelectionFlag::eRIGID_STATIC);
+#else
+		PxU32 dynamic_actors = scene->Get()->getNbActors(PxActorTypeFlag::eRIGID_DYNAMIC);
+		PxU32 static_actors = scene->Get()->getNbActors(PxActorTypeFlag::eRIGID_STATIC);
+#endif
+		PxU32 shapes = 0;
+		for (PxU32 i = 0; i < PxGeometryType::eGEOMETRY_COUNT; i++)
+			shapes += stats.nbShapes[i];
+
+		json.BeginObject();
+		json.Field("name", scene->Name());
+		json.Field("dynamic_actors", dynamic_actors);
+		json.Field("static_actors", static_actors);
+		json.Field("shapes", shapes);
+		json.Field("setup_ms", setup_ms);
+		json.Field("step_ms", Distribution(step_ms));
+		json.Field("contact_pairs", Distribution(pairs));
+		json.Field("touching_pairs", Distribution(touching_pairs));
+		json.Field("new_touches", Distribution(new_touches));
+		json.Key("memory");
+		json.BeginObject();
+		json.Field("physx_bytes_init", bytes_init - bytes_before);
+		json.Field("physx_bytes_end", GetAllocatedBytes() - bytes_before);
+		json.Field("physx_bytes_peak", GetPeakAllocatedBytes() - bytes_before);
+		json.EndObject();
+		json.EndObject();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace Benchmarks;
+
+	Options options(argc, argv);
+	string scenario = options.String("scenario", "all");
+	PxU32 steps = (PxU32)options.Int("steps", 600);
+	PxU32 warmup = (PxU32)options.Int("warmup", 60);
+	PxU32 threads = (PxU32)options.Int("threads", 1);
+	PxU32 scale = (PxU32)options.Int("scale", 1);
+	PxReal dt = 1.f/60.f;
+	string output = options.String("output");
+	PxU32 startup = (PxU32)options.Int("startup", 0);
+	PxU32 farm = (PxU32)options.Int("farm", 0);
+
+	vector<string> names;
+	if (scenario == "all")
+	{
+		names.push_back("pyramid");
+		names.push_back("knights");
+		names.push_back("rugby");
+		names.push_back("pitchfork");
+	}
+	else
+		names.push_back(scenario);
+
+	FILE* file = output.empty() ? stdout : fopen(output.c_str(), "w");
+	if (!file)
+	{
+		cerr << "Could not open " << output << endl;
+		return 1;
+	}
+
+	try
+	{
+		PhysicsEngine::PxInit();
+
+		JsonWriter json(file);
+		json.BeginObject();
+		json.Field("benchmark", "scenarios");
+		json.Field("tag", options.String("tag"));
+		json.Field("physx_version", (unsigned int)PX_PHYSICS_VERSION);
+#ifdef _DEBUG
+		json.Field("configuration", "debug");
+#else
+		json.Field("configuration", "release");
+#endif
+		json.Field("threads", threads);
+		json.Field("steps", steps);
+		json.Field("warmup", warmup);
+		json.Field("scale", scale);
+		json.Field("dt", (double)dt);
+
+		if (startup)
+		{
+			string startup_file = options.String("file", "startup.pxscene");
+			json.Key("startup");
+			Startup(startup, startup_file, json, threads, dt);
+			remove(startup_file.c_str());
+		}
+		else if (farm)
+		{
+			json.Field("scenario", names.size() == 1 ? names[0] : string("pyramid"));
+			json.Key("farm");
+			Farm(names.size() == 1 ? names[0] : "pyramid", farm, json, threads, scale, warmup, steps, dt);
+		}
+		else
+		{
+			json.Key("scenarios");
+			json.BeginArray();
+
+			for (unsigned int i = 0; i < names.size(); i++)
+			{
+				BenchmarkScene* scene = CreateScene(names[i], scale);
+				if (!scene)
+				{
+					cerr << "Unknown scenario " << names[i] << endl;
+					continue;
+				}
+				cerr << "Running " << names[i] << "..." << endl;
+				Run(scene, json, threads, warmup, steps, dt);
+				delete scene;
+			}
+
+			json.EndArray();
+		}
+		json.EndObject();
+		json.End();
+
+		PhysicsEngine::PxRelease();
+	}
+	catch (Exception* exc)
+	{
+		cerr << exc->what() << endl;
+		return 1;
+	}
+
+	if (file != stdout)
+		fclose(file);
+
+	return 0;
+}
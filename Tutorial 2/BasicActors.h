@@ -3,6 +3,7 @@
 #include "PhysicsEngine.h"
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 
 namespace PhysicsEngine
 {
@@ -63,17 +64,11 @@ namespace PhysicsEngine
 	{
 	public:
 		//constructor
+		//the meshes of equal points are cooked once and shared (see SharedConvexMesh)
 		ConvexMesh(const std::vector<PxVec3>& verts, const PxTransform& pose=PxTransform(PxIdentity), PxReal density=1.f)
 			: DynamicActor(pose)
 		{
-			PxConvexMeshDesc mesh_desc;
-			mesh_desc.points.count = (PxU32)verts.size();
-			mesh_desc.points.stride = sizeof(PxVec3);
-			mesh_desc.points.data = &verts.front();
-			mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
-			mesh_desc.vertexLimit = 256;
-
-			CreateShape(PxConvexMeshGeometry(CookMesh(mesh_desc)), density);
+			CreateShape(PxConvexMeshGeometry(SharedConvexMesh(verts)), density);
 		}
 
 		//mesh cooking (preparation)
@@ -375,6 +370,21 @@ namespace PhysicsEngine
 		}
 	};
 
+	///Zone class: an invisible trigger box reporting the shapes that enter and leave it
+	class Zone : public StaticActor
+	{
+	public:
+		//a zone with default parameters:
+		// - pose in 0,0,0
+		// - dimensions: 1m x 1m x 1m
+		Zone(const PxTransform& pose=PxTransform(PxIdentity), PxVec3 dimensions=PxVec3(.5f, .5f, .5f))
+			: StaticActor(pose)
+		{
+			CreateShape(PxBoxGeometry(dimensions));
+			SetTrigger(true);
+		}
+	};
+
 	///The TriangleMesh class
 	class TriangleMesh : public StaticActor
 	{
@@ -408,6 +418,226 @@ namespace PhysicsEngine
 		}
 	};
 
+	///The HeightField class: static terrain sampled on a regular grid
+	class HeightField : public StaticActor
+	{
+	public:
+		//heightfield from the heights in range -1..1, row major (rows x columns), the rows run along x:
+		// - size: extents of the whole terrain along x and z, y is the height of the samples at 1
+		// - pose: position of the first sample
+		HeightField(const std::vector<PxReal>& heights, PxU32 rows, PxU32 columns, const PxVec3& size, const PxTransform& pose=PxTransform(PxIdentity))
+			: StaticActor(pose)
+		{
+			Create(heights, rows, columns, size);
+		}
+
+		//heightfield from a PGM image (8 or 16 bit) or a square 16 bit RAW file, black is -1 and white 1
+		HeightField(const std::string& filename, const PxVec3& size, const PxTransform& pose=PxTransform(PxIdentity))
+			: StaticActor(pose)
+		{
+			std::vector<PxReal> heights;
+			PxU32 rows, columns;
+			LoadImage(filename, heights, rows, columns);
+			Create(heights, rows, columns, size);
+		}
+
+		//read the heights of an image, the image x axis becomes the rows and y the columns
+		static void LoadImage(const std::string& filename, std::vector<PxReal>& heights, PxU32& rows, PxU32& columns)
+		{
+			std::ifstream file(filename.c_str(), std::ios::binary);
+			if (!file)
+				throw new Exception("HeightField::LoadImage, could not open " + filename + ".");
+
+			std::vector<PxU16> values;
+			PxU32 max_value = 65535;
+			char magic[2] = { 0, 0 };
+			file.read(magic, 2);
+
+			if ((magic[0] == 'P') && ((magic[1] == '2') || (magic[1] == '5')))
+			{
+				//header: width, height and the maximum value, separated by whitespace and comments
+				PxU32 header[3];
+				for (PxU32 i = 0; i < 3; i++)
+				{
+					file >> std::ws;
+					while (file.peek() == '#')
+					{
+						file.ignore(1 << 16, '\n');
+						file >> std::ws;
+					}
+					file >> header[i];
+				}
+				if (!file || !header[0] || !header[1] || !header[2] || (header[2] > 65535))
+					throw new Exception("HeightField::LoadImage, invalid header in " + filename + ".");
+				//a single whitespace character separates the header from the binary data
+				file.get();
+
+				rows = header[0];
+				columns = header[1];
+				max_value = header[2];
+				values.resize(rows*columns);
+				if (magic[1] == '2')
+				{
+					for (PxU32 i = 0; i < values.size(); i++)
+						file >> values[i];
+				}
+				else if (max_value < 256)
+				{
+					std::vector<PxU8> bytes(values.size());
+					file.read((char*)&bytes.front(), bytes.size());
+					for (PxU32 i = 0; i < values.size(); i++)
+						values[i] = bytes[i];
+				}
+				else
+				{
+					//16 bit PGM samples are big endian
+					std::vector<PxU8> bytes(values.size()*2);
+					file.read((char*)&bytes.front(), bytes.size());
+					for (PxU32 i = 0; i < values.size(); i++)
+						values[i] = (PxU16)((bytes[i*2] << 8) | bytes[i*2+1]);
+				}
+			}
+			else
+			{
+				//RAW: square image of 16 bit little endian samples
+				file.seekg(0, std::ios::end);
+				size_t length = (size_t)file.tellg();
+				file.seekg(0, std::ios::beg);
+				PxU32 side = (PxU32)PxSqrt((PxReal)(length/2));
+				while ((size_t)(side+1)*(side+1)*2 <= length)
+					side++;
+				if (!side || ((size_t)side*side*2 != length))
+					throw new Exception("HeightField::LoadImage, " + filename + " is not a square 16 bit RAW image.");
+
+				rows = columns = side;
+				std::vector<PxU8> bytes(length);
+				file.read((char*)&bytes.front(), bytes.size());
+				values.resize(side*side);
+				for (PxU32 i = 0; i < values.size(); i++)
+					values[i] = (PxU16)(bytes[i*2] | (bytes[i*2+1] << 8));
+			}
+
+			if (!file)
+				throw new Exception("HeightField::LoadImage, " + filename + " is truncated.");
+			if ((rows < 2) || (columns < 2))
+				throw new Exception("HeightField::LoadImage, " + filename + " needs at least 2x2 samples.");
+
+			//images are stored line by line (along x), the heightfield column by column of each row
+			heights.resize(rows*columns);
+			for (PxU32 y = 0; y < columns; y++)
+				for (PxU32 x = 0; x < rows; x++)
+					heights[x*columns + y] = PxMin((PxReal)values[y*rows + x] / max_value, 1.f)*2.f - 1.f;
+		}
+
+	private:
+		void Create(const std::vector<PxReal>& heights, PxU32 rows, PxU32 columns, const PxVec3& size)
+		{
+			if ((rows < 2) || (columns < 2) || (heights.size() != rows*columns))
+				throw new Exception("HeightField::Create, invalid number of samples.");
+
+			//heights are quantised to 16 bits, the height scale brings them back to metres
+			std::vector<PxHeightFieldSample> samples(rows*columns);
+			for (PxU32 i = 0; i < samples.size(); i++)
+			{
+				samples[i].height = (PxI16)(PxClamp(heights[i], -1.f, 1.f)*32767.f);
+				samples[i].materialIndex0 = samples[i].materialIndex1 = 0;
+			}
+
+			PxHeightFieldDesc desc;
+			desc.format = PxHeightFieldFormat::eS16_TM;
+			desc.nbRows = rows;
+			desc.nbColumns = columns;
+			desc.samples.data = &samples.front();
+			desc.samples.stride = sizeof(PxHeightFieldSample);
+
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+			PxHeightField* height_field = GetPhysics()->createHeightField(desc);
+#else
+			PxHeightField* height_field = GetCooking()->createHeightField(desc, GetPhysics()->getPhysicsInsertionCallback());
+#endif
+			if (!height_field)
+				throw new Exception("HeightField::Create, could not create the heightfield.");
+
+			CreateShape(PxHeightFieldGeometry(height_field, PxMeshGeometryFlags(), size.y/32767.f, size.x/(rows-1), size.z/(columns-1)));
+			//the shape keeps its own reference
+			height_field->release();
+		}
+	};
+
+	///The Cloth class: a grid of particles simulated by the CPU cloth solver
+	class Cloth : public Actor
+	{
+		std::vector<PxClothParticle> particles;
+		std::vector<PxU32> quads;
+		PxClothMeshDesc mesh_desc;
+
+		//the user data of the shape points at the members of a single instance
+		Cloth(const Cloth&) = delete;
+		Cloth& operator=(const Cloth&) = delete;
+
+	public:
+		//a cloth with default parameters:
+		// - pose in 0,0,0, the grid lies in the local xz plane
+		// - size: 1m x 1m split into width x height quads
+		// - the first row of particles (z = 0) is fixed
+		Cloth(const PxTransform& pose=PxTransform(PxIdentity), const PxVec2& size=PxVec2(1.f, 1.f), PxU32 width=1, PxU32 height=1, bool fix_top=true)
+		{
+			PxReal w_step = size.x/width;
+			PxReal h_step = size.y/height;
+
+			for (PxU32 j = 0; j <= height; j++)
+				for (PxU32 i = 0; i <= width; i++)
+					particles.push_back(PxClothParticle(PxVec3(w_step*i, 0.f, h_step*j), (fix_top && (j == 0)) ? 0.f : 1.f));
+
+			for (PxU32 j = 0; j < height; j++)
+			{
+				for (PxU32 i = 0; i < width; i++)
+				{
+					quads.push_back(i + j*(width+1));
+					quads.push_back(i+1 + j*(width+1));
+					quads.push_back(i+1 + (j+1)*(width+1));
+					quads.push_back(i + (j+1)*(width+1));
+				}
+			}
+
+			mesh_desc.points.data = &particles.front().pos;
+			mesh_desc.points.count = (PxU32)particles.size();
+			mesh_desc.points.stride = sizeof(PxClothParticle);
+
+			mesh_desc.invMasses.data = &particles.front().invWeight;
+			mesh_desc.invMasses.count = (PxU32)particles.size();
+			mesh_desc.invMasses.stride = sizeof(PxClothParticle);
+
+			mesh_desc.quads.data = &quads.front();
+			mesh_desc.quads.count = width*height;
+			mesh_desc.quads.stride = 4*sizeof(PxU32);
+
+			//cook the fabric (constraints between the particles) and create the cloth without the GPU flag
+			PxClothFabric* fabric = PxClothFabricCreate(*GetPhysics(), mesh_desc, PxVec3(0.f, -1.f, 0.f));
+			if (!fabric)
+				throw new Exception("Cloth::Cloth, could not create the fabric.");
+
+			actor = (PxActor*)GetPhysics()->createCloth(pose, *fabric, &particles.front(), PxClothFlags());
+			if (!actor)
+				throw new Exception("Cloth::Cloth, could not create the cloth.");
+			//the cloth keeps its own reference to the fabric (on both SDKs)
+			fabric->release();
+			//collide with the shapes of the scene
+			((PxCloth*)actor)->setClothFlag(PxClothFlag::eSCENE_COLLISION, true);
+			((PxCloth*)actor)->setSolverFrequency(120.f);
+
+			//pass the color and the quads to the renderer
+			colors.push_back(default_color);
+			actor->userData = new UserData(&colors.back(), &mesh_desc);
+			Name("");
+		}
+
+		~Cloth()
+		{
+			delete (UserData*)actor->userData;
+		}
+	};
+
 	//Distance joint with the springs switched on
 	class DistanceJoint : public Joint
 	{
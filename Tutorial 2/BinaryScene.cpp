@@ -0,0 +1,713 @@
+#include "BinaryScene.h"
+#include <fstream>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	static const char BINARY_SCENE_MAGIC[8] = "PXSCENE";
+	static const PxU32 NO_INDEX = 0xffffffff;
+
+	//the records are used in place, their layout must not depend on the compiler
+	static_assert(sizeof(BinarySceneHeader) == 96, "BinarySceneHeader layout");
+	static_assert(sizeof(BinaryMaterial) == 16, "BinaryMaterial layout");
+	static_assert(sizeof(BinaryGeometry) == 32, "BinaryGeometry layout");
+	static_assert(sizeof(BinaryBlob) == 32, "BinaryBlob layout");
+	static_assert(sizeof(BinaryShape) == 80, "BinaryShape layout");
+	static_assert(sizeof(BinaryActor) == 96, "BinaryActor layout");
+
+	static PxU64 Align(PxU64 offset)
+	{
+		return (offset + 15) & ~(PxU64)15;
+	}
+
+	///Actor wrapping an actor of a binary scene
+	///Takes over the colors of the shapes, so Actor::Color works like on the actors built in code.
+	class MappedActor : public Actor
+	{
+	public:
+		MappedActor(PxRigidActor* px_actor)
+		{
+			actor = px_actor;
+			name = px_actor->getName() ? px_actor->getName() : "";
+
+			std::vector<PxShape*> shapes = GetShapes();
+			colors.reserve(shapes.size());
+			for (unsigned int i = 0; i < shapes.size(); i++)
+				colors.push_back(*((UserData*)shapes[i]->userData)->color);
+			for (unsigned int i = 0; i < shapes.size(); i++)
+				((UserData*)shapes[i]->userData)->color = &colors[i];
+		}
+	};
+
+	BinaryScene::~BinaryScene()
+	{
+		Clear();
+	}
+
+	void BinaryScene::Load(const std::string& filename)
+	{
+		Clear();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		stats = SceneLoadStats();
+
+		Map(filename);
+		Check(filename);
+		Instantiate();
+
+		stats.total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void BinaryScene::Clear()
+	{
+		SceneWriteLock lock(*scene);
+
+		//the wrappers own only their colors, the virtual Actor destructor frees them
+		for (std::map<std::string, Actor*>::iterator it = found.begin(); it != found.end(); ++it)
+			delete it->second;
+
+		//the shapes go with the actors, then the meshes and the materials they referenced
+		for (unsigned int i = 0; i < actors.size(); i++)
+			actors[i]->release();
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			if (meshes[i])
+				meshes[i]->release();
+		for (unsigned int i = 0; i < materials.size(); i++)
+			materials[i]->release();
+
+		found.clear();
+		actors.clear();
+		meshes.clear();
+		materials.clear();
+		user_data.clear();
+		Unmap();
+	}
+
+	Actor* BinaryScene::Find(const std::string& name)
+	{
+		std::map<std::string, Actor*>::iterator it = found.find(name);
+		if (it != found.end())
+			return it->second;
+
+		PxRigidActor* px_actor = FindActor(name);
+		if (!px_actor)
+			return 0;
+
+		Actor* actor = new MappedActor(px_actor);
+		found[name] = actor;
+		return actor;
+	}
+
+	PxRigidActor* BinaryScene::FindActor(const std::string& name)
+	{
+		if (!header)
+			return 0;
+
+		const BinaryActor* actor_table = (const BinaryActor*)(data + header->actors);
+		const char* names = (const char*)(data + header->names);
+		for (PxU32 i = 0; i < header->actor_count; i++)
+			if ((actor_table[i].name != NO_INDEX) && (name == names + actor_table[i].name))
+				return (PxRigidActor*)actors[i];
+		return 0;
+	}
+
+	bool BinaryScene::IsBinary(const std::string& filename)
+	{
+		char magic[sizeof(BINARY_SCENE_MAGIC)] = {};
+		std::ifstream file(filename.c_str(), std::ios::binary);
+		file.read(magic, sizeof(magic));
+		return file && !memcmp(magic, BINARY_SCENE_MAGIC, sizeof(magic));
+	}
+
+	void BinaryScene::Map(const std::string& filename)
+	{
+		//a private (copy on write) mapping: the pages are shared with the file cache until written to
+#ifdef _WIN32
+		HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+		if (file == INVALID_HANDLE_VALUE)
+			throw new Exception("BinaryScene::Load, could not open " + filename + ".");
+		file_handle = file;
+
+		LARGE_INTEGER length;
+		if (!GetFileSizeEx(file, &length) || (length.QuadPart < (LONGLONG)sizeof(BinarySceneHeader)))
+			throw new Exception("BinaryScene::Load, " + filename + " is not a binary scene.");
+		size = (size_t)length.QuadPart;
+
+		mapping_handle = CreateFileMappingA(file, 0, PAGE_WRITECOPY, 0, 0, 0);
+		if (mapping_handle)
+			data = (PxU8*)MapViewOfFile(mapping_handle, FILE_MAP_COPY, 0, 0, 0);
+#else
+		int file = open(filename.c_str(), O_RDONLY);
+		if (file < 0)
+			throw new Exception("BinaryScene::Load, could not open " + filename + ".");
+
+		struct stat info;
+		if (fstat(file, &info) || (info.st_size < (off_t)sizeof(BinarySceneHeader)))
+		{
+			close(file);
+			throw new Exception("BinaryScene::Load, " + filename + " is not a binary scene.");
+		}
+		size = (size_t)info.st_size;
+
+		void* mapped = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+		//the mapping keeps the file open
+		close(file);
+		if (mapped != MAP_FAILED)
+			data = (PxU8*)mapped;
+#endif
+		if (!data)
+		{
+			Unmap();
+			throw new Exception("BinaryScene::Load, could not map " + filename + ".");
+		}
+		header = (const BinarySceneHeader*)data;
+	}
+
+	void BinaryScene::Unmap()
+	{
+#ifdef _WIN32
+		if (data)
+			UnmapViewOfFile(data);
+		if (mapping_handle)
+			CloseHandle(mapping_handle);
+		if (file_handle)
+			CloseHandle(file_handle);
+#else
+		if (data)
+			munmap(data, size);
+#endif
+		data = 0;
+		size = 0;
+		file_handle = mapping_handle = 0;
+		header = 0;
+	}
+
+	void BinaryScene::Check(const std::string& filename)
+	{
+		std::string error;
+		if (memcmp(header->magic, BINARY_SCENE_MAGIC, sizeof(BINARY_SCENE_MAGIC)))
+			error = "is not a binary scene";
+		else if (header->version != BINARY_SCENE_VERSION)
+			error = "has an unsupported version, convert it again";
+		else if (header->physx_version != PX_PHYSICS_VERSION)
+			error = "was cooked by another PhysX SDK, convert it again";
+		else if (header->file_size != size)
+			error = "is truncated";
+		else
+		{
+			//every table has to be aligned and inside of the file
+			const PxU64 offsets[6] = { header->materials, header->geometries, header->shapes, header->actors, header->blobs, header->names };
+			const PxU64 sizes[6] = { (PxU64)header->material_count*sizeof(BinaryMaterial), (PxU64)header->geometry_count*sizeof(BinaryGeometry),
+				(PxU64)header->shape_count*sizeof(BinaryShape), (PxU64)header->actor_count*sizeof(BinaryActor),
+				(PxU64)header->blob_count*sizeof(BinaryBlob), (PxU64)header->names_size };
+			for (PxU32 i = 0; i < 6; i++)
+				if ((offsets[i] % 16) || (offsets[i] > size) || (sizes[i] > size - offsets[i]))
+					error = "has a broken table";
+
+			if (error.empty() && header->names_size && data[header->names + header->names_size - 1])
+				error = "has a broken name table";
+
+			const BinaryBlob* blob_table = (const BinaryBlob*)(data + header->blobs);
+			for (PxU32 i = 0; error.empty() && (i < header->blob_count); i++)
+				if ((blob_table[i].offset % 16) || (blob_table[i].offset > size) || (blob_table[i].size > size - blob_table[i].offset))
+					error = "has a broken mesh";
+		}
+
+		if (error.size())
+			throw new Exception("BinaryScene::Load, " + filename + " " + error + ".");
+	}
+
+	void BinaryScene::Instantiate()
+	{
+		const BinaryMaterial* material_table = (const BinaryMaterial*)(data + header->materials);
+		const BinaryGeometry* geometry_table = (const BinaryGeometry*)(data + header->geometries);
+		BinaryShape* shape_table = (BinaryShape*)(data + header->shapes);
+		const BinaryActor* actor_table = (const BinaryActor*)(data + header->actors);
+		const BinaryBlob* blob_table = (const BinaryBlob*)(data + header->blobs);
+		const char* names = (const char*)(data + header->names);
+
+		materials.reserve(header->material_count);
+		for (PxU32 i = 0; i < header->material_count; i++)
+			materials.push_back(CreateMaterial(material_table[i].static_friction, material_table[i].dynamic_friction, material_table[i].restitution));
+
+		//the cooked meshes are read straight from the mapping
+		meshes.resize(header->blob_count, 0);
+		for (PxU32 i = 0; i < header->blob_count; i++)
+		{
+			const BinaryBlob& blob = blob_table[i];
+			PxU8* blob_data = data + blob.offset;
+			if (blob.type == PxGeometryType::eCONVEXMESH)
+			{
+				PxDefaultMemoryInputData input(blob_data, (PxU32)blob.size);
+				meshes[i] = GetPhysics()->createConvexMesh(input);
+			}
+			else if (blob.type == PxGeometryType::eTRIANGLEMESH)
+			{
+				PxDefaultMemoryInputData input(blob_data, (PxU32)blob.size);
+				meshes[i] = GetPhysics()->createTriangleMesh(input);
+			}
+			else if ((blob.type == PxGeometryType::eHEIGHTFIELD) && (blob.rows > 1) && (blob.columns > 1) &&
+				(blob.size == (PxU64)blob.rows*blob.columns*sizeof(PxHeightFieldSample)))
+			{
+				PxHeightFieldDesc desc;
+				desc.format = PxHeightFieldFormat::eS16_TM;
+				desc.nbRows = blob.rows;
+				desc.nbColumns = blob.columns;
+				desc.samples.data = blob_data;
+				desc.samples.stride = sizeof(PxHeightFieldSample);
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+				meshes[i] = GetPhysics()->createHeightField(desc);
+#else
+				meshes[i] = GetCooking()->createHeightField(desc, GetPhysics()->getPhysicsInsertionCallback());
+#endif
+			}
+			if (!meshes[i])
+				throw new Exception("BinaryScene::Load, could not create mesh " + to_string(i) + ".");
+		}
+
+		//every geometry is built once and shared by its shapes
+		std::vector<PxGeometryHolder> geometries(header->geometry_count);
+		for (PxU32 i = 0; i < header->geometry_count; i++)
+		{
+			const BinaryGeometry& geometry = geometry_table[i];
+			const PxReal* params = geometry.params;
+			PxBase* mesh = 0;
+			if (geometry.blob != NO_INDEX)
+			{
+				if ((geometry.blob >= header->blob_count) || (blob_table[geometry.blob].type != geometry.type))
+					throw new Exception("BinaryScene::Load, geometry " + to_string(i) + " refers to a wrong mesh.");
+				mesh = meshes[geometry.blob];
+			}
+
+			switch (geometry.type)
+			{
+			case PxGeometryType::eSPHERE:
+				geometries[i] = PxGeometryHolder(PxSphereGeometry(params[0]));
+				break;
+			case PxGeometryType::ePLANE:
+				geometries[i] = PxGeometryHolder(PxPlaneGeometry());
+				break;
+			case PxGeometryType::eCAPSULE:
+				geometries[i] = PxGeometryHolder(PxCapsuleGeometry(params[0], params[1]));
+				break;
+			case PxGeometryType::eBOX:
+				geometries[i] = PxGeometryHolder(PxBoxGeometry(params[0], params[1], params[2]));
+				break;
+			case PxGeometryType::eCONVEXMESH:
+				if (mesh)
+					geometries[i] = PxGeometryHolder(PxConvexMeshGeometry((PxConvexMesh*)mesh, PxMeshScale(PxVec3(params[0], params[1], params[2]), PxQuat(PxIdentity))));
+				break;
+			case PxGeometryType::eTRIANGLEMESH:
+				if (mesh)
+					geometries[i] = PxGeometryHolder(PxTriangleMeshGeometry((PxTriangleMesh*)mesh, PxMeshScale(PxVec3(params[0], params[1], params[2]), PxQuat(PxIdentity))));
+				break;
+			case PxGeometryType::eHEIGHTFIELD:
+				if (mesh)
+					geometries[i] = PxGeometryHolder(PxHeightFieldGeometry((PxHeightField*)mesh, PxMeshGeometryFlags(), params[0], params[1], params[2]));
+				break;
+			default:
+				break;
+			}
+			if (!mesh && (geometry.type >= PxGeometryType::eCONVEXMESH))
+				throw new Exception("BinaryScene::Load, geometry " + to_string(i) + " is not supported.");
+		}
+
+		//the colors stay in the mapping
+		user_data.resize(header->shape_count);
+		for (PxU32 i = 0; i < header->shape_count; i++)
+			user_data[i].color = &shape_table[i].color;
+
+		std::chrono::steady_clock::time_point split = std::chrono::steady_clock::now();
+		actors.reserve(header->actor_count);
+		for (PxU32 i = 0; i < header->actor_count; i++)
+		{
+			const BinaryActor& record = actor_table[i];
+			if ((record.first_shape > header->shape_count) || (record.shape_count > header->shape_count - record.first_shape) ||
+				((record.name != NO_INDEX) && (record.name >= header->names_size)))
+				throw new Exception("BinaryScene::Load, actor " + to_string(i) + " is broken.");
+
+			bool dynamic = (record.flags & BinaryActor::DYNAMIC) != 0;
+			PxRigidActor* actor;
+			if (dynamic)
+				actor = GetPhysics()->createRigidDynamic(record.pose);
+			else
+				actor = GetPhysics()->createRigidStatic(record.pose);
+			//kept right away, so an error in the shapes does not leak the actor
+			actors.push_back(actor);
+
+			for (PxU32 j = record.first_shape; j < record.first_shape + record.shape_count; j++)
+			{
+				const BinaryShape& shape_record = shape_table[j];
+				if ((shape_record.geometry >= header->geometry_count) || (shape_record.material >= header->material_count))
+					throw new Exception("BinaryScene::Load, shape " + to_string(j) + " is broken.");
+
+				PxShape* shape = actor->createShape(geometries[shape_record.geometry].any(), *materials[shape_record.material], PxShapeFlags((PxU8)shape_record.flags));
+				if (!shape)
+					throw new Exception("BinaryScene::Load, could not create shape " + to_string(j) + ".");
+				shape->setLocalPose(shape_record.local_pose);
+				PxFilterData filter_data;
+				filter_data.word0 = shape_record.filter[0];
+				filter_data.word1 = shape_record.filter[1];
+				filter_data.word2 = shape_record.filter[2];
+				filter_data.word3 = shape_record.filter[3];
+				shape->setSimulationFilterData(filter_data);
+				shape->userData = &user_data[j];
+			}
+
+			if (dynamic)
+			{
+				//no updateMassAndInertia, the mass properties were computed before the conversion
+				PxRigidDynamic* body = (PxRigidDynamic*)actor;
+				body->setMass(record.mass);
+				body->setMassSpaceInertiaTensor(record.inertia);
+				body->setCMassLocalPose(record.mass_pose);
+				if (record.flags & BinaryActor::KINEMATIC)
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+					body->setRigidDynamicFlag(PxRigidDynamicFlag::eKINEMATIC, true);
+#else
+					body->setRigidBodyFlag(PxRigidBodyFlag::eKINEMATIC, true);
+#endif
+			}
+			actor->setActorFlags(PxActorFlags((PxU8)record.actor_flags));
+			if (record.name != NO_INDEX)
+				actor->setName(names + record.name);
+
+			stats.shapes += record.shape_count;
+			if (((i + 1) % 10000) == 0)
+			{
+				std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+				stats.split_ms.push_back(std::chrono::duration<double, std::milli>(now - split).count());
+				split = now;
+			}
+		}
+
+		std::chrono::steady_clock::time_point add_start = std::chrono::steady_clock::now();
+		if (actors.size())
+		{
+			scene->Add(&actors.front(), (PxU32)actors.size());
+			stats.batches = 1;
+		}
+		stats.add_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - add_start).count();
+		stats.actors = header->actor_count;
+		stats.materials = header->material_count;
+	}
+
+	///Collects the tables of a binary scene, see BinaryScene::Write
+	class BinarySceneWriter
+	{
+		std::vector<BinaryMaterial> material_table;
+		std::vector<BinaryGeometry> geometry_table;
+		std::vector<BinaryShape> shape_table;
+		std::vector<BinaryActor> actor_table;
+		std::vector<BinaryBlob> blob_table;
+		std::vector<std::vector<PxU8> > blobs;
+		std::string names;
+		std::map<const PxMaterial*, PxU32> material_index;
+		//the geometries are shared when their records are equal
+		std::map<std::string, PxU32> geometry_index;
+		std::map<const PxBase*, PxU32> blob_index;
+		//cooking is deterministic, equal meshes of different actors share their blob
+		std::map<std::string, PxU32> blob_contents;
+
+		PxU32 Material(PxMaterial* material)
+		{
+			std::map<const PxMaterial*, PxU32>::iterator it = material_index.find(material);
+			if (it != material_index.end())
+				return it->second;
+
+			BinaryMaterial record;
+			memset(&record, 0, sizeof(record));
+			record.static_friction = material->getStaticFriction();
+			record.dynamic_friction = material->getDynamicFriction();
+			record.restitution = material->getRestitution();
+			material_table.push_back(record);
+			return material_index[material] = (PxU32)material_table.size() - 1;
+		}
+
+		PxU32 Blob(const PxBase* mesh, PxGeometryType::Enum type, const PxU8* bytes, size_t size, PxU32 rows=0, PxU32 columns=0)
+		{
+			std::string key((const char*)bytes, size);
+			key += std::string((const char*)&type, sizeof(type)) + to_string(rows) + "x" + to_string(columns);
+			std::map<std::string, PxU32>::iterator it = blob_contents.find(key);
+			if (it != blob_contents.end())
+				return blob_index[mesh] = it->second;
+
+			BinaryBlob record;
+			memset(&record, 0, sizeof(record));
+			record.type = type;
+			record.size = size;
+			record.rows = rows;
+			record.columns = columns;
+			blob_table.push_back(record);
+			blobs.push_back(std::vector<PxU8>(bytes, bytes + size));
+			return blob_index[mesh] = blob_contents[key] = (PxU32)blob_table.size() - 1;
+		}
+
+		//the meshes are cooked again from their vertices, PhysX does not keep the cooked data
+		PxU32 ConvexBlob(const PxConvexMesh* mesh)
+		{
+			std::map<const PxBase*, PxU32>::iterator it = blob_index.find(mesh);
+			if (it != blob_index.end())
+				return it->second;
+
+			PxConvexMeshDesc mesh_desc;
+			mesh_desc.points.count = mesh->getNbVertices();
+			mesh_desc.points.stride = sizeof(PxVec3);
+			mesh_desc.points.data = mesh->getVertices();
+			mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
+			mesh_desc.vertexLimit = 256;
+
+			PxDefaultMemoryOutputStream stream;
+			if (!GetCooking()->cookConvexMesh(mesh_desc, stream))
+				throw new Exception("BinaryScene::Write, convex cooking failed.");
+			return Blob(mesh, PxGeometryType::eCONVEXMESH, stream.getData(), stream.getSize());
+		}
+
+		PxU32 TriangleBlob(const PxTriangleMesh* mesh)
+		{
+			std::map<const PxBase*, PxU32>::iterator it = blob_index.find(mesh);
+			if (it != blob_index.end())
+				return it->second;
+
+			PxTriangleMeshDesc mesh_desc;
+			mesh_desc.points.count = mesh->getNbVertices();
+			mesh_desc.points.stride = sizeof(PxVec3);
+			mesh_desc.points.data = mesh->getVertices();
+			mesh_desc.triangles.count = mesh->getNbTriangles();
+			mesh_desc.triangles.data = mesh->getTriangles();
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+			if (mesh->getTriangleMeshFlags() & PxTriangleMeshFlag::eHAS_16BIT_TRIANGLE_INDICES)
+#else
+			if (mesh->getTriangleMeshFlags() & PxTriangleMeshFlag::e16_BIT_INDICES)
+#endif
+			{
+				mesh_desc.triangles.stride = 3*sizeof(PxU16);
+				mesh_desc.flags = PxMeshFlag::e16_BIT_INDICES;
+			}
+			else
+				mesh_desc.triangles.stride = 3*sizeof(PxU32);
+
+			PxDefaultMemoryOutputStream stream;
+			if (!GetCooking()->cookTriangleMesh(mesh_desc, stream))
+				throw new Exception("BinaryScene::Write, triangle mesh cooking failed.");
+			return Blob(mesh, PxGeometryType::eTRIANGLEMESH, stream.getData(), stream.getSize());
+		}
+
+		PxU32 HeightFieldBlob(const PxHeightField* height_field)
+		{
+			std::map<const PxBase*, PxU32>::iterator it = blob_index.find(height_field);
+			if (it != blob_index.end())
+				return it->second;
+
+			PxU32 rows = height_field->getNbRows(), columns = height_field->getNbColumns();
+			std::vector<PxHeightFieldSample> samples(rows*columns);
+			height_field->saveCells(&samples.front(), (PxU32)(samples.size()*sizeof(PxHeightFieldSample)));
+			return Blob(height_field, PxGeometryType::eHEIGHTFIELD, (const PxU8*)&samples.front(), samples.size()*sizeof(PxHeightFieldSample), rows, columns);
+		}
+
+		PxU32 Geometry(const PxShape* shape)
+		{
+			PxGeometryHolder holder = shape->getGeometry();
+			BinaryGeometry record;
+			memset(&record, 0, sizeof(record));
+			record.type = holder.getType();
+			record.blob = NO_INDEX;
+
+			//the mesh scales keep their size, not their rotation
+			switch (holder.getType())
+			{
+			case PxGeometryType::eSPHERE:
+				record.params[0] = holder.sphere().radius;
+				break;
+			case PxGeometryType::ePLANE:
+				break;
+			case PxGeometryType::eCAPSULE:
+				record.params[0] = holder.capsule().radius;
+				record.params[1] = holder.capsule().halfHeight;
+				break;
+			case PxGeometryType::eBOX:
+				record.params[0] = holder.box().halfExtents.x;
+				record.params[1] = holder.box().halfExtents.y;
+				record.params[2] = holder.box().halfExtents.z;
+				break;
+			case PxGeometryType::eCONVEXMESH:
+				record.params[0] = holder.convexMesh().scale.scale.x;
+				record.params[1] = holder.convexMesh().scale.scale.y;
+				record.params[2] = holder.convexMesh().scale.scale.z;
+				record.blob = ConvexBlob(holder.convexMesh().convexMesh);
+				break;
+			case PxGeometryType::eTRIANGLEMESH:
+				record.params[0] = holder.triangleMesh().scale.scale.x;
+				record.params[1] = holder.triangleMesh().scale.scale.y;
+				record.params[2] = holder.triangleMesh().scale.scale.z;
+				record.blob = TriangleBlob(holder.triangleMesh().triangleMesh);
+				break;
+			case PxGeometryType::eHEIGHTFIELD:
+				record.params[0] = holder.heightField().heightScale;
+				record.params[1] = holder.heightField().rowScale;
+				record.params[2] = holder.heightField().columnScale;
+				record.blob = HeightFieldBlob(holder.heightField().heightField);
+				break;
+			default:
+				throw new Exception("BinaryScene::Write, unsupported geometry.");
+			}
+
+			std::string key((const char*)&record, sizeof(record));
+			std::map<std::string, PxU32>::iterator it = geometry_index.find(key);
+			if (it != geometry_index.end())
+				return it->second;
+
+			geometry_table.push_back(record);
+			return geometry_index[key] = (PxU32)geometry_table.size() - 1;
+		}
+
+	public:
+		void Add(PxRigidActor* actor)
+		{
+			BinaryActor record;
+			memset(&record, 0, sizeof(record));
+			record.pose = actor->getGlobalPose();
+			record.mass_pose = PxTransform(PxIdentity);
+			record.first_shape = (PxU32)shape_table.size();
+			record.shape_count = actor->getNbShapes();
+			record.actor_flags = (PxU32)actor->getActorFlags();
+			record.name = NO_INDEX;
+
+			PxRigidDynamic* body = actor->is<PxRigidDynamic>();
+			if (body)
+			{
+				record.flags |= BinaryActor::DYNAMIC;
+				record.mass = body->getMass();
+				record.inertia = body->getMassSpaceInertiaTensor();
+				record.mass_pose = body->getCMassLocalPose();
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+				if (body->getRigidDynamicFlags() & PxRigidDynamicFlag::eKINEMATIC)
+#else
+				if (body->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC)
+#endif
+					record.flags |= BinaryActor::KINEMATIC;
+			}
+
+			const char* name = actor->getName();
+			if (name && *name)
+			{
+				record.name = (PxU32)names.size();
+				names.append(name, strlen(name) + 1);
+			}
+
+			std::vector<PxShape*> shapes(record.shape_count);
+			if (shapes.size())
+				actor->getShapes(&shapes.front(), (PxU32)shapes.size());
+			for (unsigned int i = 0; i < shapes.size(); i++)
+			{
+				BinaryShape shape;
+				memset(&shape, 0, sizeof(shape));
+				shape.local_pose = shapes[i]->getLocalPose();
+				UserData* user_data = (UserData*)shapes[i]->userData;
+				shape.color = (user_data && user_data->color) ? *user_data->color : default_color;
+				shape.flags = (PxU32)shapes[i]->getFlags();
+				PxFilterData filter_data = shapes[i]->getSimulationFilterData();
+				shape.filter[0] = filter_data.word0;
+				shape.filter[1] = filter_data.word1;
+				shape.filter[2] = filter_data.word2;
+				shape.filter[3] = filter_data.word3;
+
+				//multi material shapes keep their first material
+				PxMaterial* material = 0;
+				shapes[i]->getMaterials(&material, 1);
+				shape.material = Material(material ? material : GetMaterial());
+				shape.geometry = Geometry(shapes[i]);
+				shape_table.push_back(shape);
+			}
+
+			actor_table.push_back(record);
+		}
+
+		size_t Save(const std::string& filename)
+		{
+			BinarySceneHeader header;
+			memset(&header, 0, sizeof(header));
+			memcpy(header.magic, BINARY_SCENE_MAGIC, sizeof(header.magic));
+			header.version = BINARY_SCENE_VERSION;
+			header.physx_version = PX_PHYSICS_VERSION;
+			header.material_count = (PxU32)material_table.size();
+			header.geometry_count = (PxU32)geometry_table.size();
+			header.shape_count = (PxU32)shape_table.size();
+			header.actor_count = (PxU32)actor_table.size();
+			header.blob_count = (PxU32)blob_table.size();
+			header.names_size = (PxU32)names.size();
+
+			//tables first, then the blobs
+			header.materials = Align(sizeof(header));
+			header.geometries = Align(header.materials + material_table.size()*sizeof(BinaryMaterial));
+			header.shapes = Align(header.geometries + geometry_table.size()*sizeof(BinaryGeometry));
+			header.actors = Align(header.shapes + shape_table.size()*sizeof(BinaryShape));
+			header.blobs = Align(header.actors + actor_table.size()*sizeof(BinaryActor));
+			header.names = Align(header.blobs + blob_table.size()*sizeof(BinaryBlob));
+			PxU64 offset = Align(header.names + names.size());
+			for (unsigned int i = 0; i < blob_table.size(); i++)
+			{
+				blob_table[i].offset = offset;
+				offset = Align(offset + blob_table[i].size);
+			}
+			header.file_size = offset;
+
+			std::ofstream file(filename.c_str(), std::ios::binary);
+			if (!file)
+				throw new Exception("BinaryScene::Write, could not open " + filename + ".");
+
+			PxU64 position = 0;
+			Write(file, position, 0, &header, sizeof(header));
+			Write(file, position, header.materials, material_table.data(), material_table.size()*sizeof(BinaryMaterial));
+			Write(file, position, header.geometries, geometry_table.data(), geometry_table.size()*sizeof(BinaryGeometry));
+			Write(file, position, header.shapes, shape_table.data(), shape_table.size()*sizeof(BinaryShape));
+			Write(file, position, header.actors, actor_table.data(), actor_table.size()*sizeof(BinaryActor));
+			Write(file, position, header.blobs, blob_table.data(), blob_table.size()*sizeof(BinaryBlob));
+			Write(file, position, header.names, names.data(), names.size());
+			for (unsigned int i = 0; i < blob_table.size(); i++)
+				Write(file, position, blob_table[i].offset, blobs[i].data(), blobs[i].size());
+			Write(file, position, header.file_size, 0, 0);
+
+			file.close();
+			if (!file)
+				throw new Exception("BinaryScene::Write, could not write " + filename + ".");
+			return (size_t)header.file_size;
+		}
+
+		//pad up to offset and write the bytes
+		static void Write(std::ofstream& file, PxU64& position, PxU64 offset, const void* bytes, size_t size)
+		{
+			static const char zeros[16] = {};
+			file.write(zeros, (std::streamsize)(offset - position));
+			if (size)
+				file.write((const char*)bytes, (std::streamsize)size);
+			position = offset + size;
+		}
+	};
+
+	size_t BinaryScene::Write(Scene& scene, const std::string& filename)
+	{
+		BinarySceneWriter writer;
+		{
+			SceneReadLock lock(scene);
+			std::vector<PxActor*> actors = scene.GetAllActors();
+			for (unsigned int i = 0; i < actors.size(); i++)
+			{
+				PxRigidActor* actor = actors[i]->is<PxRigidActor>();
+				if (actor)
+					writer.Add(actor);
+			}
+		}
+		return writer.Save(filename);
+	}
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "SceneLoader.h"
+
+namespace PhysicsEngine
+{
+	///Version of the binary scene files written by BinaryScene::Write
+	static const PxU32 BINARY_SCENE_VERSION = 1;
+
+	///Header at the start of a binary scene file, followed by the tables it points to
+	///All offsets are from the start of the file and 16 byte aligned, the file is little endian.
+	struct BinarySceneHeader
+	{
+		//"PXSCENE" and a terminating zero
+		char magic[8];
+		PxU32 version;
+		//PX_PHYSICS_VERSION of the cooked meshes, they only load with the same SDK
+		PxU32 physx_version;
+		PxU32 material_count, geometry_count, shape_count, actor_count, blob_count, names_size;
+		PxU64 materials, geometries, shapes, actors, blobs, names;
+		PxU64 file_size;
+	};
+
+	struct BinaryMaterial
+	{
+		PxReal static_friction, dynamic_friction, restitution;
+		PxU32 padding;
+	};
+
+	///Geometry shared by any number of shapes
+	struct BinaryGeometry
+	{
+		//PxGeometryType
+		PxU32 type;
+		//cooked mesh or heightfield samples, -1 for the primitives
+		PxU32 blob;
+		//box: half extents, sphere: radius, capsule: radius and half height,
+		//meshes: scale, heightfield: height, row and column scale
+		PxReal params[3];
+		PxU32 padding[3];
+	};
+
+	///Cooked convex or triangle mesh, or the samples of a heightfield
+	struct BinaryBlob
+	{
+		PxU64 offset, size;
+		//PxGeometryType of the users
+		PxU32 type;
+		//heightfield samples
+		PxU32 rows, columns;
+		PxU32 padding;
+	};
+
+	struct BinaryShape
+	{
+		PxTransform local_pose;
+		//pointed to by the UserData of the shape, the mapping is copy on write so the highlight can change it
+		PxVec3 color;
+		PxU32 geometry, material;
+		//PxShapeFlags
+		PxU32 flags;
+		PxU32 filter[4];
+		PxU32 padding[3];
+	};
+
+	struct BinaryActor
+	{
+		PxTransform pose;
+		//mass properties of the dynamic actors, set as they are instead of being computed from the shapes
+		PxTransform mass_pose;
+		PxVec3 inertia;
+		PxReal mass;
+		PxU32 first_shape, shape_count;
+		//PxActorFlags and the BinaryActor flags below
+		PxU32 actor_flags, flags;
+		//offset into the name table, -1 for no name
+		PxU32 name;
+		PxU32 padding;
+
+		enum Flags
+		{
+			DYNAMIC		= (1 << 0),
+			KINEMATIC	= (1 << 1)
+		};
+	};
+
+	///Scene file mapped into memory and instantiated straight from the mapping
+	///
+	///The file holds tables of materials, geometries, shapes and actors, and blobs with the cooked meshes.
+	///Shapes share the geometries and the meshes, the actors refer to a range of shapes. Nothing is parsed
+	///or copied: the cooked meshes are read from the mapping, the shape colors and the actor names point
+	///into it and the dynamic actors get their stored mass properties. All actors are added with a single
+	///PxScene::addActors. The mapping stays open until Clear, as long as the actors use it.
+	///
+	///Write converts the rigid actors of any Scene (cloth and joints are not stored).
+	class BinaryScene
+	{
+		Scene* scene;
+		//the mapping
+		PxU8* data;
+		size_t size;
+		void* file_handle;
+		void* mapping_handle;
+		const BinarySceneHeader* header;
+
+		std::vector<PxMaterial*> materials;
+		std::vector<PxBase*> meshes;
+		std::vector<PxActor*> actors;
+		std::vector<UserData> user_data;
+		//wrappers of the actors returned by Find
+		std::map<std::string, Actor*> found;
+		SceneLoadStats stats;
+
+		void Map(const std::string& filename);
+		void Unmap();
+		void Check(const std::string& filename);
+		void Instantiate();
+		PxRigidActor* FindActor(const std::string& name);
+
+	public:
+		BinaryScene(Scene* _scene) : scene(_scene), data(0), size(0), file_handle(0), mapping_handle(0), header(0) {}
+
+		///Releases the actors and closes the mapping
+		~BinaryScene();
+
+		///Map a binary scene file and add its actors to the scene, throws an Exception for invalid files
+		void Load(const std::string& filename);
+
+		///Release the actors, meshes and materials and close the mapping
+		void Clear();
+
+		///Get a named actor as an Actor (e.g. to change its colors), or 0
+		Actor* Find(const std::string& name);
+
+		///Statistics of the last load, the mapping counts into the total time
+		const SceneLoadStats& Stats() const { return stats; }
+
+		///Does the file start with the magic of a binary scene
+		static bool IsBinary(const std::string& filename);
+
+		///Convert the rigid actors of a scene into a binary scene file, returns the file size
+		///Deselect the actors first (Scene::ClearSelection), the highlighted colors would be saved.
+		static size_t Write(Scene& scene, const std::string& filename);
+	};
+}
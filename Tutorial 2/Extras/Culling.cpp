@@ -0,0 +1,124 @@
+#include "Culling.h"
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		void Frustum::Set(const PxVec3& eye, const PxVec3& dir, const PxVec3& up, PxReal fov_y, PxReal aspect, PxReal z_near, PxReal z_far)
+		{
+			PxVec3 f = dir.getNormalized();
+			PxVec3 r = f.cross(up).getNormalized();
+			PxVec3 u = r.cross(f);
+
+			PxReal ty = PxTan(fov_y * PxPi / 360.f);
+			PxReal tx = ty * aspect;
+
+			PxVec3 normals[6] =
+			{
+				f,
+				-f,
+				r + f*tx,
+				-r + f*tx,
+				u + f*ty,
+				-u + f*ty
+			};
+			PxVec3 points[6] = { eye + f*z_near, eye + f*z_far, eye, eye, eye, eye };
+
+			for (PxU32 i = 0; i < 6; i++)
+			{
+				PxVec3 n = normals[i].getNormalized();
+				planes[i] = PxPlane(n, -n.dot(points[i]));
+			}
+		}
+
+		void Frustum::Set(const PxMat44& clip)
+		{
+			//rows of the matrix, a point is inside when -w <= x,y,z <= w
+			PxVec4 rows[4];
+			for (PxU32 i = 0; i < 4; i++)
+				rows[i] = PxVec4(clip.column0[i], clip.column1[i], clip.column2[i], clip.column3[i]);
+
+			PxVec4 coefficients[6] =
+			{
+				rows[3] + rows[2],
+				rows[3] - rows[2],
+				rows[3] + rows[0],
+				rows[3] - rows[0],
+				rows[3] + rows[1],
+				rows[3] - rows[1]
+			};
+
+			for (PxU32 i = 0; i < 6; i++)
+			{
+				PxVec3 n = coefficients[i].getXYZ();
+				PxReal length = n.magnitude();
+				planes[i] = PxPlane(n/length, coefficients[i].w/length);
+			}
+		}
+
+		Frustum::Result Frustum::Test(const PxBounds3& bounds) const
+		{
+			PxVec3 center = bounds.getCenter();
+			PxVec3 extents = bounds.getExtents();
+
+			Result result = INSIDE;
+			for (PxU32 i = 0; i < 6; i++)
+			{
+				//distance of the box centre and the projected box radius
+				PxReal distance = planes[i].distance(center);
+				PxReal radius = PxAbs(planes[i].n.x)*extents.x + PxAbs(planes[i].n.y)*extents.y + PxAbs(planes[i].n.z)*extents.z;
+				if (distance < -radius)
+					return OUTSIDE;
+				if (distance < radius)
+					result = INTERSECTS;
+			}
+			return result;
+		}
+
+		const StaticBoundsCache::Entry& StaticBoundsCache::Get(const PxRigidActor* actor, PxShape* const* shapes, PxU32 count)
+		{
+			if (!listening)
+			{
+				PxGetPhysics().registerDeletionListener(*this, PxDeletionEventFlag::eMEMORY_RELEASE);
+				listening = true;
+			}
+
+			PxTransform pose = actor->getGlobalPose();
+			std::map<const PxBase*, Entry>::iterator it = actors.find(actor);
+			if ((it != actors.end()) && (it->second.pose == pose) && (it->second.shapes.size() == count))
+				return it->second;
+
+			Entry& entry = actors[actor];
+			entry.pose = pose;
+			entry.shapes.resize(count);
+			entry.actor = PxBounds3::empty();
+			for (PxU32 i = 0; i < count; i++)
+			{
+				entry.shapes[i] = PxShapeExt::getWorldBounds(*shapes[i], *actor);
+				entry.actor.include(entry.shapes[i]);
+			}
+			return entry;
+		}
+
+		void StaticBoundsCache::Flush()
+		{
+			std::vector<const PxBase*> evict;
+			{
+				std::lock_guard<std::mutex> lock(released_mutex);
+				evict.swap(released);
+			}
+
+			for (PxU32 i = 0; i < evict.size(); i++)
+				actors.erase(evict[i]);
+		}
+
+		void StaticBoundsCache::onRelease(const PxBase* observed, void* userData, PxDeletionEventFlag::Enum deletionEvent)
+		{
+			if (observed->getConcreteType() != PxConcreteType::eRIGID_STATIC)
+				return;
+
+			std::lock_guard<std::mutex> lock(released_mutex);
+			released.push_back(observed);
+		}
+	}
+}
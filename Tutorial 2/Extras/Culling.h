@@ -0,0 +1,70 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <map>
+#include <vector>
+#include <mutex>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///View frustum of a perspective camera
+		class Frustum
+		{
+			//inward facing planes: near, far, left, right, bottom, top
+			PxPlane planes[6];
+
+		public:
+			enum Result
+			{
+				OUTSIDE,
+				INTERSECTS,
+				INSIDE
+			};
+
+			///Build the frustum from the camera (fov_y in degrees, same as gluPerspective)
+			void Set(const PxVec3& eye, const PxVec3& dir, const PxVec3& up, PxReal fov_y, PxReal aspect, PxReal z_near, PxReal z_far);
+
+			///Build the frustum from a projection * modelview matrix, the planes are in the space the modelview starts from
+			void Set(const PxMat44& clip);
+
+			///Test world bounds against the frustum
+			Result Test(const PxBounds3& bounds) const;
+		};
+
+		///World bounds of static actors and their shapes
+		///
+		///The bounds are computed once and again only when the actor is moved or its shapes change.
+		///Entries are evicted through PxDeletionListener when the actor is released, see MeshCache.
+		class StaticBoundsCache : public PxDeletionListener
+		{
+		public:
+			struct Entry
+			{
+				PxTransform pose;
+				PxBounds3 actor;
+				std::vector<PxBounds3> shapes;
+			};
+
+		private:
+			std::map<const PxBase*, Entry> actors;
+			std::vector<const PxBase*> released;
+			std::mutex released_mutex;
+			bool listening;
+
+		public:
+			StaticBoundsCache() : listening(false) {}
+
+			///Get the bounds of a static actor, shapes are the ones returned by getShapes
+			const Entry& Get(const PxRigidActor* actor, PxShape* const* shapes, PxU32 count);
+
+			///Evict the actors released since the last call (rendering thread)
+			void Flush();
+
+			virtual void onRelease(const PxBase* observed, void* userData, PxDeletionEventFlag::Enum deletionEvent);
+		};
+	}
+}
@@ -0,0 +1,228 @@
+#include "FrameWriter.h"
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace GLExtensions;
+
+		FrameWriter::FrameWriter(const std::string& _prefix, FrameFormat _format, size_t _max_queued, bool _pixel_buffers)
+			: prefix(_prefix), format(_format), max_queued(PxMax(_max_queued, (size_t)1)), closing(false), failed(false), captured(0), written(0),
+			use_pixel_buffers(_pixel_buffers && HasPixelBuffers()), capture_ms(0.)
+		{
+			for (PxU32 i = 0; i < PIXEL_BUFFERS; i++)
+			{
+				pixel_buffers[i].buffer = 0;
+				pixel_buffers[i].width = pixel_buffers[i].height = 0;
+				pixel_buffers[i].index = 0;
+				pixel_buffers[i].pending = false;
+			}
+
+			thread = std::thread(&FrameWriter::Run, this);
+		}
+
+		FrameWriter::~FrameWriter()
+		{
+			Close();
+			for (size_t i = 0; i < spare.size(); i++)
+				delete spare[i];
+		}
+
+		FrameWriter::Frame* FrameWriter::NewFrame()
+		{
+			//wait for the writer when the queue is full
+			std::unique_lock<std::mutex> lock(mutex);
+			frame_written.wait(lock, [this] { return queue.size() < max_queued; });
+			if (spare.empty())
+				return new Frame();
+
+			Frame* frame = spare.back();
+			spare.pop_back();
+			return frame;
+		}
+
+		void FrameWriter::Queue(Frame* frame)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(frame);
+			frame_queued.notify_one();
+		}
+
+		void FrameWriter::Map(PixelBuffer& pixel_buffer)
+		{
+			Frame* frame = NewFrame();
+			frame->index = pixel_buffer.index;
+			frame->width = pixel_buffer.width;
+			frame->height = pixel_buffer.height;
+			frame->layout = GL_BGRA;
+			frame->pixels.resize(frame->width*frame->height*4);
+
+			BindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffer.buffer);
+			const void* data = MapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+			if (data)
+			{
+				memcpy(&frame->pixels.front(), data, frame->pixels.size());
+				UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+			BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			pixel_buffer.pending = false;
+
+			if (data)
+				Queue(frame);
+			else
+			{
+				//the context is gone, the frame is dropped
+				std::lock_guard<std::mutex> lock(mutex);
+				spare.push_back(frame);
+			}
+		}
+
+		void FrameWriter::Capture()
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			GLint viewport[4];
+			glGetIntegerv(GL_VIEWPORT, viewport);
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+			if (use_pixel_buffers)
+			{
+				//BGRA matches the framebuffer layout of most drivers, the transfer needs no conversion
+				PixelBuffer& target = pixel_buffers[captured % PIXEL_BUFFERS];
+				if (!target.buffer)
+					GenBuffers(1, &target.buffer);
+				BindBuffer(GL_PIXEL_PACK_BUFFER, target.buffer);
+				if ((target.width != viewport[2]) || (target.height != viewport[3]))
+				{
+					target.width = viewport[2];
+					target.height = viewport[3];
+					BufferData(GL_PIXEL_PACK_BUFFER, target.width*target.height*4, 0, GL_STREAM_READ);
+				}
+				glReadPixels(viewport[0], viewport[1], target.width, target.height, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+				BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+				target.index = captured;
+				target.pending = true;
+
+				//the frame read two captures ago has reached the buffer by now, mapping it does not wait
+				PixelBuffer& oldest = pixel_buffers[(captured + 1) % PIXEL_BUFFERS];
+				if (oldest.pending)
+					Map(oldest);
+			}
+			else
+			{
+				Frame* frame = NewFrame();
+				frame->index = captured;
+				frame->width = viewport[2];
+				frame->height = viewport[3];
+				frame->layout = GL_RGB;
+				frame->pixels.resize(frame->width*frame->height*3);
+				glReadPixels(viewport[0], viewport[1], frame->width, frame->height, GL_RGB, GL_UNSIGNED_BYTE, &frame->pixels.front());
+				Queue(frame);
+			}
+
+			captured++;
+			capture_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		void FrameWriter::Close()
+		{
+			if (!thread.joinable())
+				return;
+
+			//the frames still in the ring, oldest first
+			for (PxU32 i = 0; i < PIXEL_BUFFERS; i++)
+			{
+				PixelBuffer& pixel_buffer = pixel_buffers[(captured + i) % PIXEL_BUFFERS];
+				if (pixel_buffer.pending)
+					Map(pixel_buffer);
+				if (pixel_buffer.buffer)
+					DeleteBuffers(1, &pixel_buffer.buffer);
+				pixel_buffer.buffer = 0;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				closing = true;
+				frame_queued.notify_one();
+			}
+			thread.join();
+		}
+
+		PxU32 FrameWriter::Written()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return written;
+		}
+
+		bool FrameWriter::Failed()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return failed;
+		}
+
+		void FrameWriter::Run()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			for (;;)
+			{
+				frame_queued.wait(lock, [this] { return closing || !queue.empty(); });
+				if (queue.empty())
+					return;
+
+				//the file is written without the lock, Capture can queue the next frames meanwhile
+				Frame* frame = queue.front();
+				lock.unlock();
+				bool ok = !failed && Write(*frame);
+				lock.lock();
+
+				queue.pop_front();
+				spare.push_back(frame);
+				if (ok)
+					written++;
+				else
+					failed = true;
+				frame_written.notify_one();
+			}
+		}
+
+		bool FrameWriter::Write(const Frame& frame)
+		{
+			char number[16];
+			snprintf(number, sizeof(number), "%06u", frame.index);
+			std::string filename = prefix + number + ((format == FRAMES_PPM) ? ".ppm" : ".raw");
+
+			FILE* file = fopen(filename.c_str(), "wb");
+			if (!file)
+				return false;
+
+			if (format == FRAMES_PPM)
+				fprintf(file, "P6\n%d %d\n255\n", frame.width, frame.height);
+
+			//both formats store top-down RGB rows
+			size_t channels = (frame.layout == GL_BGRA) ? 4 : 3;
+			size_t row = frame.width*channels;
+			std::vector<PxU8> rgb(frame.width*3);
+			bool ok = true;
+			for (int y = frame.height-1; ok && (y >= 0); y--)
+			{
+				const PxU8* source = &frame.pixels[y*row];
+				if (channels == 4)
+				{
+					for (int x = 0; x < frame.width; x++)
+					{
+						rgb[x*3] = source[x*4+2];
+						rgb[x*3+1] = source[x*4+1];
+						rgb[x*3+2] = source[x*4];
+					}
+					source = &rgb.front();
+				}
+				ok = (fwrite(source, 1, frame.width*3, file) == (size_t)frame.width*3);
+			}
+
+			return (fclose(file) == 0) && ok;
+		}
+	}
+}
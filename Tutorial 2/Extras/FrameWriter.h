@@ -0,0 +1,109 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "GLExtensions.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///File formats of the written frames
+		enum FrameFormat
+		{
+			///binary PPM (P6), viewable by most image tools
+			FRAMES_PPM,
+			///top-down RGB rows without a header, e.g. for ffmpeg -f rawvideo -pix_fmt rgb24
+			FRAMES_RAW
+		};
+
+		///Writes the rendered frames to numbered files on a background thread
+		///
+		///Capture reads the framebuffer on the rendering thread and queues the copy, the files are converted
+		///and written by the writer thread. Capture waits while the queue is full, so a slow disk throttles
+		///the renderer instead of piling the frames up in memory.
+		///
+		///With pixel buffer objects the readback does not stall the pipeline: every frame is read into the next
+		///buffer of a ring and mapped two captures later, when the transfer has finished in the background.
+		///Capture and Close have to be called with the GL context current.
+		class FrameWriter
+		{
+			struct Frame
+			{
+				PxU32 index;
+				int width, height;
+				//bottom-up rows, GL_RGB or GL_BGRA
+				GLenum layout;
+				std::vector<PxU8> pixels;
+			};
+
+			//readback target of a single frame
+			struct PixelBuffer
+			{
+				GLuint buffer;
+				int width, height;
+				PxU32 index;
+				bool pending;
+			};
+
+			static const PxU32 PIXEL_BUFFERS = 3;
+
+			std::string prefix;
+			FrameFormat format;
+			size_t max_queued;
+			std::deque<Frame*> queue;
+			//written frames kept for their buffers
+			std::vector<Frame*> spare;
+			std::mutex mutex;
+			std::condition_variable frame_queued, frame_written;
+			std::thread thread;
+			bool closing, failed;
+			PxU32 captured, written;
+			bool use_pixel_buffers;
+			PixelBuffer pixel_buffers[PIXEL_BUFFERS];
+			double capture_ms;
+
+			Frame* NewFrame();
+			void Queue(Frame* frame);
+			void Map(PixelBuffer& pixel_buffer);
+			void Run();
+			bool Write(const Frame& frame);
+
+		public:
+			///Frames go to prefix + 6 digit index + .ppm or .raw, at most max_queued frames wait for the writer
+			///The pixel buffer ring is used when requested and supported by the driver.
+			FrameWriter(const std::string& prefix, FrameFormat format=FRAMES_PPM, size_t max_queued=8, bool pixel_buffers=true);
+
+			///Writes the queued frames (call Close first when the frames are still in the pixel buffers)
+			~FrameWriter();
+
+			///Read the current framebuffer (the whole viewport) and queue it
+			void Capture();
+
+			///Write the queued frames and stop the writer thread
+			void Close();
+
+			///Number of captured frames
+			PxU32 Captured() const { return captured; }
+
+			///Number of written frames
+			PxU32 Written();
+
+			///Average time of Capture on the rendering thread in milliseconds
+			double CaptureTime() const { return captured ? capture_ms / captured : 0.; }
+
+			///Are the frames read back through the pixel buffer ring
+			bool PixelBuffers() const { return use_pixel_buffers; }
+
+			///Could a file not be written, the following frames are dropped
+			bool Failed();
+		};
+	}
+}
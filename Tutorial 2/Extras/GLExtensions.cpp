@@ -0,0 +1,287 @@
+#include "GLExtensions.h"
+#include <string.h>
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(RENDERER_EGL)
+#include <EGL/egl.h>
+#else
+#include <GL/glx.h>
+#endif
+
+namespace VisualDebugger
+{
+	namespace GLExtensions
+	{
+		PFNGENBUFFERS GenBuffers = 0;
+		PFNDELETEBUFFERS DeleteBuffers = 0;
+		PFNBINDBUFFER BindBuffer = 0;
+		PFNBUFFERDATA BufferData = 0;
+		PFNBUFFERSUBDATA BufferSubData = 0;
+		PFNMAPBUFFER MapBuffer = 0;
+		PFNUNMAPBUFFER UnmapBuffer = 0;
+
+		PFNGENQUERIES GenQueries = 0;
+		PFNDELETEQUERIES DeleteQueries = 0;
+		PFNBEGINQUERY BeginQuery = 0;
+		PFNENDQUERY EndQuery = 0;
+		PFNGETQUERYOBJECTIV GetQueryObjectiv = 0;
+		PFNGETQUERYOBJECTUI64V GetQueryObjectui64v = 0;
+
+		PFNCREATESHADER CreateShader = 0;
+		PFNDELETESHADER DeleteShader = 0;
+		PFNSHADERSOURCE ShaderSource = 0;
+		PFNCOMPILESHADER CompileShader = 0;
+		PFNGETSHADERIV GetShaderiv = 0;
+		PFNGETSHADERINFOLOG GetShaderInfoLog = 0;
+		PFNCREATEPROGRAM CreateProgram = 0;
+		PFNDELETEPROGRAM DeleteProgram = 0;
+		PFNATTACHSHADER AttachShader = 0;
+		PFNBINDATTRIBLOCATION BindAttribLocation = 0;
+		PFNLINKPROGRAM LinkProgram = 0;
+		PFNGETPROGRAMIV GetProgramiv = 0;
+		PFNGETPROGRAMINFOLOG GetProgramInfoLog = 0;
+		PFNUSEPROGRAM UseProgram = 0;
+		PFNGETUNIFORMLOCATION GetUniformLocation = 0;
+		PFNUNIFORM1I Uniform1i = 0;
+		PFNUNIFORM4F Uniform4f = 0;
+		PFNUNIFORMMATRIX4FV UniformMatrix4fv = 0;
+		PFNENABLEVERTEXATTRIBARRAY EnableVertexAttribArray = 0;
+		PFNDISABLEVERTEXATTRIBARRAY DisableVertexAttribArray = 0;
+		PFNVERTEXATTRIBPOINTER VertexAttribPointer = 0;
+
+		PFNGENFRAMEBUFFERS GenFramebuffers = 0;
+		PFNDELETEFRAMEBUFFERS DeleteFramebuffers = 0;
+		PFNBINDFRAMEBUFFER BindFramebuffer = 0;
+		PFNFRAMEBUFFERTEXTURE2D FramebufferTexture2D = 0;
+		PFNCHECKFRAMEBUFFERSTATUS CheckFramebufferStatus = 0;
+
+		PFNVERTEXATTRIBDIVISOR VertexAttribDivisor = 0;
+		PFNDRAWELEMENTSINSTANCED DrawElementsInstanced = 0;
+
+		bool has_buffers = false;
+		bool has_pixel_buffers = false;
+		bool has_timer_queries = false;
+		bool has_shaders = false;
+		bool has_instancing = false;
+		bool has_framebuffers = false;
+		bool has_vertex_array_bgra = false;
+
+		///Find a single entry point
+		void* GetProc(const char* name)
+		{
+#ifdef _WIN32
+			return (void*)wglGetProcAddress(name);
+#elif defined(RENDERER_EGL)
+			return (void*)eglGetProcAddress(name);
+#else
+			return (void*)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+		}
+
+		///Find an entry point by its core name first and its extension name second
+		void* GetProc(const char* name, const char* suffix)
+		{
+			void* proc = GetProc(name);
+			if (!proc)
+			{
+				char ext_name[128];
+				sprintf(ext_name, "%s%s", name, suffix);
+				proc = GetProc(ext_name);
+			}
+			return proc;
+		}
+
+		///OpenGL version of the current context, e.g. 15 for 1.5
+		int Version()
+		{
+			const char* version = (const char*)glGetString(GL_VERSION);
+			int major = 1, minor = 1;
+			if (version)
+				sscanf(version, "%d.%d", &major, &minor);
+			return major*10 + minor;
+		}
+
+		bool Supported(const char* extension)
+		{
+			const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+			if (!extensions)
+				return false;
+
+			//match whole names only, e.g. GL_ARB_shadow is not GL_ARB_shadow_ambient
+			size_t length = strlen(extension);
+			for (const char* s = strstr(extensions, extension); s; s = strstr(s + length, extension))
+			{
+				if (((s == extensions) || (s[-1] == ' ')) && ((s[length] == ' ') || (s[length] == 0)))
+					return true;
+			}
+			return false;
+		}
+
+		void Init()
+		{
+			if ((Version() >= 15) || Supported("GL_ARB_vertex_buffer_object"))
+			{
+				GenBuffers = (PFNGENBUFFERS)GetProc("glGenBuffers", "ARB");
+				DeleteBuffers = (PFNDELETEBUFFERS)GetProc("glDeleteBuffers", "ARB");
+				BindBuffer = (PFNBINDBUFFER)GetProc("glBindBuffer", "ARB");
+				BufferData = (PFNBUFFERDATA)GetProc("glBufferData", "ARB");
+				BufferSubData = (PFNBUFFERSUBDATA)GetProc("glBufferSubData", "ARB");
+				MapBuffer = (PFNMAPBUFFER)GetProc("glMapBuffer", "ARB");
+				UnmapBuffer = (PFNUNMAPBUFFER)GetProc("glUnmapBuffer", "ARB");
+			}
+			has_buffers = GenBuffers && DeleteBuffers && BindBuffer && BufferData && BufferSubData;
+
+			//core in 2.1, the same tokens in ARB_ and EXT_pixel_buffer_object
+			has_pixel_buffers = has_buffers && MapBuffer && UnmapBuffer &&
+				((Version() >= 21) || Supported("GL_ARB_pixel_buffer_object") || Supported("GL_EXT_pixel_buffer_object"));
+
+			//the query objects are core in 1.5, the 64 bit results came with the timer queries
+			if ((Version() >= 33) || Supported("GL_ARB_timer_query") || Supported("GL_EXT_timer_query"))
+			{
+				GenQueries = (PFNGENQUERIES)GetProc("glGenQueries", "ARB");
+				DeleteQueries = (PFNDELETEQUERIES)GetProc("glDeleteQueries", "ARB");
+				BeginQuery = (PFNBEGINQUERY)GetProc("glBeginQuery", "ARB");
+				EndQuery = (PFNENDQUERY)GetProc("glEndQuery", "ARB");
+				GetQueryObjectiv = (PFNGETQUERYOBJECTIV)GetProc("glGetQueryObjectiv", "ARB");
+				GetQueryObjectui64v = (PFNGETQUERYOBJECTUI64V)GetProc("glGetQueryObjectui64v", "EXT");
+			}
+			has_timer_queries = GenQueries && DeleteQueries && BeginQuery && EndQuery && GetQueryObjectiv && GetQueryObjectui64v;
+
+			//the ARB_shader_objects entry points have different names and handle types, only the core ones are used
+			if (Version() >= 20)
+			{
+				CreateShader = (PFNCREATESHADER)GetProc("glCreateShader");
+				DeleteShader = (PFNDELETESHADER)GetProc("glDeleteShader");
+				ShaderSource = (PFNSHADERSOURCE)GetProc("glShaderSource");
+				CompileShader = (PFNCOMPILESHADER)GetProc("glCompileShader");
+				GetShaderiv = (PFNGETSHADERIV)GetProc("glGetShaderiv");
+				GetShaderInfoLog = (PFNGETSHADERINFOLOG)GetProc("glGetShaderInfoLog");
+				CreateProgram = (PFNCREATEPROGRAM)GetProc("glCreateProgram");
+				DeleteProgram = (PFNDELETEPROGRAM)GetProc("glDeleteProgram");
+				AttachShader = (PFNATTACHSHADER)GetProc("glAttachShader");
+				BindAttribLocation = (PFNBINDATTRIBLOCATION)GetProc("glBindAttribLocation");
+				LinkProgram = (PFNLINKPROGRAM)GetProc("glLinkProgram");
+				GetProgramiv = (PFNGETPROGRAMIV)GetProc("glGetProgramiv");
+				GetProgramInfoLog = (PFNGETPROGRAMINFOLOG)GetProc("glGetProgramInfoLog");
+				UseProgram = (PFNUSEPROGRAM)GetProc("glUseProgram");
+				GetUniformLocation = (PFNGETUNIFORMLOCATION)GetProc("glGetUniformLocation");
+				Uniform1i = (PFNUNIFORM1I)GetProc("glUniform1i");
+				Uniform4f = (PFNUNIFORM4F)GetProc("glUniform4f");
+				UniformMatrix4fv = (PFNUNIFORMMATRIX4FV)GetProc("glUniformMatrix4fv");
+				EnableVertexAttribArray = (PFNENABLEVERTEXATTRIBARRAY)GetProc("glEnableVertexAttribArray");
+				DisableVertexAttribArray = (PFNDISABLEVERTEXATTRIBARRAY)GetProc("glDisableVertexAttribArray");
+				VertexAttribPointer = (PFNVERTEXATTRIBPOINTER)GetProc("glVertexAttribPointer");
+			}
+			has_shaders = CreateShader && DeleteShader && ShaderSource && CompileShader && GetShaderiv && GetShaderInfoLog &&
+				CreateProgram && DeleteProgram && AttachShader && BindAttribLocation && LinkProgram && GetProgramiv &&
+				GetProgramInfoLog && UseProgram && GetUniformLocation && Uniform1i && Uniform4f && UniformMatrix4fv &&
+				EnableVertexAttribArray && DisableVertexAttribArray && VertexAttribPointer;
+
+			//core in 3.3, ARB_instanced_arrays and ARB_draw_instanced before that
+			if ((Version() >= 33) || Supported("GL_ARB_instanced_arrays"))
+			{
+				VertexAttribDivisor = (PFNVERTEXATTRIBDIVISOR)GetProc("glVertexAttribDivisor", "ARB");
+				DrawElementsInstanced = (PFNDRAWELEMENTSINSTANCED)GetProc("glDrawElementsInstanced", "ARB");
+			}
+			has_instancing = has_buffers && has_shaders && VertexAttribDivisor && DrawElementsInstanced;
+
+			//the EXT entry points behave the same for a single depth attachment
+			if ((Version() >= 30) || Supported("GL_ARB_framebuffer_object") || Supported("GL_EXT_framebuffer_object"))
+			{
+				GenFramebuffers = (PFNGENFRAMEBUFFERS)GetProc("glGenFramebuffers", "EXT");
+				DeleteFramebuffers = (PFNDELETEFRAMEBUFFERS)GetProc("glDeleteFramebuffers", "EXT");
+				BindFramebuffer = (PFNBINDFRAMEBUFFER)GetProc("glBindFramebuffer", "EXT");
+				FramebufferTexture2D = (PFNFRAMEBUFFERTEXTURE2D)GetProc("glFramebufferTexture2D", "EXT");
+				CheckFramebufferStatus = (PFNCHECKFRAMEBUFFERSTATUS)GetProc("glCheckFramebufferStatus", "EXT");
+			}
+			has_framebuffers = GenFramebuffers && DeleteFramebuffers && BindFramebuffer && FramebufferTexture2D && CheckFramebufferStatus &&
+				((Version() >= 14) || (Supported("GL_ARB_depth_texture") && Supported("GL_ARB_shadow")));
+
+			//core in 3.2
+			has_vertex_array_bgra = (Version() >= 32) || Supported("GL_ARB_vertex_array_bgra") || Supported("GL_EXT_vertex_array_bgra");
+		}
+
+		bool HasBuffers() { return has_buffers; }
+
+		bool HasPixelBuffers() { return has_pixel_buffers; }
+
+		bool HasTimerQueries() { return has_timer_queries; }
+
+		bool HasShaders() { return has_shaders; }
+
+		bool HasInstancing() { return has_instancing; }
+
+		bool HasFramebuffers() { return has_framebuffers; }
+
+		bool HasVertexArrayBGRA() { return has_vertex_array_bgra; }
+
+		///Compile a single shader, prints the log and returns 0 on failure
+		GLuint CompileSource(GLenum type, const char* source)
+		{
+			GLuint shader = CreateShader(type);
+			ShaderSource(shader, 1, &source, 0);
+			CompileShader(shader);
+
+			GLint status = 0;
+			GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+			if (!status)
+			{
+				GLint length = 0;
+				GetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+				std::vector<char> log(length + 1, 0);
+				GetShaderInfoLog(shader, length, 0, &log.front());
+				std::cerr << "GLExtensions::CompileSource, " << &log.front() << std::endl;
+				DeleteShader(shader);
+				return 0;
+			}
+			return shader;
+		}
+
+		GLuint BuildProgram(const char* vertex_source, const char* fragment_source,
+			const char** attributes, GLuint attribute_count, GLuint first_location)
+		{
+			if (!has_shaders)
+				return 0;
+
+			GLuint vertex_shader = CompileSource(GL_VERTEX_SHADER, vertex_source);
+			GLuint fragment_shader = CompileSource(GL_FRAGMENT_SHADER, fragment_source);
+			if (!vertex_shader || !fragment_shader)
+			{
+				if (vertex_shader)
+					DeleteShader(vertex_shader);
+				if (fragment_shader)
+					DeleteShader(fragment_shader);
+				return 0;
+			}
+
+			GLuint program = CreateProgram();
+			AttachShader(program, vertex_shader);
+			AttachShader(program, fragment_shader);
+			for (GLuint i = 0; i < attribute_count; i++)
+				BindAttribLocation(program, first_location + i, attributes[i]);
+			LinkProgram(program);
+
+			//the program keeps the shaders alive
+			DeleteShader(vertex_shader);
+			DeleteShader(fragment_shader);
+
+			GLint status = 0;
+			GetProgramiv(program, GL_LINK_STATUS, &status);
+			if (!status)
+			{
+				GLint length = 0;
+				GetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+				std::vector<char> log(length + 1, 0);
+				GetProgramInfoLog(program, length, 0, &log.front());
+				std::cerr << "GLExtensions::BuildProgram, " << &log.front() << std::endl;
+				DeleteProgram(program);
+				return 0;
+			}
+			return program;
+		}
+	}
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#ifdef RENDERER_EGL
+//the offscreen build links GL, GLU and EGL only
+#include <GL/gl.h>
+#include <GL/glu.h>
+#else
+#include <GL/glut.h>
+#endif
+#include <stddef.h>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+//buffer objects (OpenGL 1.5, ARB_vertex_buffer_object)
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER				0x8892
+#define GL_ELEMENT_ARRAY_BUFFER		0x8893
+#define GL_STREAM_DRAW				0x88E0
+#define GL_STATIC_DRAW				0x88E4
+#define GL_DYNAMIC_DRAW				0x88E8
+#endif
+
+//asynchronous readback into buffer objects (OpenGL 2.1, ARB_pixel_buffer_object)
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER		0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ				0x88E1
+#define GL_READ_ONLY				0x88B8
+#endif
+
+//timer queries (OpenGL 3.3, ARB_timer_query, EXT_timer_query)
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED				0x88BF
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT				0x8866
+#define GL_QUERY_RESULT_AVAILABLE	0x8867
+#endif
+
+//shaders (OpenGL 2.0)
+#ifndef GL_VERTEX_SHADER
+#define GL_FRAGMENT_SHADER			0x8B30
+#define GL_VERTEX_SHADER			0x8B31
+#define GL_COMPILE_STATUS			0x8B81
+#define GL_LINK_STATUS				0x8B82
+#define GL_INFO_LOG_LENGTH			0x8B84
+#endif
+
+//framebuffer objects (OpenGL 3.0, ARB_framebuffer_object, EXT_framebuffer_object)
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER				0x8D40
+#define GL_FRAMEBUFFER_COMPLETE		0x8CD5
+#define GL_COLOR_ATTACHMENT0		0x8CE0
+#define GL_DEPTH_ATTACHMENT			0x8D00
+#endif
+
+//depth textures and texture environment (OpenGL 1.3 - 1.4, ARB_depth_texture, ARB_shadow)
+#ifndef GL_DEPTH_COMPONENT24
+#define GL_DEPTH_COMPONENT24		0x81A6
+#endif
+#ifndef GL_TEXTURE_COMPARE_MODE
+#define GL_TEXTURE_COMPARE_MODE		0x884C
+#define GL_TEXTURE_COMPARE_FUNC		0x884D
+#define GL_COMPARE_R_TO_TEXTURE		0x884E
+#define GL_DEPTH_TEXTURE_MODE		0x884B
+#endif
+#ifndef GL_CLAMP_TO_BORDER
+#define GL_CLAMP_TO_BORDER			0x812D
+#endif
+//vertex colors in the byte order of packed ARGB values (OpenGL 1.2, ARB_vertex_array_bgra for vertex arrays)
+#ifndef GL_BGRA
+#define GL_BGRA						0x80E1
+#endif
+#ifndef GL_COMBINE
+#define GL_COMBINE					0x8570
+#define GL_COMBINE_RGB				0x8571
+#define GL_CONSTANT					0x8576
+#define GL_PRIMARY_COLOR			0x8577
+#define GL_INTERPOLATE				0x8575
+#define GL_SOURCE0_RGB				0x8580
+#define GL_SOURCE1_RGB				0x8581
+#define GL_SOURCE2_RGB				0x8582
+#define GL_OPERAND0_RGB				0x8590
+#define GL_OPERAND1_RGB				0x8591
+#define GL_OPERAND2_RGB				0x8592
+#endif
+
+namespace VisualDebugger
+{
+	///OpenGL entry points above version 1.1 (the version exported by opengl32.lib)
+	///
+	///The functions are loaded at run time and stay null when the driver does not support them,
+	///the renderer then falls back to plain client side arrays (e.g. old Mesa software contexts).
+	namespace GLExtensions
+	{
+		typedef void (APIENTRY *PFNGENBUFFERS)(GLsizei n, GLuint* buffers);
+		typedef void (APIENTRY *PFNDELETEBUFFERS)(GLsizei n, const GLuint* buffers);
+		typedef void (APIENTRY *PFNBINDBUFFER)(GLenum target, GLuint buffer);
+		typedef void (APIENTRY *PFNBUFFERDATA)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+		typedef void (APIENTRY *PFNBUFFERSUBDATA)(GLenum target, ptrdiff_t offset, ptrdiff_t size, const void* data);
+		typedef void* (APIENTRY *PFNMAPBUFFER)(GLenum target, GLenum access);
+		typedef GLboolean (APIENTRY *PFNUNMAPBUFFER)(GLenum target);
+
+		typedef void (APIENTRY *PFNGENQUERIES)(GLsizei n, GLuint* ids);
+		typedef void (APIENTRY *PFNDELETEQUERIES)(GLsizei n, const GLuint* ids);
+		typedef void (APIENTRY *PFNBEGINQUERY)(GLenum target, GLuint id);
+		typedef void (APIENTRY *PFNENDQUERY)(GLenum target);
+		typedef void (APIENTRY *PFNGETQUERYOBJECTIV)(GLuint id, GLenum name, GLint* params);
+		typedef void (APIENTRY *PFNGETQUERYOBJECTUI64V)(GLuint id, GLenum name, unsigned long long* params);
+
+		typedef GLuint (APIENTRY *PFNCREATESHADER)(GLenum type);
+		typedef void (APIENTRY *PFNDELETESHADER)(GLuint shader);
+		typedef void (APIENTRY *PFNSHADERSOURCE)(GLuint shader, GLsizei count, const char* const* strings, const GLint* lengths);
+		typedef void (APIENTRY *PFNCOMPILESHADER)(GLuint shader);
+		typedef void (APIENTRY *PFNGETSHADERIV)(GLuint shader, GLenum name, GLint* params);
+		typedef void (APIENTRY *PFNGETSHADERINFOLOG)(GLuint shader, GLsizei size, GLsizei* length, char* log);
+		typedef GLuint (APIENTRY *PFNCREATEPROGRAM)();
+		typedef void (APIENTRY *PFNDELETEPROGRAM)(GLuint program);
+		typedef void (APIENTRY *PFNATTACHSHADER)(GLuint program, GLuint shader);
+		typedef void (APIENTRY *PFNBINDATTRIBLOCATION)(GLuint program, GLuint index, const char* name);
+		typedef void (APIENTRY *PFNLINKPROGRAM)(GLuint program);
+		typedef void (APIENTRY *PFNGETPROGRAMIV)(GLuint program, GLenum name, GLint* params);
+		typedef void (APIENTRY *PFNGETPROGRAMINFOLOG)(GLuint program, GLsizei size, GLsizei* length, char* log);
+		typedef void (APIENTRY *PFNUSEPROGRAM)(GLuint program);
+		typedef GLint (APIENTRY *PFNGETUNIFORMLOCATION)(GLuint program, const char* name);
+		typedef void (APIENTRY *PFNUNIFORM1I)(GLint location, GLint v0);
+		typedef void (APIENTRY *PFNUNIFORM4F)(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+		typedef void (APIENTRY *PFNUNIFORMMATRIX4FV)(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+		typedef void (APIENTRY *PFNENABLEVERTEXATTRIBARRAY)(GLuint index);
+		typedef void (APIENTRY *PFNDISABLEVERTEXATTRIBARRAY)(GLuint index);
+		typedef void (APIENTRY *PFNVERTEXATTRIBPOINTER)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+		typedef void (APIENTRY *PFNVERTEXATTRIBDIVISOR)(GLuint index, GLuint divisor);
+		typedef void (APIENTRY *PFNDRAWELEMENTSINSTANCED)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances);
+
+		typedef void (APIENTRY *PFNGENFRAMEBUFFERS)(GLsizei n, GLuint* framebuffers);
+		typedef void (APIENTRY *PFNDELETEFRAMEBUFFERS)(GLsizei n, const GLuint* framebuffers);
+		typedef void (APIENTRY *PFNBINDFRAMEBUFFER)(GLenum target, GLuint framebuffer);
+		typedef void (APIENTRY *PFNFRAMEBUFFERTEXTURE2D)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+		typedef GLenum (APIENTRY *PFNCHECKFRAMEBUFFERSTATUS)(GLenum target);
+
+		extern PFNGENBUFFERS GenBuffers;
+		extern PFNDELETEBUFFERS DeleteBuffers;
+		extern PFNBINDBUFFER BindBuffer;
+		extern PFNBUFFERDATA BufferData;
+		extern PFNBUFFERSUBDATA BufferSubData;
+		extern PFNMAPBUFFER MapBuffer;
+		extern PFNUNMAPBUFFER UnmapBuffer;
+
+		extern PFNGENQUERIES GenQueries;
+		extern PFNDELETEQUERIES DeleteQueries;
+		extern PFNBEGINQUERY BeginQuery;
+		extern PFNENDQUERY EndQuery;
+		extern PFNGETQUERYOBJECTIV GetQueryObjectiv;
+		extern PFNGETQUERYOBJECTUI64V GetQueryObjectui64v;
+
+		extern PFNCREATESHADER CreateShader;
+		extern PFNDELETESHADER DeleteShader;
+		extern PFNSHADERSOURCE ShaderSource;
+		extern PFNCOMPILESHADER CompileShader;
+		extern PFNGETSHADERIV GetShaderiv;
+		extern PFNGETSHADERINFOLOG GetShaderInfoLog;
+		extern PFNCREATEPROGRAM CreateProgram;
+		extern PFNDELETEPROGRAM DeleteProgram;
+		extern PFNATTACHSHADER AttachShader;
+		extern PFNBINDATTRIBLOCATION BindAttribLocation;
+		extern PFNLINKPROGRAM LinkProgram;
+		extern PFNGETPROGRAMIV GetProgramiv;
+		extern PFNGETPROGRAMINFOLOG GetProgramInfoLog;
+		extern PFNUSEPROGRAM UseProgram;
+		extern PFNGETUNIFORMLOCATION GetUniformLocation;
+		extern PFNUNIFORM1I Uniform1i;
+		extern PFNUNIFORM4F Uniform4f;
+		extern PFNUNIFORMMATRIX4FV UniformMatrix4fv;
+		extern PFNENABLEVERTEXATTRIBARRAY EnableVertexAttribArray;
+		extern PFNDISABLEVERTEXATTRIBARRAY DisableVertexAttribArray;
+		extern PFNVERTEXATTRIBPOINTER VertexAttribPointer;
+
+		extern PFNGENFRAMEBUFFERS GenFramebuffers;
+		extern PFNDELETEFRAMEBUFFERS DeleteFramebuffers;
+		extern PFNBINDFRAMEBUFFER BindFramebuffer;
+		extern PFNFRAMEBUFFERTEXTURE2D FramebufferTexture2D;
+		extern PFNCHECKFRAMEBUFFERSTATUS CheckFramebufferStatus;
+
+		extern PFNVERTEXATTRIBDIVISOR VertexAttribDivisor;
+		extern PFNDRAWELEMENTSINSTANCED DrawElementsInstanced;
+
+		///Load all entry points, needs a current GL context
+		void Init();
+
+		///Check the extension string of the current context
+		bool Supported(const char* extension);
+
+		///Vertex and index buffer objects available
+		bool HasBuffers();
+
+		///Buffer objects as the target of glReadPixels available
+		bool HasPixelBuffers();
+
+		///Queries measuring the GPU time of a block of commands available
+		bool HasTimerQueries();
+
+		///GLSL programs available
+		bool HasShaders();
+
+		///Instanced drawing with per instance attributes available
+		bool HasInstancing();
+
+		///Framebuffer objects and depth textures with comparison available (shadow maps)
+		bool HasFramebuffers();
+
+		///GL_BGRA accepted as the size of glColorPointer
+		bool HasVertexArrayBGRA();
+
+		///Compile and link a GLSL program, returns 0 on failure
+		///Attribute names are bound to the locations first, starting with first_location.
+		GLuint BuildProgram(const char* vertex_source, const char* fragment_source,
+			const char** attributes=0, GLuint attribute_count=0, GLuint first_location=0);
+	}
+}
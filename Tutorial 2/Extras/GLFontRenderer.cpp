@@ -1,7 +1,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
-#include <GL/glut.h>
+#include "GLExtensions.h"
 
 #include "GLFontData.h"
 #include "GLFontRenderer.h"
@@ -36,143 +36,139 @@ bool GLFontRenderer::init()
 	return true;
 }
 
-void GLFontRenderer::print(float x, float y, float fontSize, const char* pString, bool forceMonoSpace, int monoSpaceWidth, bool doOrthoProj)
+bool GLFontRenderer::begin(bool doOrthoProj)
 {
-	x = x*m_screenWidth;
-	y = y*m_screenHeight;
-	fontSize = fontSize*m_screenHeight;
-
 	if(!m_isInit)
 	{
 		m_isInit = init();
 	}
 
-	unsigned int num = (unsigned int)strlen(pString);
-	if(m_isInit && num > 0)
-	{
-		glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
-		glDisable(GL_DEPTH_TEST);
-		glDisable(GL_LIGHTING);
+	if(!m_isInit) return false;
 
-		glEnable(GL_TEXTURE_2D);
-		glBindTexture(GL_TEXTURE_2D, m_textureObject);
+	glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
 
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, m_textureObject);
 
-		if(doOrthoProj)
-		{
-			glMatrixMode(GL_PROJECTION);
-			glPushMatrix();
-			glLoadIdentity();
-			glOrtho(0, m_screenWidth, 0, m_screenHeight, -1, 1);
-		}
-		glMatrixMode(GL_MODELVIEW);
+	if(doOrthoProj)
+	{
+		glMatrixMode(GL_PROJECTION);
 		glPushMatrix();
 		glLoadIdentity();
+		glOrtho(0, m_screenWidth, 0, m_screenHeight, -1, 1);
+	}
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
 
-		glEnable(GL_BLEND);
+	glEnable(GL_BLEND);
 
-		glColor4f(m_color[0], m_color[1], m_color[2], m_color[3]);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 
-		const float glyphHeightUV = ((float)OGL_FONT_CHARS_PER_COL)/OGL_FONT_TEXTURE_HEIGHT*2-0.01f;
+	return true;
+}
 
-		float translate = 0.0f;
+void GLFontRenderer::end(bool doOrthoProj)
+{
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	if(doOrthoProj)
+	{
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+	}
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
 
-		float* pVertList = new float[num*3*6];
-    	float* pTextureCoordList = new float[num*2*6];
-		int vertIndex = 0;
-    	int textureCoordIndex = 0;
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_LIGHTING);
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_BLEND);
+}
 
-		float translateDown = 0.0f;
-		unsigned int count = 0;
+unsigned int GLFontRenderer::build(float x, float y, float fontSize, const char* pString, std::vector<float>& glyphs, bool forceMonoSpace, int monoSpaceWidth)
+{
+	x = x*m_screenWidth;
+	y = y*m_screenHeight;
+	fontSize = fontSize*m_screenHeight;
 
-		for(unsigned int i=0;i<num; i++)
-		{
-			const float glyphWidthUV = ((float)OGL_FONT_CHARS_PER_ROW)/OGL_FONT_TEXTURE_WIDTH;
+	const float glyphHeightUV = ((float)OGL_FONT_CHARS_PER_COL)/OGL_FONT_TEXTURE_HEIGHT*2-0.01f;
+	const float glyphWidthUV = ((float)OGL_FONT_CHARS_PER_ROW)/OGL_FONT_TEXTURE_WIDTH;
 
-			if (pString[i] == '\n') {
-				translateDown-=0.005f*m_screenHeight+fontSize;
-				translate = 0.0f;
-				continue;
-			}
+	float translate = 0.0f;
+	float translateDown = 0.0f;
+	unsigned int count = 0;
 
-			int c = pString[i]-OGL_FONT_CHAR_BASE;
-			if (c < OGL_FONT_CHARS_PER_ROW*OGL_FONT_CHARS_PER_COL) {
-
-				count++;
-
-				float glyphWidth = (float)GLFontGlyphWidth[c];
-				if(forceMonoSpace){
-					glyphWidth = (float)monoSpaceWidth;
-				}
-				
-				glyphWidth = glyphWidth*(fontSize/(((float)OGL_FONT_TEXTURE_WIDTH)/OGL_FONT_CHARS_PER_ROW))-0.01f;
-
-				float cxUV = float((c)%OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_ROW+0.008f;
-				float cyUV = float((c)/OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_COL+0.008f;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV+glyphHeightUV;
-				pVertList[vertIndex++] = x+0+translate;
-				pVertList[vertIndex++] = y+0+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV+glyphWidthUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV;
-				pVertList[vertIndex++] = x+fontSize+translate;
-				pVertList[vertIndex++] = y+fontSize+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV;
-				pVertList[vertIndex++] = x+0+translate;
-				pVertList[vertIndex++] = y+fontSize+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV+glyphHeightUV;
-				pVertList[vertIndex++] = x+0+translate;
-				pVertList[vertIndex++] = y+0+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV+glyphWidthUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV+glyphHeightUV;
-				pVertList[vertIndex++] = x+fontSize+translate;
-				pVertList[vertIndex++] = y+0+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV+glyphWidthUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV;
-				pVertList[vertIndex++] = x+fontSize+translate;
-				pVertList[vertIndex++] = y+fontSize+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				translate+=glyphWidth;
-			}
+	unsigned int num = (unsigned int)strlen(pString);
+	glyphs.reserve(glyphs.size()+num*GLYPH_FLOATS);
+
+	for(unsigned int i=0;i<num; i++)
+	{
+		if (pString[i] == '\n') {
+			translateDown-=0.005f*m_screenHeight+fontSize;
+			translate = 0.0f;
+			continue;
 		}
 
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glVertexPointer(3, GL_FLOAT, 0, pVertList);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glTexCoordPointer(2, GL_FLOAT, 0, pTextureCoordList);
-		glDrawArrays(GL_TRIANGLES, 0, count*6);
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDisableClientState(GL_VERTEX_ARRAY);
-
-		delete[] pVertList;
-		delete[] pTextureCoordList;
-
-		if(doOrthoProj)
-		{
-			glMatrixMode(GL_PROJECTION);
-			glPopMatrix();
+		int c = pString[i]-OGL_FONT_CHAR_BASE;
+		if (c < OGL_FONT_CHARS_PER_ROW*OGL_FONT_CHARS_PER_COL) {
+
+			count++;
+
+			float glyphWidth = (float)GLFontGlyphWidth[c];
+			if(forceMonoSpace){
+				glyphWidth = (float)monoSpaceWidth;
+			}
+
+			glyphWidth = glyphWidth*(fontSize/(((float)OGL_FONT_TEXTURE_WIDTH)/OGL_FONT_CHARS_PER_ROW))-0.01f;
+
+			float cxUV = float((c)%OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_ROW+0.008f;
+			float cyUV = float((c)/OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_COL+0.008f;
+
+			float left = x+translate, right = x+fontSize+translate;
+			float bottom = y+translateDown, top = y+fontSize+translateDown;
+
+			// x, y, u, v of the two triangles
+			const float quad[GLYPH_FLOATS] = {
+				left, bottom, cxUV, cyUV+glyphHeightUV,
+				right, top, cxUV+glyphWidthUV, cyUV,
+				left, top, cxUV, cyUV,
+				left, bottom, cxUV, cyUV+glyphHeightUV,
+				right, bottom, cxUV+glyphWidthUV, cyUV+glyphHeightUV,
+				right, top, cxUV+glyphWidthUV, cyUV };
+			glyphs.insert(glyphs.end(), quad, quad+GLYPH_FLOATS);
+
+			translate+=glyphWidth;
 		}
-		glMatrixMode(GL_MODELVIEW);
-		glPopMatrix();
-		
-		glEnable(GL_DEPTH_TEST);
-		glEnable(GL_LIGHTING);
-		glDisable(GL_TEXTURE_2D);	
-		glDisable(GL_BLEND);
+	}
+
+	return count;
+}
+
+void GLFontRenderer::draw(const float* pGlyphs, unsigned int count)
+{
+	glColor4f(m_color[0], m_color[1], m_color[2], m_color[3]);
+
+	glVertexPointer(2, GL_FLOAT, 4*sizeof(float), pGlyphs);
+	glTexCoordPointer(2, GL_FLOAT, 4*sizeof(float), pGlyphs+2);
+	glDrawArrays(GL_TRIANGLES, 0, count*6);
+}
+
+void GLFontRenderer::print(float x, float y, float fontSize, const char* pString, bool forceMonoSpace, int monoSpaceWidth, bool doOrthoProj)
+{
+	// reused between the calls, the text is printed from the rendering thread only
+	static std::vector<float> glyphs;
+
+	glyphs.clear();
+	unsigned int count = build(x, y, fontSize, pString, glyphs, forceMonoSpace, monoSpaceWidth);
+	if(count > 0 && begin(doOrthoProj))
+	{
+		draw(&glyphs.front(), count);
+		end(doOrthoProj);
 	}
 }
 
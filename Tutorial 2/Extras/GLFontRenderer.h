@@ -9,6 +9,8 @@
 #ifndef __GL_FONT_RENDERER__
 #define __GL_FONT_RENDERER__
 
+#include <vector>
+
 class GLFontRenderer{
 	
 private:
@@ -21,7 +23,17 @@ private:
 
 public:
 	
+	// floats of a single glyph: two triangles of x, y, u, v
+	static const unsigned int GLYPH_FLOATS = 6*4;
+
 	static bool init();
+	// sets up the state for drawing the glyphs, returns false when the font texture could not be created
+	static bool begin(bool doOrthoProj=true);
+	static void end(bool doOrthoProj=true);
+	// appends the glyphs of a string in screen pixels, returns the number of glyphs
+	static unsigned int build(float x, float y, float fontSize, const char* pString, std::vector<float>& glyphs, bool forceMonoSpace=false, int monoSpaceWidth=11);
+	// draws glyphs between begin and end (pGlyphs is an offset when a buffer object is bound)
+	static void draw(const float* pGlyphs, unsigned int count);
 	static void print(float x, float y, float fontSize, const char* pString, bool forceMonoSpace=false, int monoSpaceWidth=11, bool doOrthoProj=true);
 	static void setScreenResolution(int screenWidth, int screenHeight);
 	static void setColor(float r, float g, float b, float a);
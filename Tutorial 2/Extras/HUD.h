@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Renderer.h"
+#include "TextGeometry.h"
 #include <string>
 #include <list>
 
@@ -9,17 +10,24 @@ namespace VisualDebugger
 	using namespace std;
 
 	///A single HUD screen
+	///The glyphs are built when the content, the font size or the window size changes and drawn with a single call.
 	class HUDScreen
 	{
 		vector<string> content;
+		Renderer::TextGeometry text;
+		//font size of the built glyphs
+		PxReal text_size;
+		bool text_changed;
 
 	public:
 		int id;
 		PxReal font_size;
 		PxVec3 color;
+		//top of the first line (fraction of the window height)
+		PxReal top;
 
-		HUDScreen(int screen_id, const PxVec3& _color=PxVec3(1.f,1.f,1.f), const PxReal& _font_size=0.024f) :
-			id(screen_id), color(_color), font_size(_font_size)
+		HUDScreen(int screen_id, const PxVec3& _color=PxVec3(1.f,1.f,1.f), const PxReal& _font_size=0.024f, PxReal _top=1.f) :
+			text_size(0.f), text_changed(true), id(screen_id), color(_color), font_size(_font_size), top(_top)
 		{
 		}
 
@@ -27,19 +35,79 @@ namespace VisualDebugger
 		void AddLine(string line)
 		{
 			content.push_back(line);
+			text_changed = true;
 		}
 
-		///Render the screen
+		///Render the screen, call between Renderer::BeginText and Renderer::EndText
 		void Render()
 		{
-			for (unsigned int i = 0; i < content.size(); i++)
-				Renderer::RenderText(content[i], PxVec2(0.0, 1.f-(i+1)*font_size), color, font_size);
+			if (text_changed || (text_size != font_size) || text.Resized())
+			{
+				text.Clear();
+				for (unsigned int i = 0; i < content.size(); i++)
+					text.Add(content[i], PxVec2(0.0, top-(i+1)*font_size), font_size);
+				text_size = font_size;
+				text_changed = false;
+			}
+
+			text.Draw(color);
 		}
 
 		///Clear content of the screen
 		void Clear()
 		{
 			content.clear();
+			text_changed = true;
+		}
+	};
+
+	///Rolling history of a single value, drawn as a line graph next to the text of a screen
+	class HUDGraph
+	{
+		vector<PxReal> samples;
+		//index of the next sample and number of valid samples
+		PxU32 next, count;
+
+	public:
+		HUDGraph(PxU32 capacity=300) : samples(capacity, 0.f), next(0), count(0)
+		{
+		}
+
+		///Add a sample, the oldest one is dropped when the history is full
+		void Add(PxReal value)
+		{
+			samples[next] = value;
+			next = (next + 1) % samples.size();
+			count = PxMin(count + 1, (PxU32)samples.size());
+		}
+
+		///Average of the last n samples
+		PxReal Average(PxU32 n) const
+		{
+			n = PxMin(n, count);
+			PxReal sum = 0.f;
+			for (PxU32 i = 1; i <= n; i++)
+				sum += samples[(next + samples.size() - i) % samples.size()];
+			return n ? sum / n : 0.f;
+		}
+
+		///Number of samples kept
+		PxU32 Capacity() const { return (PxU32)samples.size(); }
+
+		///Largest sample of the history
+		PxReal Max() const
+		{
+			PxReal value = 0.f;
+			for (PxU32 i = 0; i < count; i++)
+				value = PxMax(value, samples[(next + samples.size() - 1 - i) % samples.size()]);
+			return value;
+		}
+
+		///Draw the history scaled to max_value, location and size are fractions of the window
+		void Render(PxReal max_value, const PxVec2& location, const PxVec2& size, const PxVec3& color, bool background=true) const
+		{
+			PxU32 first = (next + (PxU32)samples.size() - count) % samples.size();
+			Renderer::RenderGraph(&samples.front(), count, first, (PxU32)samples.size(), max_value, location, size, color, background);
 		}
 	};
 
@@ -160,7 +228,12 @@ namespace VisualDebugger
 			{
 				if (screens[i]->id == active_screen)
 				{
-					screens[i]->Render();
+					//the text state is set once for the whole screen
+					if (Renderer::BeginText())
+					{
+						screens[i]->Render();
+						Renderer::EndText();
+					}
 					return;
 				}
 			}
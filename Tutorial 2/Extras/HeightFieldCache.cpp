@@ -0,0 +1,304 @@
+#include "HeightFieldCache.h"
+#include "Culling.h"
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace GLExtensions;
+
+		void HeightFieldTile::Upload()
+		{
+			if (!HasBuffers() || vertices.empty() || indices.empty())
+				return;
+
+			GenBuffers(1, &vertex_buffer);
+			BindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+			BufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(MeshVertex), &vertices.front(), GL_STATIC_DRAW);
+			BindBuffer(GL_ARRAY_BUFFER, 0);
+
+			GenBuffers(1, &index_buffer);
+			BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+			BufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(GLuint), &indices.front(), GL_STATIC_DRAW);
+			BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		}
+
+		void HeightFieldTile::Release()
+		{
+			if (vertex_buffer)
+				DeleteBuffers(1, &vertex_buffer);
+			if (index_buffer)
+				DeleteBuffers(1, &index_buffer);
+			vertex_buffer = index_buffer = 0;
+		}
+
+		void HeightFieldTile::Draw(PxU32 level) const
+		{
+			GLsizei count = (GLsizei)(levels[level+1] - levels[level]);
+			if (!count)
+				return;
+
+			//offsets into the bound buffers or pointers into the client side arrays
+			const char* vertex_data = vertex_buffer ? 0 : (const char*)&vertices.front();
+			const GLuint* index_data = (index_buffer ? 0 : &indices.front()) + levels[level];
+
+			if (vertex_buffer)
+			{
+				BindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+				BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+			}
+
+			glVertexPointer(3, GL_FLOAT, sizeof(MeshVertex), vertex_data);
+			glNormalPointer(GL_FLOAT, sizeof(MeshVertex), vertex_data + sizeof(PxVec3));
+			glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, index_data);
+		}
+
+		///Rows or columns of a tile sampled by a level of detail, the last one is always included
+		static void LevelSamples(PxU32 cells, PxU32 step, std::vector<PxU32>& samples)
+		{
+			samples.clear();
+			for (PxU32 i = 0; i < cells; i += step)
+				samples.push_back(i);
+			samples.push_back(cells);
+		}
+
+		///Two triangles of a skirt segment, top vertices t0, t1 and the ones hanging below them s0, s1
+		static void AddSkirt(std::vector<GLuint>& indices, GLuint t0, GLuint t1, GLuint s0, GLuint s1, bool flip)
+		{
+			GLuint quad[2][3] = { { t0, s0, t1 }, { t1, s0, s1 } };
+			for (PxU32 i = 0; i < 2; i++)
+			{
+				indices.push_back(quad[i][0]);
+				indices.push_back(flip ? quad[i][2] : quad[i][1]);
+				indices.push_back(flip ? quad[i][1] : quad[i][2]);
+			}
+		}
+
+		HeightFieldCache::~HeightFieldCache()
+		{
+			//the GL context and PhysX are gone at this point, free the CPU copies only
+			for (std::map<const PxBase*, Entry*>::iterator it = fields.begin(); it != fields.end(); ++it)
+				delete it->second;
+		}
+
+		HeightFieldCache::Entry* HeightFieldCache::Get(const PxHeightFieldGeometry& geometry)
+		{
+			const PxHeightField* field = geometry.heightField;
+			std::map<const PxBase*, Entry*>::iterator it = fields.find(field);
+			if (it != fields.end())
+			{
+				Entry* entry = it->second;
+				//the same heightfield can be shared by shapes with different scales
+				if ((entry->height_scale == geometry.heightScale) && (entry->row_scale == geometry.rowScale) && (entry->column_scale == geometry.columnScale))
+					return entry;
+
+				Release(entry);
+				fields.erase(it);
+			}
+
+			if (!listening)
+			{
+				PxGetPhysics().registerDeletionListener(*this, PxDeletionEventFlag::eMEMORY_RELEASE);
+				listening = true;
+			}
+
+			const PxU32 rows = field->getNbRows();
+			const PxU32 columns = field->getNbColumns();
+			std::vector<PxHeightFieldSample> samples(rows*columns);
+			field->saveCells(&samples.front(), (PxU32)(samples.size()*sizeof(PxHeightFieldSample)));
+
+			Entry* entry = new Entry();
+			entry->height_scale = geometry.heightScale;
+			entry->row_scale = geometry.rowScale;
+			entry->column_scale = geometry.columnScale;
+			entry->tile_size = TILE_CELLS * PxMax(geometry.rowScale, geometry.columnScale);
+
+			std::vector<PxU32> row_samples, column_samples;
+			for (PxU32 r0 = 0; r0 + 1 < rows; r0 += TILE_CELLS)
+			{
+				for (PxU32 c0 = 0; c0 + 1 < columns; c0 += TILE_CELLS)
+				{
+					entry->tiles.push_back(HeightFieldTile());
+					HeightFieldTile& tile = entry->tiles.back();
+					const PxU32 tile_rows = PxMin(TILE_CELLS, rows - 1 - r0);
+					const PxU32 tile_columns = PxMin(TILE_CELLS, columns - 1 - c0);
+					const PxU32 stride = tile_columns + 1;
+
+					//grid vertices, the normals come from the central differences of the whole heightfield
+					tile.bounds = PxBounds3::empty();
+					for (PxU32 i = 0; i <= tile_rows; i++)
+					{
+						for (PxU32 j = 0; j <= tile_columns; j++)
+						{
+							PxU32 r = r0 + i, c = c0 + j;
+							PxReal dr = (PxReal)(samples[PxMin(r+1, rows-1)*columns + c].height - samples[(r ? r-1 : 0)*columns + c].height) / (PxReal)(PxMin(r+1, rows-1) - (r ? r-1 : 0));
+							PxReal dc = (PxReal)(samples[r*columns + PxMin(c+1, columns-1)].height - samples[r*columns + (c ? c-1 : 0)].height) / (PxReal)(PxMin(c+1, columns-1) - (c ? c-1 : 0));
+							PxReal a = dc * geometry.heightScale, b = dr * geometry.heightScale;
+
+							MeshVertex vertex;
+							vertex.position = PxVec3(r*geometry.rowScale, samples[r*columns + c].height*geometry.heightScale, c*geometry.columnScale);
+							vertex.normal = PxVec3(-geometry.columnScale*b, geometry.columnScale*geometry.rowScale, -a*geometry.rowScale).getNormalized();
+							tile.vertices.push_back(vertex);
+							tile.bounds.include(vertex.position);
+						}
+					}
+
+					//skirts deep enough to cover the largest gap a coarser neighbour can leave
+					PxReal depth = PxMax(tile.bounds.maximum.y - tile.bounds.minimum.y, PxMax(geometry.rowScale, geometry.columnScale));
+					GLuint skirt[4];
+					for (PxU32 edge = 0; edge < 4; edge++)
+					{
+						skirt[edge] = (GLuint)tile.vertices.size();
+						//first and last row along the columns, first and last column along the rows
+						PxU32 count = (edge < 2) ? tile_columns : tile_rows;
+						for (PxU32 k = 0; k <= count; k++)
+						{
+							PxU32 index = (edge == 0) ? k : (edge == 1) ? tile_rows*stride + k : (edge == 2) ? k*stride : k*stride + tile_columns;
+							MeshVertex vertex = tile.vertices[index];
+							vertex.position.y -= depth;
+							tile.vertices.push_back(vertex);
+						}
+					}
+					tile.bounds.minimum.y -= depth;
+
+					for (PxU32 level = 0; level < LEVELS; level++)
+					{
+						tile.levels.push_back((GLuint)tile.indices.size());
+						LevelSamples(tile_rows, 1 << level, row_samples);
+						LevelSamples(tile_columns, 1 << level, column_samples);
+
+						//two counter clockwise (seen from above) triangles per sampled cell
+						for (PxU32 i = 0; i + 1 < row_samples.size(); i++)
+						{
+							for (PxU32 j = 0; j + 1 < column_samples.size(); j++)
+							{
+								GLuint a = row_samples[i]*stride + column_samples[j];
+								GLuint b = row_samples[i+1]*stride + column_samples[j];
+								GLuint c = row_samples[i]*stride + column_samples[j+1];
+								GLuint d = row_samples[i+1]*stride + column_samples[j+1];
+								tile.indices.push_back(a); tile.indices.push_back(c); tile.indices.push_back(b);
+								tile.indices.push_back(b); tile.indices.push_back(c); tile.indices.push_back(d);
+							}
+						}
+
+						//outward facing skirts
+						for (PxU32 j = 0; j + 1 < column_samples.size(); j++)
+						{
+							GLuint k0 = column_samples[j], k1 = column_samples[j+1];
+							AddSkirt(tile.indices, k0, k1, skirt[0] + k0, skirt[0] + k1, false);
+							AddSkirt(tile.indices, tile_rows*stride + k0, tile_rows*stride + k1, skirt[1] + k0, skirt[1] + k1, true);
+						}
+						for (PxU32 i = 0; i + 1 < row_samples.size(); i++)
+						{
+							GLuint k0 = row_samples[i], k1 = row_samples[i+1];
+							AddSkirt(tile.indices, k0*stride, k1*stride, skirt[2] + k0, skirt[2] + k1, true);
+							AddSkirt(tile.indices, k0*stride + tile_columns, k1*stride + tile_columns, skirt[3] + k0, skirt[3] + k1, false);
+						}
+					}
+					tile.levels.push_back((GLuint)tile.indices.size());
+
+					tile.Upload();
+				}
+			}
+
+			fields[field] = entry;
+			return entry;
+		}
+
+		void HeightFieldCache::Draw(const PxHeightFieldGeometry& geometry, PxU32& drawn, PxU32& culled)
+		{
+			Entry* entry = Get(geometry);
+
+			//the view frustum and the camera in the space of the heightfield
+			PxReal modelview[16], projection[16];
+			glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+			glGetFloatv(GL_PROJECTION_MATRIX, projection);
+			PxMat44 view(modelview);
+			Frustum frustum;
+			frustum.Set(PxMat44(projection) * view);
+			PxVec3 eye = -PxVec3(view.column0.getXYZ().dot(view.column3.getXYZ()), view.column1.getXYZ().dot(view.column3.getXYZ()), view.column2.getXYZ().dot(view.column3.getXYZ()));
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+
+			for (PxU32 i = 0; i < entry->tiles.size(); i++)
+			{
+				const HeightFieldTile& tile = entry->tiles[i];
+				if (frustum.Test(tile.bounds) == Frustum::OUTSIDE)
+				{
+					culled++;
+					continue;
+				}
+				drawn++;
+
+				//full detail up to two tiles away, every next level covers twice the distance of the previous one
+				PxVec3 nearest = eye.maximum(tile.bounds.minimum).minimum(tile.bounds.maximum);
+				PxReal distance = (nearest - eye).magnitude();
+				PxReal range = entry->tile_size*2.f;
+				PxU32 level = 0;
+				while ((level + 1 < LEVELS) && (distance > range))
+				{
+					level++;
+					range *= 2.f;
+				}
+
+				tile.Draw(level);
+			}
+
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+
+			if (HasBuffers())
+			{
+				BindBuffer(GL_ARRAY_BUFFER, 0);
+				BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			}
+		}
+
+		void HeightFieldCache::Release(Entry* entry)
+		{
+			for (PxU32 i = 0; i < entry->tiles.size(); i++)
+				entry->tiles[i].Release();
+			delete entry;
+		}
+
+		void HeightFieldCache::Flush()
+		{
+			std::vector<const PxBase*> evict;
+			{
+				std::lock_guard<std::mutex> lock(released_mutex);
+				evict.swap(released);
+			}
+
+			for (PxU32 i = 0; i < evict.size(); i++)
+			{
+				std::map<const PxBase*, Entry*>::iterator it = fields.find(evict[i]);
+				if (it != fields.end())
+				{
+					Release(it->second);
+					fields.erase(it);
+				}
+			}
+		}
+
+		void HeightFieldCache::Clear()
+		{
+			for (std::map<const PxBase*, Entry*>::iterator it = fields.begin(); it != fields.end(); ++it)
+				Release(it->second);
+			fields.clear();
+
+			std::lock_guard<std::mutex> lock(released_mutex);
+			released.clear();
+		}
+
+		void HeightFieldCache::onRelease(const PxBase* observed, void* userData, PxDeletionEventFlag::Enum deletionEvent)
+		{
+			//the listener sees every PhysX object, only heightfields can be cached
+			if (observed->getConcreteType() != PxConcreteType::eHEIGHTFIELD)
+				return;
+
+			std::lock_guard<std::mutex> lock(released_mutex);
+			released.push_back(observed);
+		}
+	}
+}
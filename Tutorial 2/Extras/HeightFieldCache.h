@@ -0,0 +1,88 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "GLExtensions.h"
+#include "MeshCache.h"
+#include <map>
+#include <vector>
+#include <mutex>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///Square piece of a heightfield with its own buffers
+		///
+		///All levels of detail share the vertices: level n uses every 2^n-th row and column of the tile.
+		///Skirts hanging down from the tile edges hide the cracks between neighbours drawn at different levels.
+		class HeightFieldTile
+		{
+		public:
+			std::vector<MeshVertex> vertices;
+			std::vector<GLuint> indices;
+			//first index of every level of detail, the last entry is the total index count
+			std::vector<GLuint> levels;
+			//local bounds of the tile
+			PxBounds3 bounds;
+			GLuint vertex_buffer, index_buffer;
+
+			HeightFieldTile() : vertex_buffer(0), index_buffer(0) {}
+
+			///Copy the vertex and index data into buffer objects
+			void Upload();
+
+			///Release the buffer objects
+			void Release();
+
+			///Draw a single level of detail, the vertex and normal arrays have to be enabled
+			void Draw(PxU32 level) const;
+		};
+
+		///Render data of the heightfields, built on first use and kept until PhysX frees them
+		///
+		///The heightfield is drawn tile by tile: the tiles outside of the view are skipped and the
+		///distant ones use coarser levels of detail. See MeshCache for the eviction of released heightfields.
+		class HeightFieldCache : public PxDeletionListener
+		{
+			struct Entry
+			{
+				PxReal height_scale, row_scale, column_scale;
+				//edge length of a whole tile, the ranges of the levels of detail are multiples of it
+				PxReal tile_size;
+				std::vector<HeightFieldTile> tiles;
+			};
+
+			std::map<const PxBase*, Entry*> fields;
+			std::vector<const PxBase*> released;
+			std::mutex released_mutex;
+			bool listening;
+
+			Entry* Get(const PxHeightFieldGeometry& geometry);
+			void Release(Entry* entry);
+
+		public:
+			///Rows and columns of cells per tile
+			static const PxU32 TILE_CELLS = 32;
+			///Number of levels of detail, the cells of level n are 2^n times larger
+			static const PxU32 LEVELS = 4;
+
+			HeightFieldCache() : listening(false) {}
+
+			~HeightFieldCache();
+
+			///Draw a heightfield with the current GL matrices (modelview in the heightfield space)
+			///The drawn and the culled tiles are added to the counters.
+			void Draw(const PxHeightFieldGeometry& geometry, PxU32& drawn, PxU32& culled);
+
+			///Evict the heightfields released since the last call (rendering thread)
+			void Flush();
+
+			///Evict all heightfields
+			void Clear();
+
+			virtual void onRelease(const PxBase* observed, void* userData, PxDeletionEventFlag::Enum deletionEvent);
+		};
+	}
+}
@@ -0,0 +1,270 @@
+#include "MeshCache.h"
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace GLExtensions;
+
+		void MeshBuffer::Upload()
+		{
+			if (!HasBuffers() || vertices.empty() || indices.empty())
+				return;
+
+			GenBuffers(1, &vertex_buffer);
+			BindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+			BufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(MeshVertex), &vertices.front(), GL_STATIC_DRAW);
+			BindBuffer(GL_ARRAY_BUFFER, 0);
+
+			GenBuffers(1, &index_buffer);
+			BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+			BufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(GLuint), &indices.front(), GL_STATIC_DRAW);
+			BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		}
+
+		void MeshBuffer::Release()
+		{
+			if (vertex_buffer)
+				DeleteBuffers(1, &vertex_buffer);
+			if (index_buffer)
+				DeleteBuffers(1, &index_buffer);
+			vertex_buffer = index_buffer = 0;
+		}
+
+		void MeshBuffer::Draw() const
+		{
+			if (indices.empty())
+				return;
+
+			//offsets into the bound buffers or pointers into the client side arrays
+			const char* vertex_data = vertex_buffer ? 0 : (const char*)&vertices.front();
+			const GLuint* index_data = index_buffer ? 0 : &indices.front();
+
+			if (vertex_buffer)
+			{
+				BindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+				BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+			}
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(MeshVertex), vertex_data);
+			glNormalPointer(GL_FLOAT, sizeof(MeshVertex), vertex_data + sizeof(PxVec3));
+			glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, index_data);
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+
+			if (vertex_buffer)
+			{
+				BindBuffer(GL_ARRAY_BUFFER, 0);
+				BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			}
+		}
+
+		MeshCache::~MeshCache()
+		{
+			//the GL context and PhysX are gone at this point, free the CPU copies only
+			for (std::map<const PxBase*, MeshBuffer*>::iterator it = meshes.begin(); it != meshes.end(); ++it)
+				delete it->second;
+		}
+
+		MeshBuffer* MeshCache::Find(const PxBase* mesh) const
+		{
+			std::map<const PxBase*, MeshBuffer*>::const_iterator it = meshes.find(mesh);
+			return (it == meshes.end()) ? 0 : it->second;
+		}
+
+		MeshBuffer* MeshCache::Insert(const PxBase* mesh, MeshBuffer* buffer)
+		{
+			if (!listening)
+			{
+				PxGetPhysics().registerDeletionListener(*this, PxDeletionEventFlag::eMEMORY_RELEASE);
+				listening = true;
+			}
+
+			buffer->Upload();
+			meshes[mesh] = buffer;
+			return buffer;
+		}
+
+		MeshBuffer* MeshCache::Get(const PxConvexMesh* mesh)
+		{
+			MeshBuffer* buffer = Find(mesh);
+			if (buffer)
+				return buffer;
+
+			buffer = new MeshBuffer();
+			const PxVec3* verts = mesh->getVertices();
+			const PxU8* indicies = mesh->getIndexBuffer();
+
+			//vertices are duplicated per polygon to keep the faces flat shaded
+			for (PxU32 i = 0; i < mesh->getNbPolygons(); i++)
+			{
+				PxHullPolygon face;
+				if (!mesh->getPolygonData(i, face))
+					continue;
+
+				GLuint first = (GLuint)buffer->vertices.size();
+				const PxU8* faceIdx = indicies + face.mIndexBase;
+				for (PxU32 j = 0; j < face.mNbVerts; j++)
+				{
+					MeshVertex vertex;
+					vertex.position = verts[faceIdx[j]];
+					vertex.normal = PxVec3(face.mPlane[0], face.mPlane[1], face.mPlane[2]);
+					buffer->vertices.push_back(vertex);
+				}
+
+				//polygons are convex, so a fan covers them
+				for (PxU32 j = 2; j < face.mNbVerts; j++)
+				{
+					buffer->indices.push_back(first);
+					buffer->indices.push_back(first + j - 1);
+					buffer->indices.push_back(first + j);
+				}
+			}
+
+			return Insert(mesh, buffer);
+		}
+
+		MeshBuffer* MeshCache::Get(const PxTriangleMesh* mesh)
+		{
+			MeshBuffer* buffer = Find(mesh);
+			if (buffer)
+				return buffer;
+
+			buffer = new MeshBuffer();
+			const PxVec3* verts = mesh->getVertices();
+			const PxU32 num_verts = mesh->getNbVertices();
+			const PxU32 num_indices = mesh->getNbTriangles()*3;
+			std::vector<GLuint>& indices = buffer->indices;
+			std::vector<MeshVertex>& vertices = buffer->vertices;
+
+			//cooking stores 16 bit indices for meshes with less than 65536 vertices
+			indices.resize(num_indices);
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+			if (mesh->getTriangleMeshFlags() & PxTriangleMeshFlag::eHAS_16BIT_TRIANGLE_INDICES)
+#else
+			if (mesh->getTriangleMeshFlags() & PxTriangleMeshFlag::e16_BIT_INDICES)
+#endif
+			{
+				const PxU16* trigs = (const PxU16*)mesh->getTriangles();
+				for (PxU32 i = 0; i < num_indices; i++)
+					indices[i] = trigs[i];
+			}
+			else
+			{
+				const PxU32* trigs = (const PxU32*)mesh->getTriangles();
+				for (PxU32 i = 0; i < num_indices; i++)
+					indices[i] = trigs[i];
+			}
+
+			if (smooth_normals)
+			{
+				//vertex normals are the sums of the (area weighted) face normals around them
+				vertices.resize(num_verts);
+				for (PxU32 i = 0; i < num_verts; i++)
+				{
+					vertices[i].position = verts[i];
+					vertices[i].normal = PxVec3(0.f, 0.f, 0.f);
+				}
+
+				for (PxU32 i = 0; i < num_indices; i+=3)
+				{
+					PxVec3 n = (verts[indices[i+1]]-verts[indices[i]]).cross(verts[indices[i+2]]-verts[indices[i]]);
+					for (PxU32 j = 0; j < 3; j++)
+						vertices[indices[i+j]].normal += n;
+				}
+
+				for (PxU32 i = 0; i < num_verts; i++)
+				{
+					if (vertices[i].normal.isZero())
+						vertices[i].normal = PxVec3(0.f, 1.f, 0.f);
+					else
+						vertices[i].normal.normalize();
+				}
+			}
+			else
+			{
+				//one flat shaded triangle per face
+				vertices.resize(num_indices);
+				for (PxU32 i = 0; i < num_indices; i+=3)
+				{
+					PxVec3 v0 = verts[indices[i]];
+					PxVec3 v1 = verts[indices[i+1]];
+					PxVec3 v2 = verts[indices[i+2]];
+					PxVec3 n = (v1-v0).cross(v2-v0);
+					n.normalize();
+
+					for (PxU32 j = 0; j < 3; j++)
+					{
+						vertices[i+j].normal = n;
+						indices[i+j] = i+j;
+					}
+					vertices[i].position = v0;
+					vertices[i+1].position = v1;
+					vertices[i+2].position = v2;
+				}
+			}
+
+			return Insert(mesh, buffer);
+		}
+
+		void MeshCache::SmoothNormals(bool value)
+		{
+			if (value == smooth_normals)
+				return;
+
+			//the convex meshes are rebuilt as well, they do not change
+			smooth_normals = value;
+			Clear();
+		}
+
+		void MeshCache::Flush()
+		{
+			std::vector<const PxBase*> evict;
+			{
+				std::lock_guard<std::mutex> lock(released_mutex);
+				evict.swap(released);
+			}
+
+			for (PxU32 i = 0; i < evict.size(); i++)
+			{
+				std::map<const PxBase*, MeshBuffer*>::iterator it = meshes.find(evict[i]);
+				if (it != meshes.end())
+				{
+					it->second->Release();
+					delete it->second;
+					meshes.erase(it);
+				}
+			}
+		}
+
+		void MeshCache::Clear()
+		{
+			for (std::map<const PxBase*, MeshBuffer*>::iterator it = meshes.begin(); it != meshes.end(); ++it)
+			{
+				it->second->Release();
+				delete it->second;
+			}
+			meshes.clear();
+
+			std::lock_guard<std::mutex> lock(released_mutex);
+			released.clear();
+		}
+
+		void MeshCache::onRelease(const PxBase* observed, void* userData, PxDeletionEventFlag::Enum deletionEvent)
+		{
+			//the listener sees every PhysX object, only meshes can be cached
+			PxU16 type = observed->getConcreteType();
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+			if ((type != PxConcreteType::eCONVEX_MESH) && (type != PxConcreteType::eTRIANGLE_MESH))
+#else
+			if ((type != PxConcreteType::eCONVEX_MESH) && (type != PxConcreteType::eTRIANGLE_MESH_BVH33) && (type != PxConcreteType::eTRIANGLE_MESH_BVH34))
+#endif
+				return;
+
+			std::lock_guard<std::mutex> lock(released_mutex);
+			released.push_back(observed);
+		}
+	}
+}
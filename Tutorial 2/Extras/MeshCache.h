@@ -0,0 +1,89 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "GLExtensions.h"
+#include <map>
+#include <vector>
+#include <mutex>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///Interleaved vertex of a cached mesh
+		struct MeshVertex
+		{
+			PxVec3 position;
+			PxVec3 normal;
+		};
+
+		///Render ready copy of a convex or triangle mesh
+		///
+		///The data is kept in buffer objects when the driver supports them and in client side arrays otherwise.
+		class MeshBuffer
+		{
+		public:
+			std::vector<MeshVertex> vertices;
+			std::vector<GLuint> indices;
+			GLuint vertex_buffer, index_buffer;
+
+			MeshBuffer() : vertex_buffer(0), index_buffer(0) {}
+
+			///Copy the vertex and index data into buffer objects
+			void Upload();
+
+			///Release the buffer objects
+			void Release();
+
+			///Draw all triangles with a single call
+			void Draw() const;
+		};
+
+		///Meshes converted once on first use and kept until PhysX frees them
+		///
+		///PhysX reports the released meshes through PxDeletionListener (possibly from another thread);
+		///the GL buffers are released by Flush on the rendering thread.
+		class MeshCache : public PxDeletionListener
+		{
+			std::map<const PxBase*, MeshBuffer*> meshes;
+			std::vector<const PxBase*> released;
+			std::mutex released_mutex;
+			bool listening;
+			bool smooth_normals;
+
+			MeshBuffer* Find(const PxBase* mesh) const;
+			MeshBuffer* Insert(const PxBase* mesh, MeshBuffer* buffer);
+
+		public:
+			MeshCache() : listening(false), smooth_normals(false) {}
+
+			~MeshCache();
+
+			///Get the render data for a convex mesh, one flat shaded triangle fan per polygon
+			MeshBuffer* Get(const PxConvexMesh* mesh);
+
+			///Get the render data for a triangle mesh (16 or 32 bit indices)
+			///Smooth normals share the mesh vertices, flat normals need a copy of the vertices per triangle.
+			MeshBuffer* Get(const PxTriangleMesh* mesh);
+
+			///Smooth or flat normals of triangle meshes (flat by default), the cache is cleared when the value changes
+			void SmoothNormals(bool value);
+
+			///Get smooth normals
+			bool SmoothNormals() const { return smooth_normals; }
+
+			///Evict the meshes released since the last call (rendering thread)
+			void Flush();
+
+			///Evict all meshes
+			void Clear();
+
+			///Number of cached meshes
+			size_t Size() const { return meshes.size(); }
+
+			virtual void onRelease(const PxBase* observed, void* userData, PxDeletionEventFlag::Enum deletionEvent);
+		};
+	}
+}
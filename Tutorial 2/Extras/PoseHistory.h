@@ -0,0 +1,124 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+
+///Poses of the dynamic actors before and after the last simulation step
+///
+///The simulation advances in fixed steps while the frames are rendered in between: the renderer blends
+///the two poses by the fraction of the step elapsed since, so the motion is smooth at any display rate.
+///Entries are evicted through PxDeletionListener when the actor is released, see MeshCache.
+class PoseHistory : public physx::PxDeletionListener
+{
+	struct Entry
+	{
+		physx::PxTransform previous, current;
+	};
+
+	std::unordered_map<const physx::PxBase*, Entry> poses;
+	std::vector<physx::PxRigidActor*> actors;
+	std::vector<const physx::PxBase*> released;
+	std::mutex released_mutex;
+	bool listening;
+
+	//shortest arc interpolation, normalized lerp for nearly equal rotations
+	static physx::PxQuat Slerp(const physx::PxQuat& from, physx::PxQuat to, physx::PxReal t)
+	{
+		physx::PxReal cosine = from.dot(to);
+		if (cosine < 0.f)
+		{
+			to = -to;
+			cosine = -cosine;
+		}
+		if (cosine > .9995f)
+			return (from*(1.f - t) + to*t).getNormalized();
+
+		physx::PxReal angle = physx::PxAcos(cosine);
+		physx::PxReal sine = physx::PxSin(angle);
+		return from*(physx::PxSin((1.f - t)*angle) / sine) + to*(physx::PxSin(t*angle) / sine);
+	}
+
+public:
+	PoseHistory() : listening(false) {}
+
+	//the scenes go before the SDK
+	~PoseHistory()
+	{
+		if (listening)
+			physx::PxGetPhysics().unregisterDeletionListener(*this);
+	}
+
+	///Store the poses of all dynamic actors, call after every simulation step
+	void Update(physx::PxScene* scene)
+	{
+		if (!listening)
+		{
+			physx::PxGetPhysics().registerDeletionListener(*this, physx::PxDeletionEventFlag::eMEMORY_RELEASE);
+			listening = true;
+		}
+
+		//an actor address can be reused, a new actor must not blend from the pose of a removed one
+		{
+			std::lock_guard<std::mutex> lock(released_mutex);
+			for (size_t i = 0; i < released.size(); i++)
+				poses.erase(released[i]);
+			released.clear();
+		}
+
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+		actors.resize(scene->getNbActors(physx::PxActorTypeSelectionFlag::eRIGID_DYNAMIC));
+		if (actors.size())
+			scene->getActors(physx::PxActorTypeSelectionFlag::eRIGID_DYNAMIC, (physx::PxActor**)&actors.front(), (physx::PxU32)actors.size());
+#else
+		actors.resize(scene->getNbActors(physx::PxActorTypeFlag::eRIGID_DYNAMIC));
+		if (actors.size())
+			scene->getActors(physx::PxActorTypeFlag::eRIGID_DYNAMIC, (physx::PxActor**)&actors.front(), (physx::PxU32)actors.size());
+#endif
+
+		for (size_t i = 0; i < actors.size(); i++)
+		{
+			physx::PxTransform pose = actors[i]->getGlobalPose();
+			std::pair<std::unordered_map<const physx::PxBase*, Entry>::iterator, bool> it =
+				poses.insert(std::make_pair((const physx::PxBase*)actors[i], Entry()));
+			Entry& entry = it.first->second;
+			//new actors appear at their current pose
+			entry.previous = it.second ? pose : entry.current;
+			entry.current = pose;
+		}
+	}
+
+	///Pose of an actor alpha (0 to 1) of the way from the previous to the current step
+	///Returns false and leaves the pose as it is when the actor is not a tracked dynamic actor.
+	bool Get(const physx::PxRigidActor* actor, physx::PxReal alpha, physx::PxTransform& pose) const
+	{
+		std::unordered_map<const physx::PxBase*, Entry>::const_iterator it = poses.find(actor);
+		if (it == poses.end())
+			return false;
+
+		const Entry& entry = it->second;
+		pose.p = entry.previous.p + (entry.current.p - entry.previous.p)*alpha;
+		pose.q = Slerp(entry.previous.q, entry.current.q, alpha);
+		return true;
+	}
+
+	///Forget all poses, e.g. when the scene is recreated
+	void Clear()
+	{
+		poses.clear();
+
+		std::lock_guard<std::mutex> lock(released_mutex);
+		released.clear();
+	}
+
+	virtual void onRelease(const physx::PxBase* observed, void* userData, physx::PxDeletionEventFlag::Enum deletionEvent)
+	{
+		//the listener sees every PhysX object, only dynamic actors are tracked
+		if (observed->getConcreteType() != physx::PxConcreteType::eRIGID_DYNAMIC)
+			return;
+
+		std::lock_guard<std::mutex> lock(released_mutex);
+		released.push_back(observed);
+	}
+};
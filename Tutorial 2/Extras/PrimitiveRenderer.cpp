@@ -0,0 +1,305 @@
+#include "PrimitiveRenderer.h"
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace GLExtensions;
+
+		//generic attribute locations of the instance data, above the ones aliased by gl_Vertex, gl_Normal and gl_Color
+		static const GLuint instance_location = 8;
+		static const char* instance_attributes[] = { "pose0", "pose1", "pose2", "scale", "color" };
+
+		static const char* vertex_shader =
+			"#version 120\n"
+			"attribute vec4 pose0;\n"
+			"attribute vec4 pose1;\n"
+			"attribute vec4 pose2;\n"
+			"attribute vec4 scale;\n"
+			"attribute vec4 color;\n"
+			"uniform mat4 shadow_matrix;\n"
+			"varying vec3 normal;\n"
+			"varying vec4 base_color;\n"
+			"void main()\n"
+			"{\n"
+			"	vec4 p = vec4(gl_Vertex.xyz*scale.xyz + vec3(gl_Vertex.w*scale.w, 0.0, 0.0), 1.0);\n"
+			"	vec4 world = vec4(dot(pose0, p), dot(pose1, p), dot(pose2, p), 1.0);\n"
+			"	vec3 n = gl_Normal/scale.xyz;\n"
+			"	normal = normalize(gl_NormalMatrix*vec3(dot(pose0.xyz, n), dot(pose1.xyz, n), dot(pose2.xyz, n)));\n"
+			"	base_color = color;\n"
+			"	gl_Position = gl_ModelViewProjectionMatrix*(shadow_matrix*world);\n"
+			"}\n";
+
+		//same terms as the fixed-function light 0 with color material, without the (tiny) specular term
+		static const char* fragment_shader =
+			"#version 120\n"
+			"uniform vec4 shadow_color;\n"
+			"varying vec3 normal;\n"
+			"varying vec4 base_color;\n"
+			"void main()\n"
+			"{\n"
+			"	if (shadow_color.a > 0.0)\n"
+			"	{\n"
+			"		gl_FragColor = vec4(shadow_color.rgb, 1.0);\n"
+			"		return;\n"
+			"	}\n"
+			"	vec3 light = normalize(gl_LightSource[0].position.xyz);\n"
+			"	float diffuse = max(dot(normalize(normal), light), 0.0);\n"
+			"	vec3 ambient = gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb;\n"
+			"	gl_FragColor = vec4(base_color.rgb*(ambient + gl_LightSource[0].diffuse.rgb*diffuse), base_color.a);\n"
+			"}\n";
+
+		static const PxReal identity_matrix[] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+
+		bool PrimitiveRenderer::Init(int render_detail)
+		{
+			if (!HasInstancing())
+				return false;
+
+			program = BuildProgram(vertex_shader, fragment_shader, instance_attributes, 5, instance_location);
+			if (!program)
+				return false;
+
+			shadow_matrix_location = GetUniformLocation(program, "shadow_matrix");
+			shadow_color_location = GetUniformLocation(program, "shadow_color");
+
+			for (PxU32 i = 0; i < TYPE_COUNT; i++)
+				for (PxU32 j = 0; j < LOD_TIERS; j++)
+					GenBuffers(1, &primitives[i][j].instance_buffer);
+
+			BuildBox();
+			Detail(render_detail);
+			return true;
+		}
+
+		void PrimitiveRenderer::Upload(Primitive& primitive, const std::vector<PrimitiveVertex>& vertices, const std::vector<GLuint>& indices)
+		{
+			if (!primitive.vertex_buffer)
+				GenBuffers(1, &primitive.vertex_buffer);
+			if (!primitive.index_buffer)
+				GenBuffers(1, &primitive.index_buffer);
+
+			BindBuffer(GL_ARRAY_BUFFER, primitive.vertex_buffer);
+			BufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(PrimitiveVertex), &vertices.front(), GL_STATIC_DRAW);
+			BindBuffer(GL_ARRAY_BUFFER, 0);
+
+			BindBuffer(GL_ELEMENT_ARRAY_BUFFER, primitive.index_buffer);
+			BufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(GLuint), &indices.front(), GL_STATIC_DRAW);
+			BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+			primitive.index_count = (GLsizei)indices.size();
+		}
+
+		void PrimitiveRenderer::BuildBox()
+		{
+			std::vector<PrimitiveVertex> vertices;
+			std::vector<GLuint> indices;
+
+			//2x2x2 cube, four vertices per face
+			for (PxU32 axis = 0; axis < 3; axis++)
+			{
+				for (PxReal side = -1.f; side <= 1.f; side += 2.f)
+				{
+					PxVec3 n(0.f, 0.f, 0.f), u(0.f, 0.f, 0.f), v(0.f, 0.f, 0.f);
+					n[axis] = side;
+					u[(axis+1)%3] = 1.f;
+					v[(axis+2)%3] = side;
+
+					GLuint first = (GLuint)vertices.size();
+					const PxReal corners[4][2] = { {-1.f,-1.f}, {1.f,-1.f}, {1.f,1.f}, {-1.f,1.f} };
+					for (PxU32 i = 0; i < 4; i++)
+					{
+						PrimitiveVertex vertex;
+						vertex.position = PxVec4(n + u*corners[i][0] + v*corners[i][1], 0.f);
+						vertex.normal = n;
+						vertices.push_back(vertex);
+					}
+
+					indices.push_back(first); indices.push_back(first+1); indices.push_back(first+2);
+					indices.push_back(first); indices.push_back(first+2); indices.push_back(first+3);
+				}
+			}
+
+			Upload(primitives[BOX][0], vertices, indices);
+		}
+
+		void PrimitiveRenderer::BuildRound(Type type, PxU32 tier, int value)
+		{
+			std::vector<PrimitiveVertex> vertices;
+			std::vector<GLuint> indices;
+
+			const PxU32 slices = PxMax(value, 3);
+			const PxU32 rings = PxMax(value/2, 2);
+
+			//unit sphere around the x axis built from two hemispheres, each ending with the equator ring;
+			//for capsules the hemispheres are moved apart in the shader and the gap between the rings becomes the cylinder
+			for (PxU32 side = 0; side < 2; side++)
+			{
+				PxReal end = (type == CAPSULE) ? (side ? -1.f : 1.f) : 0.f;
+				for (PxU32 ring = 0; ring <= rings; ring++)
+				{
+					PxReal theta = PxHalfPi * (side*rings + ring) / rings;
+					for (PxU32 slice = 0; slice <= slices; slice++)
+					{
+						PxReal phi = 2.f * PxPi * slice / slices;
+						PxVec3 n(PxCos(theta), PxSin(theta)*PxCos(phi), PxSin(theta)*PxSin(phi));
+						PrimitiveVertex vertex;
+						vertex.position = PxVec4(n, end);
+						vertex.normal = n;
+						vertices.push_back(vertex);
+					}
+				}
+			}
+
+			const PxU32 rows = 2*(rings+1);
+			const PxU32 stride = slices+1;
+			for (PxU32 row = 0; row < rows-1; row++)
+			{
+				for (PxU32 slice = 0; slice < slices; slice++)
+				{
+					GLuint a = row*stride + slice;
+					GLuint b = a + stride;
+					indices.push_back(a); indices.push_back(b); indices.push_back(a+1);
+					indices.push_back(a+1); indices.push_back(b); indices.push_back(b+1);
+				}
+			}
+
+			Upload(primitives[type][tier], vertices, indices);
+		}
+
+		void PrimitiveRenderer::Detail(int value)
+		{
+			if (!program || (value == detail))
+				return;
+
+			detail = value;
+			for (PxU32 i = 0; i < LOD_TIERS; i++)
+			{
+				BuildRound(SPHERE, i, TierDetail(detail, i));
+				BuildRound(CAPSULE, i, TierDetail(detail, i));
+			}
+		}
+
+		bool PrimitiveRenderer::Add(const PxGeometryHolder& geometry, const PxMat44& pose, const PxVec3& color, PxU32 tier)
+		{
+			PrimitiveInstance instance;
+			Type type;
+
+			switch (geometry.getType())
+			{
+			case PxGeometryType::eBOX:
+				type = BOX;
+				tier = 0;
+				instance.scale = PxVec4(geometry.box().halfExtents, 0.f);
+				break;
+			case PxGeometryType::eSPHERE:
+				type = SPHERE;
+				instance.scale = PxVec4(PxVec3(geometry.sphere().radius), 0.f);
+				break;
+			case PxGeometryType::eCAPSULE:
+				type = CAPSULE;
+				instance.scale = PxVec4(PxVec3(geometry.capsule().radius), geometry.capsule().halfHeight);
+				break;
+			default:
+				return false;
+			}
+
+			//the pose is column major, the shader takes rows
+			for (PxU32 i = 0; i < 3; i++)
+				instance.pose[i] = PxVec4(pose.column0[i], pose.column1[i], pose.column2[i], pose.column3[i]);
+			instance.color = PxVec4(color, 1.f);
+
+			primitives[type][PxMin(tier, LOD_TIERS-1)].instances.push_back(instance);
+			return true;
+		}
+
+		void PrimitiveRenderer::DrawInstances(Primitive& primitive)
+		{
+			if (primitive.instances.empty())
+				return;
+
+			//the shadow pass reuses the instances uploaded by the main pass
+			BindBuffer(GL_ARRAY_BUFFER, primitive.instance_buffer);
+			if (!primitive.uploaded)
+			{
+				BufferData(GL_ARRAY_BUFFER, primitive.instances.size()*sizeof(PrimitiveInstance), &primitive.instances.front(), GL_STREAM_DRAW);
+				primitive.uploaded = true;
+			}
+			for (GLuint i = 0; i < 5; i++)
+			{
+				EnableVertexAttribArray(instance_location + i);
+				VertexAttribPointer(instance_location + i, 4, GL_FLOAT, GL_FALSE, sizeof(PrimitiveInstance), (const void*)(i*sizeof(PxVec4)));
+				VertexAttribDivisor(instance_location + i, 1);
+			}
+
+			BindBuffer(GL_ARRAY_BUFFER, primitive.vertex_buffer);
+			BindBuffer(GL_ELEMENT_ARRAY_BUFFER, primitive.index_buffer);
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glVertexPointer(4, GL_FLOAT, sizeof(PrimitiveVertex), 0);
+			glNormalPointer(GL_FLOAT, sizeof(PrimitiveVertex), (const void*)sizeof(PxVec4));
+
+			DrawElementsInstanced(GL_TRIANGLES, primitive.index_count, GL_UNSIGNED_INT, 0, (GLsizei)primitive.instances.size());
+
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+			for (GLuint i = 0; i < 5; i++)
+			{
+				VertexAttribDivisor(instance_location + i, 0);
+				DisableVertexAttribArray(instance_location + i);
+			}
+			BindBuffer(GL_ARRAY_BUFFER, 0);
+			BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		}
+
+		void PrimitiveRenderer::Draw()
+		{
+			if (!program || !Count())
+				return;
+
+			UseProgram(program);
+			UniformMatrix4fv(shadow_matrix_location, 1, GL_FALSE, identity_matrix);
+			Uniform4f(shadow_color_location, 0.f, 0.f, 0.f, 0.f);
+			for (PxU32 i = 0; i < TYPE_COUNT; i++)
+				for (PxU32 j = 0; j < LOD_TIERS; j++)
+					DrawInstances(primitives[i][j]);
+			UseProgram(0);
+		}
+
+		void PrimitiveRenderer::DrawShadows(const PxReal* shadow_matrix, const PxVec3& color)
+		{
+			if (!program || !Count())
+				return;
+
+			UseProgram(program);
+			UniformMatrix4fv(shadow_matrix_location, 1, GL_FALSE, shadow_matrix);
+			Uniform4f(shadow_color_location, color.x, color.y, color.z, 1.f);
+			for (PxU32 i = 0; i < TYPE_COUNT; i++)
+				for (PxU32 j = 0; j < LOD_TIERS; j++)
+					DrawInstances(primitives[i][j]);
+			UseProgram(0);
+		}
+
+		void PrimitiveRenderer::Clear()
+		{
+			//keeps the capacity, no allocations in the following frames
+			for (PxU32 i = 0; i < TYPE_COUNT; i++)
+			{
+				for (PxU32 j = 0; j < LOD_TIERS; j++)
+				{
+					primitives[i][j].instances.clear();
+					primitives[i][j].uploaded = false;
+				}
+			}
+		}
+
+		PxU32 PrimitiveRenderer::Count() const
+		{
+			PxU32 count = 0;
+			for (PxU32 i = 0; i < TYPE_COUNT; i++)
+				for (PxU32 j = 0; j < LOD_TIERS; j++)
+					count += (PxU32)primitives[i][j].instances.size();
+			return count;
+		}
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "GLExtensions.h"
+#include "Renderer.h"
+#include <vector>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///Vertex of a unit primitive
+		///The w coordinate selects the capsule end (-1 or 1) that the vertex is moved to, 0 for other shapes.
+		struct PrimitiveVertex
+		{
+			PxVec4 position;
+			PxVec3 normal;
+		};
+
+		///Per instance data: rows of the 3x4 shape pose, scale (w is the capsule half height) and color
+		struct PrimitiveInstance
+		{
+			PxVec4 pose[3];
+			PxVec4 scale;
+			PxVec4 color;
+		};
+
+		///Boxes, spheres and capsules drawn with a single instanced call per primitive type and level of detail
+		///
+		///The unit meshes of every level of detail tier are built once (and again when the render detail changes),
+		///the instances are collected during the frame and uploaded into a streaming buffer by Draw.
+		///Needs GLSL and instanced arrays, check Enabled() and use the fixed-function path otherwise.
+		class PrimitiveRenderer
+		{
+		public:
+			enum Type
+			{
+				BOX,
+				SPHERE,
+				CAPSULE,
+				TYPE_COUNT
+			};
+
+		private:
+			struct Primitive
+			{
+				GLuint vertex_buffer, index_buffer, instance_buffer;
+				GLsizei index_count;
+				std::vector<PrimitiveInstance> instances;
+				bool uploaded;
+
+				Primitive() : vertex_buffer(0), index_buffer(0), instance_buffer(0), index_count(0), uploaded(false) {}
+			};
+
+			//boxes use the first tier only
+			Primitive primitives[TYPE_COUNT][LOD_TIERS];
+			GLuint program;
+			GLint shadow_matrix_location, shadow_color_location;
+			int detail;
+
+			void Upload(Primitive& primitive, const std::vector<PrimitiveVertex>& vertices, const std::vector<GLuint>& indices);
+			void BuildBox();
+			void BuildRound(Type type, PxU32 tier, int detail);
+			void DrawInstances(Primitive& primitive);
+
+		public:
+			PrimitiveRenderer() : program(0), shadow_matrix_location(-1), shadow_color_location(-1), detail(0) {}
+
+			///Compile the shaders and build the unit meshes, returns false when instancing is not supported
+			bool Init(int render_detail);
+
+			///Shaders and meshes are ready
+			bool Enabled() const { return program != 0; }
+
+			///Set tessellation of spheres and capsules, the meshes are rebuilt when the value changes
+			void Detail(int value);
+
+			///Tessellation of a level of detail tier: halved with every tier, not below 6
+			static int TierDetail(int value, PxU32 tier) { return PxMin(value, PxMax(value >> tier, 6)); }
+
+			///Queue a shape, returns false for geometry that is not a box, sphere or capsule
+			bool Add(const PxGeometryHolder& geometry, const PxMat44& pose, const PxVec3& color, PxU32 tier=0);
+
+			///Draw all queued instances with lighting
+			void Draw();
+
+			///Draw all queued instances flattened by the shadow matrix in a single color
+			void DrawShadows(const PxReal* shadow_matrix, const PxVec3& color);
+
+			///Remove all queued instances
+			void Clear();
+
+			///Number of queued instances
+			PxU32 Count() const;
+		};
+	}
+}
@@ -1,7 +1,22 @@
 #include "Renderer.h"
 #include <iostream>
 #include <vector>
+#include <chrono>
 #include "UserData.h"
+#include "MeshCache.h"
+#include "HeightFieldCache.h"
+#include "PrimitiveRenderer.h"
+#include "Shadows.h"
+#include "Culling.h"
+#include "PoseHistory.h"
+#ifdef RENDERER_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#include <xmmintrin.h>
+#define RENDERER_SSE
+#endif
 
 using namespace std;
 
@@ -13,6 +28,72 @@ namespace VisualDebugger
 		PxVec3 background_color = PxVec3(0.f,0.f,0.f);
 		int render_detail = 10;
 		bool show_shadows = true;
+		MeshCache mesh_cache;
+		HeightFieldCache heightfield_cache;
+		PrimitiveRenderer primitive_renderer;
+		bool use_instancing = true;
+		ShadowType shadow_type = SHADOWS_MAP;
+		ShadowMap shadow_map;
+		int shadow_map_resolution = 2048;
+		//width of the area around the camera covered by the shadow map
+		PxReal shadow_map_extent = 120.f;
+		BlobShadows blob_shadows;
+		PxVec3 camera_eye(0.f, 0.f, 0.f), camera_dir(0.f, 0.f, -1.f);
+		PxReal camera_aspect = 1.f;
+		bool frustum_culling = true;
+		Frustum frustum;
+		StaticBoundsCache static_bounds;
+		RenderStats render_stats;
+		bool level_of_detail = true;
+		//smallest projected radius (in pixels) of each tier but the last one
+		PxReal lod_thresholds[LOD_TIERS-1] = { 48.f, 16.f, 6.f };
+		//projected radius of a unit sphere at a unit distance
+		PxReal lod_pixel_scale = 1.f;
+		bool auto_lod = false;
+		PxReal lod_frame_budget = 20.f;
+		std::chrono::steady_clock::time_point last_frame;
+		//debug vertices with RGBA colors, see RenderDebugVertices
+		struct DebugVertex
+		{
+			PxVec3 position;
+			PxU8 color[4];
+		};
+		std::vector<DebugVertex> debug_vertices;
+		//vertex normals of the cloth drawn last (w unused), see RenderCloth
+		std::vector<PxVec4> cloth_normals;
+		//GPU time of the frames measured by a ring of timer queries, the result of a frame is read two frames later
+		static const PxU32 GPU_QUERIES = 3;
+		bool gpu_timing = false;
+		GLuint gpu_queries[GPU_QUERIES] = { 0, 0, 0 };
+		bool gpu_query_pending[GPU_QUERIES] = { false, false, false };
+		bool gpu_query_active = false;
+		PxU32 gpu_frame = 0;
+		PxReal gpu_time = -1.f;
+		//poses of the dynamic actors between the last two simulation steps, see InterpolatePoses
+		const PoseHistory* pose_history = 0;
+		PxReal pose_alpha = 1.f;
+		//vertices of the graph drawn last, see RenderGraph
+		std::vector<PxVec2> graph_vertices;
+		//size of the window or the offscreen surface
+		int window_width = 1, window_height = 1;
+		bool offscreen = false;
+#ifdef RENDERER_EGL
+		EGLDisplay egl_display = EGL_NO_DISPLAY;
+		EGLSurface egl_surface = EGL_NO_SURFACE;
+		EGLContext egl_context = EGL_NO_CONTEXT;
+#endif
+
+		//projection of the camera
+		static const PxReal camera_fov = 60.f;
+		static const PxReal camera_near = 1.f;
+		static const PxReal camera_far = 10000.f;
+
+		//fraction of a threshold that a shape has to cross before it changes the tier, avoids popping at the boundary
+		static const PxReal lod_hysteresis = .15f;
+
+		//projects the shapes onto the ground plane along the light direction
+		static const PxVec3 shadowDir(-0.7071067f, -0.7071067f, -0.7071067f);
+		static const PxReal shadowMat[]={ 1,0,0,0, -shadowDir.x/shadowDir.y,0,-shadowDir.z/shadowDir.y,0, 0,0,1,0, 0,0,0,1 };
 
 		static float gPlaneData[]={
 			-1.f, 0.f, -1.f, 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f, 1.f, 0.f,
@@ -20,6 +101,24 @@ namespace VisualDebugger
 			1.f, 0.f, 1.f, 0.f, 1.f, 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f
 		};
 
+		static float gBoxData[]={
+			1.f, -1.f, -1.f, 1.f, 0.f, 0.f, 1.f, 1.f, -1.f, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f, 1.f, 0.f, 0.f, 1.f, -1.f, 1.f, 1.f, 0.f, 0.f,
+			-1.f, -1.f, 1.f, -1.f, 0.f, 0.f, -1.f, 1.f, 1.f, -1.f, 0.f, 0.f, -1.f, 1.f, -1.f, -1.f, 0.f, 0.f, -1.f, -1.f, -1.f, -1.f, 0.f, 0.f,
+			-1.f, 1.f, -1.f, 0.f, 1.f, 0.f, -1.f, 1.f, 1.f, 0.f, 1.f, 0.f, 1.f, 1.f, 1.f, 0.f, 1.f, 0.f, 1.f, 1.f, -1.f, 0.f, 1.f, 0.f,
+			1.f, -1.f, -1.f, 0.f, -1.f, 0.f, 1.f, -1.f, 1.f, 0.f, -1.f, 0.f, -1.f, -1.f, 1.f, 0.f, -1.f, 0.f, -1.f, -1.f, -1.f, 0.f, -1.f, 0.f,
+			-1.f, -1.f, 1.f, 0.f, 0.f, 1.f, 1.f, -1.f, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f, 1.f, 0.f, 0.f, 1.f, -1.f, 1.f, 1.f, 0.f, 0.f, 1.f,
+			-1.f, 1.f, -1.f, 0.f, 0.f, -1.f, 1.f, 1.f, -1.f, 0.f, 0.f, -1.f, 1.f, -1.f, -1.f, 0.f, 0.f, -1.f, -1.f, -1.f, -1.f, 0.f, 0.f, -1.f
+		};
+
+		//GLU and vertex arrays instead of the GLUT shapes, there is no GLUT in the offscreen mode
+		void SolidSphere(PxReal radius, int detail)
+		{
+			GLUquadric* qobj = gluNewQuadric();
+			gluQuadricNormals(qobj, GLU_SMOOTH);
+			gluSphere(qobj, radius, detail, detail);
+			gluDeleteQuadric(qobj);
+		}
+
 		void DrawPlane()
 		{
 			glScalef(10240,0,10240);
@@ -32,19 +131,25 @@ namespace VisualDebugger
 			glDisableClientState(GL_NORMAL_ARRAY);
 		}
 
-		void DrawSphere(const PxGeometryHolder& geometry)
+		void DrawSphere(const PxGeometryHolder& geometry, int detail)
 		{
-			glutSolidSphere(geometry.sphere().radius, render_detail, render_detail);
+			SolidSphere(geometry.sphere().radius, detail);
 		}
 
 		void DrawBox(const PxGeometryHolder& geometry)
 		{
 			PxVec3 half_size = geometry.box().halfExtents;
 			glScalef(half_size.x, half_size.y, half_size.z);
-			glutSolidCube(2.f);		
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glVertexPointer(3, GL_FLOAT, 2*3*sizeof(float), gBoxData);
+			glNormalPointer(GL_FLOAT, 2*3*sizeof(float), gBoxData+3);
+			glDrawArrays(GL_QUADS, 0, 24);
+			glDisableClientState(GL_VERTEX_ARRAY);
+			glDisableClientState(GL_NORMAL_ARRAY);
 		}
 
-		void DrawCapsule(const PxGeometryHolder& geometry)
+		void DrawCapsule(const PxGeometryHolder& geometry, int detail)
 		{
 			const PxF32 radius = geometry.capsule().radius;
 			const PxF32 halfHeight = geometry.capsule().halfHeight;
@@ -52,13 +157,13 @@ namespace VisualDebugger
 			//Sphere
 			glPushMatrix();
 			glTranslatef(halfHeight,0.f, 0.f);
-			glutSolidSphere(radius, render_detail, render_detail);		
+			SolidSphere(radius, detail);
 			glPopMatrix();
 
 			//Sphere
 			glPushMatrix();
 			glTranslatef(-halfHeight,0.f,0.f);
-			glutSolidSphere(radius, render_detail, render_detail);		
+			SolidSphere(radius, detail);
 			glPopMatrix();
 
 			//Cylinder
@@ -68,65 +173,27 @@ namespace VisualDebugger
 
 			GLUquadric* qobj = gluNewQuadric();
 			gluQuadricNormals(qobj, GLU_SMOOTH);
-			gluCylinder(qobj, radius, radius, halfHeight*2.f, render_detail, render_detail);
+			gluCylinder(qobj, radius, radius, halfHeight*2.f, detail, detail);
 			gluDeleteQuadric(qobj);
 			glPopMatrix();
 		}
 
 		void DrawConvexMesh(const PxGeometryHolder& geometry)
 		{
-			PxConvexMesh* mesh = geometry.convexMesh().convexMesh;
-			PxU32 num_polys = mesh->getNbPolygons();
-			const PxVec3* verts = mesh->getVertices();
-			const PxU8* indicies = mesh->getIndexBuffer();
-
-			for (PxU32 i = 0; i < num_polys; i++)
-			{
-				PxHullPolygon face;
-				if (mesh->getPolygonData(i,face))
-				{
-					glBegin(GL_POLYGON);
-					glNormal3f(face.mPlane[0],face.mPlane[1],face.mPlane[2]);
-					const PxU8* faceIdx = indicies + face.mIndexBase;
-					for (PxU32 j = 0; j < face.mNbVerts; j++)
-					{
-						PxVec3 v = verts[faceIdx[j]];
-						glVertex3f(v.x,v.y,v.z);
-					}
-					glEnd();
-				}
-			}
+			mesh_cache.Get(geometry.convexMesh().convexMesh)->Draw();
 		}
 
 		void DrawTriangleMesh(const PxGeometryHolder& geometry)
 		{
-			PxTriangleMesh* mesh = geometry.triangleMesh().triangleMesh;
-			const PxVec3* verts = mesh->getVertices();
-			PxU16* trigs = (PxU16*)mesh->getTriangles();
-			const PxU32 num_trigs = mesh->getNbTriangles();
-
-			for (PxU32 i = 0; i < num_trigs*3; i+=3)
-			{
-				PxVec3 v0 = verts[trigs[i]];
-				PxVec3 v1 = verts[trigs[i+1]];
-				PxVec3 v2 = verts[trigs[i+2]];
-				PxVec3 n = (v1-v0).cross(v2-v0);
-				n.normalize();
-				glBegin(GL_POLYGON);
-				glNormal3f(n.x, n.y, n.z);
-				glVertex3f(v0.x, v0.y, v0.z);
-				glVertex3f(v1.x, v1.y, v1.z);
-				glVertex3f(v2.x, v2.y, v2.z);
-				glEnd();
-			}
+			mesh_cache.Get(geometry.triangleMesh().triangleMesh)->Draw();
 		}
 
 		void DrawHeightField(const PxGeometryHolder& geometry)
 		{
-			//TODO
+			heightfield_cache.Draw(geometry.heightField(), render_stats.drawn_tiles, render_stats.culled_tiles);
 		}
 
-		void RenderGeometry(const PxGeometryHolder& geometry)
+		void RenderGeometry(const PxGeometryHolder& geometry, PxU32 tier=0)
 		{
 			switch(geometry.getType())
 			{
@@ -134,13 +201,13 @@ namespace VisualDebugger
 				DrawPlane();
 				break;
 			case PxGeometryType::eSPHERE:
-				DrawSphere(geometry);
+				DrawSphere(geometry, PrimitiveRenderer::TierDetail(render_detail, tier));
 				break;
 			case PxGeometryType::eBOX:			
 				DrawBox(geometry);
 				break;
 			case PxGeometryType::eCAPSULE:
-				DrawCapsule(geometry);
+				DrawCapsule(geometry, PrimitiveRenderer::TierDetail(render_detail, tier));
 				break;
 			case PxGeometryType::eCONVEXMESH:
 				DrawConvexMesh(geometry);
@@ -156,75 +223,106 @@ namespace VisualDebugger
 			}
 		}
 
+#ifdef RENDERER_SSE
+		//cross product of the xyz lanes, w is a.w*b.w - a.w*b.w = 0
+		inline __m128 Cross(__m128 a, __m128 b)
+		{
+			__m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+			return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+		}
+#endif
+
+		//sum the normal of every quad, the cross product of its diagonals, at its corners
+		//PxClothParticle and PxVec4 are both 16 bytes: a particle (position, inverse mass) loads into a single register
+		void AccumulateClothNormals(const PxClothParticle* particles, const PxU32* quads, PxU32 quad_count, PxVec4* normals)
+		{
+			static_assert(sizeof(PxClothParticle) == sizeof(PxVec4), "a particle has to fit into a single register");
+#ifdef RENDERER_SSE
+			const float* positions = &particles->pos.x;
+			float* sums = &normals->x;
+			for (PxU32 i = 0; i < quad_count*4; i+=4)
+			{
+				const PxU32 a = quads[i]*4, b = quads[i+1]*4, c = quads[i+2]*4, d = quads[i+3]*4;
+				__m128 pa = _mm_loadu_ps(positions + a), pb = _mm_loadu_ps(positions + b);
+				__m128 pc = _mm_loadu_ps(positions + c), pd = _mm_loadu_ps(positions + d);
+				__m128 n = Cross(_mm_sub_ps(pd, pb), _mm_sub_ps(pc, pa));
+				_mm_storeu_ps(sums + a, _mm_add_ps(_mm_loadu_ps(sums + a), n));
+				_mm_storeu_ps(sums + b, _mm_add_ps(_mm_loadu_ps(sums + b), n));
+				_mm_storeu_ps(sums + c, _mm_add_ps(_mm_loadu_ps(sums + c), n));
+				_mm_storeu_ps(sums + d, _mm_add_ps(_mm_loadu_ps(sums + d), n));
+			}
+#else
+			for (PxU32 i = 0; i < quad_count*4; i+=4)
+			{
+				const PxU32 a = quads[i], b = quads[i+1], c = quads[i+2], d = quads[i+3];
+				PxVec4 n((particles[d].pos - particles[b].pos).cross(particles[c].pos - particles[a].pos), 0.f);
+				normals[a] += n;
+				normals[b] += n;
+				normals[c] += n;
+				normals[d] += n;
+			}
+#endif
+		}
+
 		void RenderCloth(const PxCloth* cloth)
 		{
 			PxClothMeshDesc* mesh_desc = ((UserData*)cloth->userData)->cloth_mesh_desc;
 			PxVec3* color = ((UserData*)cloth->userData)->color;
 
-			PxU32 quad_count = mesh_desc->quads.count;
-			PxU32* quads = (PxU32*)mesh_desc->quads.data;
-
-			std::vector<PxVec3> verts(cloth->getNbParticles());
-			std::vector<PxVec3> norms(verts.size(), PxVec3(0.f,0.f,0.f));
-
-			//get verts data
-			cloth->lockParticleData();
+			const PxU32 quad_count = mesh_desc->quads.count;
+			const PxU32* quads = (const PxU32*)mesh_desc->quads.data;
+			const PxU32 particle_count = cloth->getNbParticles();
 
+			//a single read lock, the positions are drawn straight from the particle buffer
 			PxClothParticleData* particle_data = cloth->lockParticleData();
 			if (!particle_data)
 				return;
-			// copy vertex positions
-			for (PxU32 j = 0; j < verts.size(); j++)
-				verts[j] = particle_data->particles[j].pos;
-
-			particle_data->unlock();
-
-			for (PxU32 i = 0; i < quad_count*4; i+=4)
-			{
-				PxVec3 v0 = verts[quads[i]];
-				PxVec3 v1 = verts[quads[i+1]];
-				PxVec3 v2 = verts[quads[i+2]];
-				PxVec3 n = -((v1-v0).cross(v2-v0));
-
-				norms[quads[i]] += n;
-				norms[quads[i+1]] += n;
-				norms[quads[i+2]] += n;
-				norms[quads[i+3]] += n;
-			}
+			const PxClothParticle* particles = particle_data->particles;
 
-			for (PxU32 i = 0; i < norms.size(); i++)
-				norms[i].normalize();
+			//GL_NORMALIZE brings the summed normals to unit length, the buffer keeps its capacity between frames
+			cloth_normals.assign(particle_count, PxVec4(0.f, 0.f, 0.f, 0.f));
+			PxVec4* normals = &cloth_normals.front();
+			AccumulateClothNormals(particles, quads, quad_count, normals);
 
 			PxTransform pose = cloth->getGlobalPose();
 			PxMat44 shapePose(pose);
 
 			glColor4f(color->x, color->y, color->z, 1.f);
 
-			glPushMatrix();						
+			glPushMatrix();
 			glMultMatrixf((float*)&shapePose);
+			glEnable(GL_NORMALIZE);
 
 			glEnableClientState(GL_VERTEX_ARRAY);
 			glEnableClientState(GL_NORMAL_ARRAY);
 
-			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &verts.front());
-			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &norms.front());
+			glVertexPointer(3, GL_FLOAT, sizeof(PxClothParticle), &particles->pos);
+			glNormalPointer(GL_FLOAT, sizeof(PxVec4), normals);
 
 			glDrawElements(GL_QUADS, quad_count*4, GL_UNSIGNED_INT, quads);
 
 			glDisableClientState(GL_NORMAL_ARRAY);
 			glDisableClientState(GL_VERTEX_ARRAY);
 
+			glDisable(GL_NORMALIZE);
 			glPopMatrix();
+
+			//client arrays are read by the draw call, the particles can be released now
+			particle_data->unlock();
 		}
 
 		void reshapeCallback(int width, int height)
 		{
+			window_width = width;
+			window_height = PxMax(height, 1);
 			glViewport(0, 0, width, height);
 		}
 
+#ifndef RENDERER_EGL
 		void idleCallback()
 		{
-			glClearColor(background_color.x, background_color.y, background_color.z, 1.f);
 			glutPostRedisplay();
 		}
 
@@ -242,12 +340,52 @@ namespace VisualDebugger
 			glutSetWindow(glutCreateWindow(name));
 			glutReshapeFunc(reshapeCallback);
 			glutIdleFunc(idleCallback);
+			window_width = width;
+			window_height = height;
 
 			delete[] namestr;
 		}
+#endif
+
+		bool InitOffscreen(int width, int height)
+		{
+#ifdef RENDERER_EGL
+			//Mesa renders without a display server through the surfaceless platform (llvmpipe when there is no GPU)
+			PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+			egl_display = get_platform_display ? get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0) : EGL_NO_DISPLAY;
+			if (egl_display == EGL_NO_DISPLAY)
+				egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+			EGLint major, minor;
+			if ((egl_display == EGL_NO_DISPLAY) || !eglInitialize(egl_display, &major, &minor) || !eglBindAPI(EGL_OPENGL_API))
+				return false;
+
+			//desktop GL (compatibility profile) and a pbuffer of the frame size
+			EGLint config_attributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+				EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 24, EGL_NONE };
+			EGLConfig config;
+			EGLint configs = 0;
+			if (!eglChooseConfig(egl_display, config_attributes, &config, 1, &configs) || !configs)
+				return false;
+
+			EGLint surface_attributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+			egl_surface = eglCreatePbufferSurface(egl_display, config, surface_attributes);
+			egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, 0);
+			if ((egl_surface == EGL_NO_SURFACE) || (egl_context == EGL_NO_CONTEXT) || !eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context))
+				return false;
+
+			offscreen = true;
+			reshapeCallback(width, height);
+			return true;
+#else
+			return false;
+#endif
+		}
 
 		void Init()
 		{
+			GLExtensions::Init();
+
 			// Setup default render states
 			PxReal specular_material[]	= { .1f, .1f, .1f, 1.f };
 			glEnable(GL_DEPTH_TEST);
@@ -265,16 +403,61 @@ namespace VisualDebugger
 			glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuseColor);
 			glLightfv(GL_LIGHT0, GL_POSITION, position);
 			glEnable(GL_LIGHT0);
+
+			//falls back to the fixed-function primitives when not supported
+			primitive_renderer.Init(render_detail);
+
+			//falls back to the projected shadows when not supported
+			shadow_map.Init(shadow_map_resolution);
 		}
 
 		void Start(const PxVec3& cameraEye, const PxVec3& cameraDir)
 		{
+			camera_eye = cameraEye;
+			camera_dir = cameraDir;
+
+			if (gpu_timing && GLExtensions::HasTimerQueries())
+			{
+				if (!gpu_queries[0])
+					GLExtensions::GenQueries(GPU_QUERIES, gpu_queries);
+				GLExtensions::BeginQuery(GL_TIME_ELAPSED, gpu_queries[gpu_frame % GPU_QUERIES]);
+				gpu_query_active = true;
+			}
+
+			glClearColor(background_color.x, background_color.y, background_color.z, 1.f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+			//drop the meshes and actors released by PhysX since the last frame
+			mesh_cache.Flush();
+			heightfield_cache.Flush();
+			static_bounds.Flush();
+
+			//coarser tiers while the previous frame was over the budget, back to the normal ones when well below it
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			PxReal lod_scale = render_stats.lod_scale;
+			if (!auto_lod)
+				lod_scale = 1.f;
+			else if (last_frame.time_since_epoch().count())
+			{
+				PxReal frame_time = std::chrono::duration<PxReal, std::milli>(now - last_frame).count();
+				if (frame_time > lod_frame_budget)
+					lod_scale = PxMin(lod_scale*1.1f, 16.f);
+				else if (frame_time < lod_frame_budget*.8f)
+					lod_scale = PxMax(lod_scale/1.05f, 1.f);
+			}
+			last_frame = now;
+
+			render_stats = RenderStats();
+			render_stats.lod_scale = lod_scale;
+
 			// Setup camera
+			PxReal aspect = (float)window_width/(float)window_height;
+			camera_aspect = aspect;
+			lod_pixel_scale = window_height / (2.f*PxTan(camera_fov * PxPi / 360.f));
 			glMatrixMode(GL_PROJECTION);
 			glLoadIdentity();
-			gluPerspective(60.f, (float)glutGet(GLUT_WINDOW_WIDTH)/(float)glutGet(GLUT_WINDOW_HEIGHT), 1.f, 10000.f);
+			gluPerspective(camera_fov, aspect, camera_near, camera_far);
+			frustum.Set(cameraEye, cameraDir, PxVec3(0.f, 1.f, 0.f), camera_fov, aspect, camera_near, camera_far);
 
 			glMatrixMode(GL_MODELVIEW);
 			glLoadIdentity();
@@ -286,9 +469,132 @@ namespace VisualDebugger
 			background_color = color;
 		}
 
+		///Level of detail tier of a shape, always the first one for shapes other than spheres and capsules
+		///
+		///The tier follows the projected radius of the shape: a shape keeps the tier of the previous frame
+		///until it crosses the threshold of the next one by more than the hysteresis band.
+		PxU32 ShapeLOD(const PxShape* shape, const PxGeometryHolder& geometry, const PxVec3& position)
+		{
+			PxReal radius;
+			switch (geometry.getType())
+			{
+			case PxGeometryType::eSPHERE:
+				radius = geometry.sphere().radius;
+				break;
+			case PxGeometryType::eCAPSULE:
+				radius = geometry.capsule().radius + geometry.capsule().halfHeight;
+				break;
+			default:
+				return 0;
+			}
+
+			if (!level_of_detail)
+				return 0;
+
+			PxReal pixels = radius * lod_pixel_scale / PxMax((position - camera_eye).magnitude(), camera_near);
+			PxReal scale = render_stats.lod_scale;
+
+			UserData* user_data = (UserData*)shape->userData;
+			int previous = user_data ? user_data->lod : -1;
+			PxU32 tier = (previous < 0) ? LOD_TIERS-1 : PxMin((PxU32)previous, LOD_TIERS-1);
+			PxReal band = (previous < 0) ? 0.f : lod_hysteresis;
+
+			while ((tier > 0) && (pixels > lod_thresholds[tier-1]*scale*(1.f + band)))
+				tier--;
+			while ((tier < LOD_TIERS-1) && (pixels < lod_thresholds[tier]*scale*(1.f - band)))
+				tier++;
+
+			if (user_data)
+				user_data->lod = (int)tier;
+			return tier;
+		}
+
+		///Pose of a rigid actor in the rendered frame, offset is the distance from the simulated position
+		PxTransform ActorPose(const PxRigidActor* actor, PxVec3& offset)
+		{
+			PxTransform simulated = actor->getGlobalPose();
+			PxTransform pose = simulated;
+			if (pose_history)
+				pose_history->Get(actor, pose_alpha, pose);
+			offset = pose.p - simulated.p;
+			return pose;
+		}
+
+		///Bounds covering both the simulated and the rendered position
+		PxBounds3 SweptBounds(const PxBounds3& bounds, const PxVec3& offset)
+		{
+			PxBounds3 swept = bounds;
+			swept.include(PxBounds3(bounds.minimum + offset, bounds.maximum + offset));
+			return swept;
+		}
+
+		///Depth pass of all shapes from the light
+		void RenderShadowMap(PxActor** actors, const PxU32 numActors, bool instanced)
+		{
+			//cover the area in front of the camera
+			PxVec3 center = camera_eye + camera_dir.getNormalized()*shadow_map_extent*.5f;
+			center.y = 0.f;
+
+			shadow_map.Begin(center, shadow_map_extent, shadowDir);
+
+			for (PxU32 i = 0; i < numActors; i++)
+			{
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+				if (!actors[i]->isRigidActor())
+#else
+				if (!actors[i]->is<PxRigidActor>())
+#endif
+					continue;
+
+				PxRigidActor* rigid_actor = (PxRigidActor*)actors[i];
+				std::vector<PxShape*> shapes(rigid_actor->getNbShapes());
+				rigid_actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
+				PxVec3 offset;
+				PxTransform actor_pose = ActorPose(rigid_actor, offset);
+
+				for (PxU32 j = 0; j < shapes.size(); j++)
+				{
+					const PxShape* shape = shapes[j];
+					//the ground receives the shadows only
+					if ((shape->getFlags() & PxShapeFlag::eTRIGGER_SHAPE) || (shape->getGeometryType() == PxGeometryType::ePLANE) ||
+						(shape->getGeometryType() == PxGeometryType::eHEIGHTFIELD))
+						continue;
+
+					PxTransform pose = actor_pose * shape->getLocalPose();
+					PxMat44 shapePose(pose);
+					PxGeometryHolder h = shape->getGeometry();
+					PxU32 tier = ShapeLOD(shape, h, pose.p);
+
+					if (instanced && primitive_renderer.Add(h, shapePose, default_color, tier))
+						continue;
+
+					glPushMatrix();
+					glMultMatrixf((float*)&shapePose);
+					RenderGeometry(h, tier);
+					glPopMatrix();
+				}
+			}
+
+			if (instanced)
+			{
+				primitive_renderer.Draw();
+				primitive_renderer.Clear();
+			}
+
+			shadow_map.End();
+		}
+
 		void Render(PxActor** actors, const PxU32 numActors)
 		{
 			PxVec3 shadow_color = default_color*0.9;
+			bool instanced = use_instancing && primitive_renderer.Enabled();
+			ShadowType shadows = show_shadows ? shadow_type : SHADOWS_OFF;
+			if ((shadows == SHADOWS_MAP) && !shadow_map.Enabled())
+				shadows = SHADOWS_PROJECTED;
+
+			if (shadows == SHADOWS_MAP)
+				RenderShadowMap(actors, numActors, instanced);
+
 			for(PxU32 i=0;i<numActors;i++) {
 #if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
 				if (actors[i]->isCloth()) {
@@ -305,11 +611,43 @@ namespace VisualDebugger
 					PxRigidActor* rigid_actor = (PxRigidActor*)actors[i];
 					std::vector<PxShape*> shapes(rigid_actor->getNbShapes());
 					rigid_actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
+					PxVec3 offset;
+					PxTransform actor_pose = ActorPose(rigid_actor, offset);
+
+					//test the whole actor first, the shapes only when it is partially visible
+					Frustum::Result visibility = Frustum::INSIDE;
+					const StaticBoundsCache::Entry* bounds = 0;
+					if (frustum_culling)
+					{
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+						if (rigid_actor->isRigidStatic())
+#else
+						if (rigid_actor->is<PxRigidStatic>())
+#endif
+						{
+							bounds = &static_bounds.Get(rigid_actor, &shapes.front(), (PxU32)shapes.size());
+							visibility = frustum.Test(bounds->actor);
+						}
+						else
+							visibility = frustum.Test(SweptBounds(rigid_actor->getWorldBounds(), offset));
+					}
 
 					for(PxU32 j = 0; j < shapes.size(); j++)
 					{
 						const PxShape* shape = shapes[j];
-						PxTransform pose = PxShapeExt::getGlobalPose(*shape, *shape->getActor());
+						//trigger volumes are invisible
+						if (shape->getFlags() & PxShapeFlag::eTRIGGER_SHAPE)
+							continue;
+
+						if ((visibility == Frustum::OUTSIDE) || ((visibility == Frustum::INTERSECTS) &&
+							(frustum.Test(bounds ? bounds->shapes[j] : SweptBounds(PxShapeExt::getWorldBounds(*shape, *rigid_actor), offset)) == Frustum::OUTSIDE)))
+						{
+							render_stats.culled_shapes++;
+							continue;
+						}
+						render_stats.drawn_shapes++;
+
+						PxTransform pose = actor_pose * shape->getLocalPose();
 						PxGeometryHolder h = shape->getGeometry();
 						//move the plane slightly down to avoid visual artefacts
 						if (h.getType() == PxGeometryType::ePLANE)
@@ -319,11 +657,13 @@ namespace VisualDebugger
 						}
 
 						PxMat44 shapePose(pose);
-						// render object
-						glPushMatrix();						
-						glMultMatrixf((float*)&shapePose);
-
 						PxVec3 shape_color = default_color;
+						//planes and heightfields receive the shadows but do not cast them
+						bool ground = (h.getType() == PxGeometryType::ePLANE) || (h.getType() == PxGeometryType::eHEIGHTFIELD);
+
+						PxU32 tier = ShapeLOD(shape, h, pose.p);
+						if ((h.getType() == PxGeometryType::eSPHERE) || (h.getType() == PxGeometryType::eCAPSULE))
+							render_stats.lod_shapes[tier]++;
 
 						if (shape->userData)
 						{
@@ -334,28 +674,47 @@ namespace VisualDebugger
 							}
 						}
 
+						if ((shadows == SHADOWS_BLOB) && !ground)
+						{
+							PxBounds3 shape_bounds = PxShapeExt::getWorldBounds(*shape, *rigid_actor);
+							blob_shadows.Add(PxBounds3(shape_bounds.minimum + offset, shape_bounds.maximum + offset), shadowDir);
+						}
+
+						//boxes, spheres and capsules are queued and drawn together after the loop
+						if (instanced && primitive_renderer.Add(h, shapePose, shape_color, tier))
+							continue;
+
+						// render object
+						glPushMatrix();						
+						glMultMatrixf((float*)&shapePose);
+
 						if (h.getType() == PxGeometryType::ePLANE)
 							glDisable(GL_LIGHTING);
 
 						glColor4f(shape_color.x, shape_color.y, shape_color.z, 1.f);
 
-						RenderGeometry(h);
+						bool receiver = (shadows == SHADOWS_MAP) && ground;
+						if (receiver)
+							shadow_map.BeginReceiver((h.getType() == PxGeometryType::ePLANE) ? shadow_color : shape_color*0.5f);
+
+						RenderGeometry(h, tier);
+
+						if (receiver)
+							shadow_map.EndReceiver();
 
 						if (h.getType() == PxGeometryType::ePLANE)
 							glEnable(GL_LIGHTING);
 
 						glPopMatrix();
 
-						if(show_shadows && (h.getType() != PxGeometryType::ePLANE))
+						if((shadows == SHADOWS_PROJECTED) && !ground)
 						{
-							const PxVec3 shadowDir(-0.7071067f, -0.7071067f, -0.7071067f);
-							const PxReal shadowMat[]={ 1,0,0,0, -shadowDir.x/shadowDir.y,0,-shadowDir.z/shadowDir.y,0, 0,0,1,0, 0,0,0,1 };
 							glPushMatrix();						
 							glMultMatrixf(shadowMat);
 							glMultMatrixf((float*)&shapePose);
 							glDisable(GL_LIGHTING);
 							glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
-							RenderGeometry(h);
+							RenderGeometry(h, tier);
 							glEnable(GL_LIGHTING);
 							glPopMatrix();
 						}
@@ -363,18 +722,89 @@ namespace VisualDebugger
 				}
 
 			}
+
+			if (instanced)
+			{
+				primitive_renderer.Draw();
+				if (shadows == SHADOWS_PROJECTED)
+					primitive_renderer.DrawShadows(shadowMat, shadow_color);
+				primitive_renderer.Clear();
+			}
+
+			if (shadows == SHADOWS_BLOB)
+			{
+				blob_shadows.Draw();
+				blob_shadows.Clear();
+			}
 		}
 
 		void Finish()
 		{
-			glutSwapBuffers();
+			if (gpu_query_active)
+			{
+				GLExtensions::EndQuery(GL_TIME_ELAPSED);
+				gpu_query_pending[gpu_frame % GPU_QUERIES] = true;
+				gpu_query_active = false;
+				gpu_frame++;
+
+				//the query started two frames ago is reused next, its result is dropped when it is not ready yet
+				GLuint oldest = gpu_frame % GPU_QUERIES;
+				if (gpu_query_pending[oldest])
+				{
+					GLint available = 0;
+					GLExtensions::GetQueryObjectiv(gpu_queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+					if (available)
+					{
+						unsigned long long nanoseconds = 0;
+						GLExtensions::GetQueryObjectui64v(gpu_queries[oldest], GL_QUERY_RESULT, &nanoseconds);
+						gpu_time = nanoseconds * 1e-6f;
+					}
+					gpu_query_pending[oldest] = false;
+				}
+			}
+
+			//the offscreen surface is single buffered, the frame is complete when the commands are
+			if (offscreen)
+				glFinish();
+#ifndef RENDERER_EGL
+			else
+				glutSwapBuffers();
+#endif
 		}
 
 		void SetRenderDetail(int value)
 		{
 			render_detail = value;
+			primitive_renderer.Detail(value);
+		}
+
+		void LevelOfDetail(bool value)
+		{
+			level_of_detail = value;
+		}
+
+		bool LevelOfDetail() { return level_of_detail; }
+
+		void AutoLevelOfDetail(bool value, PxReal frame_budget)
+		{
+			auto_lod = value;
+			lod_frame_budget = frame_budget;
+		}
+
+		void SmoothMeshNormals(bool value)
+		{
+			mesh_cache.SmoothNormals(value);
+		}
+
+		bool SmoothMeshNormals() { return mesh_cache.SmoothNormals(); }
+
+		void Instancing(bool value)
+		{
+			use_instancing = value;
 		}
 
+		bool Instancing() { return use_instancing && primitive_renderer.Enabled(); }
+
 		void ShowShadows(bool value)
 		{
 			show_shadows = value;
@@ -382,13 +812,87 @@ namespace VisualDebugger
 
 		bool ShowShadows() { return show_shadows; }
 
-		void RenderBuffer(float* pVertList, float* pColorList, int type, int num)
+		void SetShadowType(ShadowType value)
+		{
+			shadow_type = value;
+		}
+
+		ShadowType GetShadowType() { return shadow_type; }
+
+		void FrustumCulling(bool value)
+		{
+			frustum_culling = value;
+		}
+
+		bool FrustumCulling() { return frustum_culling; }
+
+		PxBounds3 ViewBounds(PxReal distance)
+		{
+			PxVec3 f = camera_dir.getNormalized();
+			PxVec3 r = f.cross(PxVec3(0.f, 1.f, 0.f)).getNormalized();
+			PxVec3 u = r.cross(f);
+			PxReal ty = PxTan(camera_fov * PxPi / 360.f);
+
+			//corners of the near plane and of the plane at the given distance
+			PxBounds3 bounds = PxBounds3::empty();
+			const PxReal depths[] = { camera_near, PxMax(distance, camera_near) };
+			for (PxU32 i = 0; i < 2; i++)
+			{
+				PxVec3 center = camera_eye + f*depths[i];
+				PxVec3 up = u*(depths[i]*ty);
+				PxVec3 right = r*(depths[i]*ty*camera_aspect);
+				bounds.include(center + right + up);
+				bounds.include(center + right - up);
+				bounds.include(center - right + up);
+				bounds.include(center - right - up);
+			}
+			return bounds;
+		}
+
+		const RenderStats& GetRenderStats() { return render_stats; }
+
+		void SetShadowMapResolution(int value)
+		{
+			shadow_map_resolution = value;
+			//recreate the map if the context exists already
+			if (shadow_map.Enabled())
+				shadow_map.Init(shadow_map_resolution);
+		}
+
+		///Draw vertices laid out as the PhysX debug primitives: a position followed by a packed 0xAARRGGBB color
+		///
+		///The packed color is stored as B,G,R,A bytes, so the arrays are passed to GL as they are with GL_BGRA colors.
+		///Old drivers without BGRA vertex colors get a copy with RGBA bytes in a buffer reused between frames.
+		void RenderDebugVertices(const PxVec3* vertices, PxU32 count, GLenum type)
 		{
+			const GLsizei stride = sizeof(PxVec3) + sizeof(PxU32);
+			const void* colors = vertices + 1;
+			GLint color_size = GL_BGRA;
+
+			if (!GLExtensions::HasVertexArrayBGRA())
+			{
+				debug_vertices.resize(count);
+				const PxU8* source = (const PxU8*)vertices;
+				for (PxU32 i = 0; i < count; i++, source += stride)
+				{
+					PxU32 color = *(const PxU32*)(source + sizeof(PxVec3));
+					DebugVertex& vertex = debug_vertices[i];
+					vertex.position = *(const PxVec3*)source;
+					vertex.color[0] = (PxU8)(color >> 16);
+					vertex.color[1] = (PxU8)(color >> 8);
+					vertex.color[2] = (PxU8)color;
+					vertex.color[3] = 0xff;
+				}
+				vertices = &debug_vertices.front().position;
+				colors = debug_vertices.front().color;
+				color_size = 4;
+			}
+
 			glEnableClientState(GL_VERTEX_ARRAY);
-			glVertexPointer(3,GL_FLOAT, 0, pVertList);
 			glEnableClientState(GL_COLOR_ARRAY);
-			glColorPointer(4, GL_FLOAT, 0, pColorList);
-			glDrawArrays(type, 0, num);
+			glVertexPointer(3, GL_FLOAT, stride, vertices);
+			glColorPointer(color_size, GL_UNSIGNED_BYTE, stride, colors);
+			glDrawArrays(type, 0, count);
 			glDisableClientState(GL_COLOR_ARRAY);
 			glDisableClientState(GL_VERTEX_ARRAY);
 		}
@@ -399,119 +903,106 @@ namespace VisualDebugger
 		{
 			glLineWidth(line_width);
 
-			//render points
+			//every point, line end and triangle corner is a position followed by a color
+			if (data.getNbPoints())
+				RenderDebugVertices(&data.getPoints()->pos, data.getNbPoints(), GL_POINTS);
 
-			unsigned int NbPoints = data.getNbPoints();
-			if(NbPoints)
-			{
-				std::vector<float> pVertList(NbPoints*3);
-				std::vector<float> pColorList(NbPoints*4);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const physx::PxDebugPoint* Points = data.getPoints();
-				while(NbPoints--)
-				{
-					pVertList[vertIndex++] = Points->pos.x;
-					pVertList[vertIndex++] = Points->pos.y;
-					pVertList[vertIndex++] = Points->pos.z;
-					pColorList[colorIndex++] = (float)((Points->color>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Points->color>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Points->color&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-					Points++;
-				}
+			if (data.getNbLines())
+				RenderDebugVertices(&data.getLines()->pos0, data.getNbLines()*2, GL_LINES);
 
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_POINTS, data.getNbPoints());
-			}
+			if (data.getNbTriangles())
+				RenderDebugVertices(&data.getTriangles()->pos0, data.getNbTriangles()*3, GL_TRIANGLES);
 
-			//render lines
+			//TODO: render texts ?
+		}
 
-			unsigned int NbLines = data.getNbLines();
-			if(NbLines)
-			{
-				std::vector<float> pVertList(NbLines*3*2);
-				std::vector<float> pColorList(NbLines*4*2);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const PxDebugLine* Lines = data.getLines();
-				while(NbLines--)
-				{
-					pVertList[vertIndex++] = Lines->pos0.x;
-					pVertList[vertIndex++] = Lines->pos0.y;
-					pVertList[vertIndex++] = Lines->pos0.z;
-					pColorList[colorIndex++] = (float)((Lines->color0>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Lines->color0>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Lines->color0&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pVertList[vertIndex++] = Lines->pos1.x;
-					pVertList[vertIndex++] = Lines->pos1.y;
-					pVertList[vertIndex++] = Lines->pos1.z;
-					pColorList[colorIndex++] = (float)((Lines->color1>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Lines->color1>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Lines->color1&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					Lines++;
-				}
+		void RenderText(const std::string& text, const physx::PxVec2& location, 
+			const PxVec3& color, PxReal size)
+		{
+			GLFontRenderer::setColor(color.x, color.y, color.z, 1.f);
+			GLFontRenderer::setScreenResolution(window_width, window_height);
+			GLFontRenderer::print(location.x, location.y, size, text.c_str());
+		}
 
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_LINES, data.getNbLines()*2);
-			}
+		bool BeginText()
+		{
+			GLFontRenderer::setScreenResolution(window_width, window_height);
+			return GLFontRenderer::begin();
+		}
 
-			//render triangles
+		void EndText()
+		{
+			GLFontRenderer::end();
+		}
+
+		void WindowSize(int& width, int& height)
+		{
+			width = window_width;
+			height = window_height;
+		}
+
+		void RenderGraph(const PxReal* samples, PxU32 count, PxU32 first, PxU32 capacity, PxReal max_value,
+			const PxVec2& location, const PxVec2& size, const PxVec3& color, bool background)
+		{
+			glDisable(GL_DEPTH_TEST);
+			glDisable(GL_LIGHTING);
+			glMatrixMode(GL_PROJECTION);
+			glPushMatrix();
+			glLoadIdentity();
+			glOrtho(0, 1, 0, 1, -1, 1);
+			glMatrixMode(GL_MODELVIEW);
+			glPushMatrix();
+			glLoadIdentity();
+
+			if (background)
+			{
+				glEnable(GL_BLEND);
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				glColor4f(1.f, 1.f, 1.f, .35f);
+				glRectf(location.x, location.y, location.x + size.x, location.y + size.y);
+				glDisable(GL_BLEND);
+			}
 
-			unsigned int NbTris = data.getNbTriangles();
-			if(NbTris)
+			//the newest sample is on the right edge, the graph is clamped to the box
+			if ((count > 1) && (max_value > 0.f))
 			{
-				std::vector<float> pVertList(NbTris*3*3);
-				std::vector<float> pColorList(NbTris*4*3);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const PxDebugTriangle* Triangles = data.getTriangles();
-				while(NbTris--)
+				graph_vertices.resize(count);
+				PxReal step = size.x / (capacity - 1);
+				PxReal x = location.x + size.x - step*(count - 1);
+				for (PxU32 i = 0; i < count; i++, x += step)
 				{
-					pVertList[vertIndex++] = Triangles->pos0.x;
-					pVertList[vertIndex++] = Triangles->pos0.y;
-					pVertList[vertIndex++] = Triangles->pos0.z;
-
-					pVertList[vertIndex++] = Triangles->pos1.x;
-					pVertList[vertIndex++] = Triangles->pos1.y;
-					pVertList[vertIndex++] = Triangles->pos1.z;
-
-					pVertList[vertIndex++] = Triangles->pos2.x;
-					pVertList[vertIndex++] = Triangles->pos2.y;
-					pVertList[vertIndex++] = Triangles->pos2.z;
-
-					pColorList[colorIndex++] = (float)((Triangles->color0>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color0>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color0&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pColorList[colorIndex++] = (float)((Triangles->color1>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color1>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color1&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pColorList[colorIndex++] = (float)((Triangles->color2>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color2>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color2&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					Triangles++;
+					PxReal value = PxClamp(samples[(first + i) % capacity] / max_value, 0.f, 1.f);
+					graph_vertices[i] = PxVec2(x, location.y + value*size.y);
 				}
 
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_TRIANGLES, data.getNbTriangles()*3);
+				glColor3f(color.x, color.y, color.z);
+				glEnableClientState(GL_VERTEX_ARRAY);
+				glVertexPointer(2, GL_FLOAT, sizeof(PxVec2), &graph_vertices.front());
+				glDrawArrays(GL_LINE_STRIP, 0, count);
+				glDisableClientState(GL_VERTEX_ARRAY);
 			}
 
-			//TODO: render texts ?
+			glMatrixMode(GL_PROJECTION);
+			glPopMatrix();
+			glMatrixMode(GL_MODELVIEW);
+			glPopMatrix();
+			glEnable(GL_DEPTH_TEST);
+			glEnable(GL_LIGHTING);
 		}
 
-		void RenderText(const std::string& text, const physx::PxVec2& location, 
-			const PxVec3& color, PxReal size)
+		void InterpolatePoses(const PoseHistory* history, PxReal alpha)
 		{
-			GLFontRenderer::setColor(color.x, color.y, color.z, 1.f);
-			GLFontRenderer::setScreenResolution(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
-			GLFontRenderer::print(location.x, location.y, size, text.c_str());
+			pose_history = history;
+			pose_alpha = PxClamp(alpha, 0.f, 1.f);
 		}
+
+		void GpuTiming(bool value)
+		{
+			gpu_timing = value;
+			if (!value)
+				gpu_time = -1.f;
+		}
+
+		PxReal GpuFrameTime() { return gpu_time; }
 	}
 }
@@ -2,17 +2,61 @@
 
 #include "PxPhysicsAPI.h"
 #include "GLFontRenderer.h"
-#include <GL/glut.h>
+#include "GLExtensions.h"
 #include <string>
 
+class PoseHistory;
+
 namespace VisualDebugger
 {
 	namespace Renderer
 	{
 		using namespace physx;
 
-		///Init rendering window
+		///Shadow rendering techniques
+		enum ShadowType
+		{
+			SHADOWS_OFF,
+			///every shape is drawn a second time, flattened onto the ground
+			SHADOWS_PROJECTED,
+			///a single depth pass from the light, sampled when drawing the ground
+			SHADOWS_MAP,
+			///a soft disc under every shape
+			SHADOWS_BLOB
+		};
+
+		///Number of level of detail tiers of spheres and capsules, the first one is the most detailed
+		const PxU32 LOD_TIERS = 4;
+
+		///Rendering statistics of the current frame
+		struct RenderStats
+		{
+			///shapes submitted for drawing
+			PxU32 drawn_shapes;
+			///shapes outside of the view frustum
+			PxU32 culled_shapes;
+			///spheres and capsules drawn at each level of detail
+			PxU32 lod_shapes[LOD_TIERS];
+			///multiplier of the level of detail thresholds (above 1 when the automatic mode reduces the detail)
+			PxReal lod_scale;
+			///heightfield tiles drawn and outside of the view frustum
+			PxU32 drawn_tiles, culled_tiles;
+
+			RenderStats() : drawn_shapes(0), culled_shapes(0), lod_scale(1.f), drawn_tiles(0), culled_tiles(0)
+			{
+				for (PxU32 i = 0; i < LOD_TIERS; i++)
+					lod_shapes[i] = 0;
+			}
+		};
+
+#ifndef RENDERER_EGL
+		///Init rendering window (GLUT, not available in the offscreen builds)
 		void InitWindow(const char *name, int width, int height);
+#endif
+
+		///Init an offscreen surface instead of the window, needs a build with RENDERER_EGL (EGL on Mesa)
+		///Returns false when no surface could be created.
+		bool InitOffscreen(int width, int height);
 
 		///Init renderer
 		void Init();
@@ -23,6 +67,10 @@ namespace VisualDebugger
 		///Render actors
 		void Render(PxActor** actors, const PxU32 numActors);
 
+		///Draw the dynamic actors alpha (0 to 1) of the way between the poses of the last two simulation steps,
+		///a null history draws the simulated poses
+		void InterpolatePoses(const PoseHistory* history, PxReal alpha);
+
 		///Render debug information
 		void Render(const PxRenderBuffer& data, PxReal line_width=1.f);
 
@@ -30,6 +78,21 @@ namespace VisualDebugger
 		void RenderText(const std::string& text, const physx::PxVec2& location, 
 			const PxVec3& color, PxReal size);
 
+		///Set up the text state once for several TextGeometry draws
+		///Returns false (and EndText is not needed) when the font texture could not be created.
+		bool BeginText();
+
+		///Restore the state changed by BeginText
+		void EndText();
+
+		///Size of the window or the offscreen surface in pixels
+		void WindowSize(int& width, int& height);
+
+		///Draw the last count samples of a ring buffer of capacity values (the oldest one at first) as a line graph,
+		///max_value is at the top of the box. The location (lower left corner) and the size are fractions of the window.
+		void RenderGraph(const PxReal* samples, PxU32 count, PxU32 first, PxU32 capacity, PxReal max_value,
+			const PxVec2& location, const PxVec2& size, const PxVec3& color, bool background=true);
+
 		///Set background color
 		void BackgroundColor(const PxVec3& background_color);
 
@@ -39,10 +102,58 @@ namespace VisualDebugger
 		///Set rendering detail for spheres and capsules.
 		void SetRenderDetail(int value);
 
+		///Choose the detail of every sphere and capsule from its size on the screen (on by default)
+		void LevelOfDetail(bool value);
+
+		///Get level of detail
+		bool LevelOfDetail();
+
+		///Lower the detail while frames take longer than frame_budget milliseconds, restore it when they get faster
+		void AutoLevelOfDetail(bool value, PxReal frame_budget=20.f);
+
 		///Set show shadows
 		void ShowShadows(bool value);
 
 		///Get show shadows
 		bool ShowShadows();
+
+		///Set the shadow technique, shadow maps fall back to projected shadows when not supported
+		void SetShadowType(ShadowType value);
+
+		///Get the shadow technique
+		ShadowType GetShadowType();
+
+		///Set the size of the shadow map texture (2048 by default)
+		void SetShadowMapResolution(int value);
+
+		///Bounds of the camera view volume up to distance metres from the camera
+		PxBounds3 ViewBounds(PxReal distance);
+
+		///Skip the shapes outside of the camera view
+		void FrustumCulling(bool value);
+
+		///Get frustum culling
+		bool FrustumCulling();
+
+		///Get the statistics of the current frame
+		const RenderStats& GetRenderStats();
+
+		///Measure the GPU time of the frames with timer queries (when supported by the driver)
+		void GpuTiming(bool value);
+
+		///GPU time of a recent frame in milliseconds, negative while unknown or not measured
+		PxReal GpuFrameTime();
+
+		///Draw triangle meshes with smooth (shared) or flat normals
+		void SmoothMeshNormals(bool value);
+
+		///Are triangle meshes drawn with smooth normals
+		bool SmoothMeshNormals();
+
+		///Draw boxes, spheres and capsules with instanced shaders (when supported by the driver)
+		void Instancing(bool value);
+
+		///Are boxes, spheres and capsules drawn with instanced shaders
+		bool Instancing();
 	}
 }
\ No newline at end of file
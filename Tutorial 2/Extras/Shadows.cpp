@@ -0,0 +1,210 @@
+#include "Shadows.h"
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace GLExtensions;
+
+		bool ShadowMap::Init(int value)
+		{
+			Release();
+
+			if (!HasFramebuffers())
+				return false;
+
+			resolution = value;
+
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, resolution, resolution, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0);
+			//linear filtering gives 2x2 percentage closer filtering on most drivers
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			//everything outside of the map is lit
+			PxReal border[] = { 1.f, 1.f, 1.f, 1.f };
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+			glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_TEXTURE_MODE, GL_LUMINANCE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+
+			GenFramebuffers(1, &framebuffer);
+			BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			FramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+			//depth only
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+			bool complete = (CheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+			BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+			if (!complete)
+				Release();
+
+			return complete;
+		}
+
+		void ShadowMap::Release()
+		{
+			if (framebuffer)
+				DeleteFramebuffers(1, &framebuffer);
+			if (texture)
+				glDeleteTextures(1, &texture);
+			framebuffer = texture = 0;
+		}
+
+		void ShadowMap::Begin(const PxVec3& center, PxReal extent, const PxVec3& direction)
+		{
+			glGetIntegerv(GL_VIEWPORT, viewport);
+			BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			glViewport(0, 0, resolution, resolution);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			glDisable(GL_LIGHTING);
+
+			//orthographic projection along the light direction, the light is placed extent metres away from the centre
+			PxVec3 dir = direction.getNormalized();
+			PxVec3 eye = center - dir*extent;
+			PxVec3 up = (PxAbs(dir.y) > .99f) ? PxVec3(0.f, 0.f, 1.f) : PxVec3(0.f, 1.f, 0.f);
+
+			glMatrixMode(GL_PROJECTION);
+			glPushMatrix();
+			glLoadIdentity();
+			glOrtho(-extent*.5f, extent*.5f, -extent*.5f, extent*.5f, 0.f, extent*2.f);
+
+			glMatrixMode(GL_MODELVIEW);
+			glPushMatrix();
+			glLoadIdentity();
+			gluLookAt(eye.x, eye.y, eye.z, center.x, center.y, center.z, up.x, up.y, up.z);
+
+			glEnable(GL_POLYGON_OFFSET_FILL);
+			glPolygonOffset(1.1f, 4.f);
+		}
+
+		void ShadowMap::End()
+		{
+			//texture matrix: [0,1] bias * light projection * light view
+			PxReal projection[16], view[16];
+			glGetFloatv(GL_PROJECTION_MATRIX, projection);
+			glGetFloatv(GL_MODELVIEW_MATRIX, view);
+
+			glDisable(GL_POLYGON_OFFSET_FILL);
+			glMatrixMode(GL_PROJECTION);
+			glPopMatrix();
+			glMatrixMode(GL_MODELVIEW);
+			glPopMatrix();
+
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			glEnable(GL_LIGHTING);
+			BindFramebuffer(GL_FRAMEBUFFER, 0);
+			glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+			PxMat44 bias(PxVec4(.5f, 0.f, 0.f, 0.f), PxVec4(0.f, .5f, 0.f, 0.f), PxVec4(0.f, 0.f, .5f, 0.f), PxVec4(.5f, .5f, .5f, 1.f));
+			PxMat44 texture_matrix = bias * PxMat44(projection) * PxMat44(view);
+
+			//eye planes are multiplied by the inverse of the current (camera) modelview,
+			//so the generated coordinates are the world positions transformed by the texture matrix
+			const GLenum coords[] = { GL_S, GL_T, GL_R, GL_Q };
+			for (PxU32 i = 0; i < 4; i++)
+			{
+				PxReal plane[] = { texture_matrix.column0[i], texture_matrix.column1[i], texture_matrix.column2[i], texture_matrix.column3[i] };
+				glTexGeni(coords[i], GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR);
+				glTexGenfv(coords[i], GL_EYE_PLANE, plane);
+			}
+		}
+
+		void ShadowMap::BeginReceiver(const PxVec3& shadow_color)
+		{
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glEnable(GL_TEXTURE_2D);
+			glEnable(GL_TEXTURE_GEN_S);
+			glEnable(GL_TEXTURE_GEN_T);
+			glEnable(GL_TEXTURE_GEN_R);
+			glEnable(GL_TEXTURE_GEN_Q);
+
+			//color = lit ? primary color : shadow color
+			PxReal color[] = { shadow_color.x, shadow_color.y, shadow_color.z, 1.f };
+			glTexEnvfv(GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, color);
+			glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+			glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_INTERPOLATE);
+			glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PRIMARY_COLOR);
+			glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_RGB, GL_CONSTANT);
+			glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE2_RGB, GL_TEXTURE);
+			glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_RGB, GL_SRC_COLOR);
+			glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND1_RGB, GL_SRC_COLOR);
+			glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND2_RGB, GL_SRC_COLOR);
+		}
+
+		void ShadowMap::EndReceiver()
+		{
+			glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+			glDisable(GL_TEXTURE_GEN_S);
+			glDisable(GL_TEXTURE_GEN_T);
+			glDisable(GL_TEXTURE_GEN_R);
+			glDisable(GL_TEXTURE_GEN_Q);
+			glDisable(GL_TEXTURE_2D);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+
+		void BlobShadows::Add(const PxBounds3& bounds, const PxVec3& direction)
+		{
+			const PxU32 segments = 12;
+
+			PxVec3 center = bounds.getCenter();
+			PxVec3 extents = bounds.getExtents();
+			PxReal height = PxMax(center.y, 0.f);
+
+			//follow the light down to the ground, blobs of higher shapes are bigger and lighter
+			PxVec3 ground = center - direction*(center.y/direction.y);
+			PxReal radius = PxMax(extents.x, extents.z) * (1.f + height*.05f);
+			PxReal alpha = darkness / (1.f + height*.2f);
+
+			BlobVertex middle = { PxVec3(ground.x, 0.f, ground.z), PxVec4(0.f, 0.f, 0.f, alpha) };
+			for (PxU32 i = 0; i < segments; i++)
+			{
+				PxReal a0 = PxTwoPi * i / segments;
+				PxReal a1 = PxTwoPi * (i+1) / segments;
+				BlobVertex rim0 = { PxVec3(ground.x + PxCos(a0)*radius, 0.f, ground.z + PxSin(a0)*radius), PxVec4(0.f, 0.f, 0.f, 0.f) };
+				BlobVertex rim1 = { PxVec3(ground.x + PxCos(a1)*radius, 0.f, ground.z + PxSin(a1)*radius), PxVec4(0.f, 0.f, 0.f, 0.f) };
+				vertices.push_back(middle);
+				vertices.push_back(rim1);
+				vertices.push_back(rim0);
+			}
+		}
+
+		void BlobShadows::Draw()
+		{
+			if (vertices.empty())
+				return;
+
+			glDisable(GL_LIGHTING);
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			//on top of the ground without writing depth
+			glDepthMask(GL_FALSE);
+			glEnable(GL_POLYGON_OFFSET_FILL);
+			glPolygonOffset(-1.f, -1.f);
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_COLOR_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(BlobVertex), &vertices.front().position);
+			glColorPointer(4, GL_FLOAT, sizeof(BlobVertex), &vertices.front().color);
+			glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+			glDisableClientState(GL_COLOR_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+
+			glDisable(GL_POLYGON_OFFSET_FILL);
+			glDepthMask(GL_TRUE);
+			glDisable(GL_BLEND);
+			glEnable(GL_LIGHTING);
+		}
+
+		void BlobShadows::Clear()
+		{
+			//keeps the capacity
+			vertices.clear();
+		}
+	}
+}
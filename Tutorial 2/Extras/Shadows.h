@@ -0,0 +1,80 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "GLExtensions.h"
+#include <vector>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///Depth map of the scene seen from a directional light
+		///
+		///The casters are drawn between Begin and End with the light view and projection on the GL matrix stacks.
+		///The receivers are drawn between BeginReceiver and EndReceiver: eye linear texture coordinates and the
+		///depth comparison of the fixed-function pipeline blend the shadowed pixels towards the shadow color.
+		class ShadowMap
+		{
+			GLuint texture, framebuffer;
+			int resolution;
+			GLint viewport[4];
+
+		public:
+			ShadowMap() : texture(0), framebuffer(0), resolution(0) {}
+
+			///Create the depth texture (resolution x resolution), returns false when not supported
+			bool Init(int value);
+
+			///Release the texture and the framebuffer
+			void Release();
+
+			///Is the shadow map ready
+			bool Enabled() const { return framebuffer != 0; }
+
+			///Size of the depth texture
+			int Resolution() const { return resolution; }
+
+			///Start the depth pass of a square area (extent metres wide) around center, lit along direction
+			void Begin(const PxVec3& center, PxReal extent, const PxVec3& direction);
+
+			///Finish the depth pass, needs the camera view on the modelview stack
+			void End();
+
+			///Start drawing shadow receivers
+			void BeginReceiver(const PxVec3& shadow_color);
+
+			///Finish drawing shadow receivers
+			void EndReceiver();
+		};
+
+		///Soft dark discs under the shapes, projected onto the ground plane along the light direction
+		///
+		///All blobs of a frame are collected and drawn with a single call.
+		class BlobShadows
+		{
+			struct BlobVertex
+			{
+				PxVec3 position;
+				PxVec4 color;
+			};
+
+			std::vector<BlobVertex> vertices;
+			PxReal darkness;
+
+		public:
+			///darkness is the opacity of the blob centre
+			BlobShadows(PxReal _darkness=.1f) : darkness(_darkness) {}
+
+			///Add a blob for a shape with the given world bounds
+			void Add(const PxBounds3& bounds, const PxVec3& direction);
+
+			///Draw all blobs
+			void Draw();
+
+			///Remove all blobs
+			void Clear();
+		};
+	}
+}
@@ -0,0 +1,65 @@
+#include "TextGeometry.h"
+#include "Renderer.h"
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace GLExtensions;
+
+		void TextGeometry::Clear()
+		{
+			glyphs.clear();
+			count = 0;
+			uploaded = false;
+		}
+
+		void TextGeometry::Add(const std::string& text, const PxVec2& location, PxReal size)
+		{
+			WindowSize(width, height);
+			GLFontRenderer::setScreenResolution(width, height);
+			count += GLFontRenderer::build(location.x, location.y, size, text.c_str(), glyphs);
+			uploaded = false;
+		}
+
+		void TextGeometry::Release()
+		{
+			if (buffer)
+				DeleteBuffers(1, &buffer);
+			buffer = 0;
+			uploaded = false;
+		}
+
+		bool TextGeometry::Resized() const
+		{
+			int window_width, window_height;
+			WindowSize(window_width, window_height);
+			return (window_width != width) || (window_height != height);
+		}
+
+		void TextGeometry::Draw(const PxVec3& color)
+		{
+			if (!count)
+				return;
+
+			GLFontRenderer::setColor(color.x, color.y, color.z, 1.f);
+
+			if (!HasBuffers())
+			{
+				GLFontRenderer::draw(&glyphs.front(), count);
+				return;
+			}
+
+			if (!buffer)
+				GenBuffers(1, &buffer);
+			BindBuffer(GL_ARRAY_BUFFER, buffer);
+			if (!uploaded)
+			{
+				BufferData(GL_ARRAY_BUFFER, glyphs.size()*sizeof(float), &glyphs.front(), GL_STATIC_DRAW);
+				uploaded = true;
+			}
+			GLFontRenderer::draw(0, count);
+			BindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "GLExtensions.h"
+#include <string>
+#include <vector>
+
+namespace VisualDebugger
+{
+	namespace Renderer
+	{
+		using namespace physx;
+
+		///Glyph quads of a block of text, built once and drawn with a single call
+		///
+		///The quads are in window pixels, the text has to be built again when Resized returns true.
+		///The glyphs are copied into a buffer object on the first Draw after a change.
+		class TextGeometry
+		{
+			//x, y, u, v of every glyph vertex
+			std::vector<float> glyphs;
+			PxU32 count;
+			GLuint buffer;
+			bool uploaded;
+			//window size the glyphs were built for
+			int width, height;
+
+			//the buffer object belongs to a single instance
+			TextGeometry(const TextGeometry&) = delete;
+			TextGeometry& operator=(const TextGeometry&) = delete;
+
+		public:
+			TextGeometry() : count(0), buffer(0), uploaded(false), width(0), height(0) {}
+
+			///Releases the buffer object
+			~TextGeometry() { Release(); }
+
+			///Release the buffer object, it is created again by the next Draw
+			void Release();
+
+			///Remove all glyphs
+			void Clear();
+
+			///Add a text at location (fraction of the window), size is the line height (fraction of the window height)
+			void Add(const std::string& text, const PxVec2& location, PxReal size);
+
+			///Has the window size changed since the glyphs were added
+			bool Resized() const;
+
+			///Draw all glyphs, call between Renderer::BeginText and Renderer::EndText
+			void Draw(const PxVec3& color);
+
+			///Number of glyphs
+			PxU32 Glyphs() const { return count; }
+		};
+	}
+}
@@ -8,7 +8,9 @@ class UserData
 public:
 	physx::PxVec3* color;
 	physx::PxClothMeshDesc* cloth_mesh_desc;
+	//level of detail tier of the previous frame (spheres and capsules), -1 before the first frame
+	int lod;
 
 	UserData(physx::PxVec3* _color=0, physx::PxClothMeshDesc* _cloth_mesh_desc=0) :
-		color(_color), cloth_mesh_desc(_cloth_mesh_desc) {}
+		color(_color), cloth_mesh_desc(_cloth_mesh_desc), lod(-1) {}
 };
\ No newline at end of file
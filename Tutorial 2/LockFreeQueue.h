@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+namespace PhysicsEngine
+{
+	///Bounded lock-free queue for a single producer and a single consumer thread
+	///
+	///The storage is allocated once in the constructor; Push and Pop never allocate.
+	///The capacity is rounded up to a power of two.
+	template<class T>
+	class LockFreeQueue
+	{
+		std::vector<T> items;
+		size_t mask;
+		//next slot to read, written by the consumer only
+		std::atomic<size_t> head;
+		//next slot to write, written by the producer only
+		std::atomic<size_t> tail;
+
+	public:
+		LockFreeQueue(size_t capacity=1024) : head(0), tail(0)
+		{
+			size_t size = 1;
+			while (size < capacity)
+				size <<= 1;
+			items.resize(size);
+			mask = size - 1;
+		}
+
+		///Add an item (producer thread), returns false if the queue is full
+		bool Push(const T& item)
+		{
+			size_t t = tail.load(std::memory_order_relaxed);
+			if (t - head.load(std::memory_order_acquire) >= items.size())
+				return false;
+			items[t & mask] = item;
+			tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		///Remove the oldest item (consumer thread), returns false if the queue is empty
+		bool Pop(T& item)
+		{
+			size_t h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire))
+				return false;
+			item = items[h & mask];
+			head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+
+		///Number of queued items (approximate while the other thread is active)
+		size_t Size() const
+		{
+			return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+		}
+
+		///Maximum number of queued items
+		size_t Capacity() const
+		{
+			return items.size();
+		}
+	};
+}
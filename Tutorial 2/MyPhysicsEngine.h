@@ -1,8 +1,11 @@
 #pragma once
 
 #include "BasicActors.h"
+#include "SceneLoader.h"
+#include "BinaryScene.h"
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 
 namespace PhysicsEngine
 {
@@ -12,6 +15,34 @@ namespace PhysicsEngine
 	static const PxVec3 color_palette[] = { PxVec3(46.f / 255.f,9.f / 255.f,39.f / 255.f),PxVec3(217.f / 255.f,0.f / 255.f,0.f / 255.f),
 		PxVec3(255.f / 255.f,45.f / 255.f,0.f / 255.f),PxVec3(255.f / 255.f,140.f / 255.f,54.f / 255.f),PxVec3(4.f / 255.f,117.f / 255.f,111.f / 255.f) };
 
+	//collision filter groups used for the contact reports
+	struct FilterGroup
+	{
+		enum Enum
+		{
+			BALL		= (1 << 0),
+			CROSSBAR	= (1 << 1),
+			GOALPOST	= (1 << 2),
+			PITCHFORK	= (1 << 3),
+			KNIGHT		= (1 << 4)
+		};
+	};
+
+	//scene specific commands (Command::CUSTOM), see MyScene::CustomCommand
+	struct MyCommand
+	{
+		enum Enum
+		{
+			SWING_JOINT,
+			SPAWN_BALL,
+			//position and direction of the camera
+			FIRE_FORK,
+			GLASS_PLANE,
+			EXAMPLE_KEY_PRESS,
+			EXAMPLE_KEY_RELEASE
+		};
+	};
+
 	//pyramid vertices
 	static PxVec3 pyramid_verts[] = { PxVec3(0,1,0), PxVec3(1,0,0), PxVec3(-1,0,0), PxVec3(0,0,1), PxVec3(0,0,-1) };
 	//pyramid triangles: a list of three vertices for each triangle e.g. the first triangle consists of vertices 1, 4 and 0
@@ -39,15 +70,18 @@ namespace PhysicsEngine
 	///Custom scene class
 	class MyScene : public Scene
 	{
-		Plane* plane;
+		//the actors used by the gameplay are found by name in a loaded layout
+		Actor* plane;
+		HeightField* terrain;
 		Box* brick;
 		GoalPost* goalPost;
 		GoalCrossbar* goalCrossbar;
+		Cloth* goalNet;
 		SwingPost* swingPost;
-		SwingTopBar* swingTopBar;
+		Actor* swingTopBar;
 		RugbyBall* rugbyBall;
 		Pitchfork* pitchfork;
-		Truncheon* truncheon;
+		Actor* truncheon;
 		InnerPitchLines* innerPitchLines;
 		OuterPitchLines* outerPitchLines;
 		InnerBarrierLines* innerBarrierLines;
@@ -55,16 +89,34 @@ namespace PhysicsEngine
 		BallCatapult* ballCatapult;
 		Knights* knights;
 		RevoluteJoint* ballChain;
+		Actor* goalZone;
+		Actor* tryZones[2];
+		Actor* outZones[4];
+		//layout loaded instead of the built-in one
+		std::string layout_file;
+		SceneLoader layout;
+		BinaryScene binary_layout;
 
 		//https://saferroadsconference.com/wp-content/uploads/2016/05/Peter-Cenek-Frictional-Characteristics-Roadside-Grass-Types.pdf
-		PxMaterial* grassMat = CreateMaterial(0.35f, 0.5f, 0.f);
+		PxMaterial* grassMat = SharedMaterial(0.35f, 0.5f, 0.f);
 		//https://www.engineeringtoolbox.com/friction-coefficients-d_778.html
-		PxMaterial* rubberMat = CreateMaterial(0.9f, 0.65f, 0.828f);
-		PxMaterial* woodMat = CreateMaterial(0.5f, 0.48f, 0.6f);
-		PxMaterial* metalMat = CreateMaterial(0.8f, 0.42f, 0.6f);
-		PxMaterial* glassMat = CreateMaterial(0.9, 0.4, 0.69);
+		PxMaterial* rubberMat = SharedMaterial(0.9f, 0.65f, 0.828f);
+		PxMaterial* woodMat = SharedMaterial(0.5f, 0.48f, 0.6f);
+		PxMaterial* metalMat = SharedMaterial(0.8f, 0.42f, 0.6f);
+		PxMaterial* glassMat = SharedMaterial(0.9f, 0.4f, 0.69f);
 
 	public:
+		MyScene() : plane(0), swingTopBar(0), truncheon(0), goalZone(0), tryZones(), outZones(), layout(this), binary_layout(this) {}
+
+		///Build the scene from a scene file instead of the built-in layout (applied on Init/Reset)
+		///Text files are read by SceneLoader, files written by BinaryScene::Write are mapped by BinaryScene.
+		///The gameplay looks for the actors named plane, truncheon, swing_top_bar, goal_zone, try_zone_0..1
+		///and out_zone_0..3, the keys using a missing actor do nothing.
+		void LayoutFile(const std::string& filename)
+		{
+			layout_file = filename;
+		}
+
 		///A custom scene class
 		void SetVisualisation()
 		{
@@ -83,16 +135,28 @@ namespace PhysicsEngine
 			SetVisualisation();
 
 			GetMaterial()->setDynamicFriction(.2f);
+
+			if (layout_file.size())
+			{
+				LoadLayout();
+				return;
+			}
 			
 			//spawns grass and rugby pitch lines
 			RugbyPitch();
 
+			//hills around the pitch
+			Terrain();
+
 			//barrier castle spawn
 			Barrier();
 
 			//goal spawn function
 			Goal();
 
+			//goal, try and out of play zones
+			Zones();
+
 			//ball spawn function
 			Ball();
 
@@ -109,6 +173,44 @@ namespace PhysicsEngine
 			KnightArmy();
 		}
 
+		void LoadLayout()
+		{
+			//the actors of the previous scene are released with it
+			layout.Clear();
+			binary_layout.Clear();
+
+			bool binary = BinaryScene::IsBinary(layout_file);
+			if (binary)
+				binary_layout.Load(layout_file);
+			else
+				layout.Load(layout_file);
+
+			plane = FindLayoutActor("plane");
+			truncheon = FindLayoutActor("truncheon");
+			swingTopBar = FindLayoutActor("swing_top_bar");
+			goalZone = FindLayoutActor("goal_zone");
+			for (int i = 0; i < 2; i++)
+				tryZones[i] = FindLayoutActor("try_zone_" + to_string(i));
+			for (int i = 0; i < 4; i++)
+				outZones[i] = FindLayoutActor("out_zone_" + to_string(i));
+
+			const SceneLoadStats& stats = binary ? binary_layout.Stats() : layout.Stats();
+			stringstream text;
+			text << fixed << setprecision(1) << "Loaded " << layout_file << ": " << stats.actors << " actors, " << stats.shapes << " shapes, "
+				<< stats.joints << " joints in " << stats.total_ms << " ms (" << stats.PerTenThousand() << " ms per 10k actors, "
+				<< stats.add_ms << " ms in " << stats.batches << " addActors batches)" << endl;
+			for (unsigned int i = 0; i < stats.split_ms.size(); i++)
+				text << "  actors " << i*10 << "k-" << (i+1)*10 << "k: " << stats.split_ms[i] << " ms" << endl;
+			cerr << text.str();
+		}
+
+		//named actor of the loaded layout, text or binary
+		Actor* FindLayoutActor(const std::string& name)
+		{
+			Actor* actor = layout.Find(name);
+			return actor ? actor : binary_layout.Find(name);
+		}
+
 		void RugbyPitch() 
 		{
 			//this function adds a plane with a colour and grass material to the scene along with pitch lines
@@ -120,6 +222,31 @@ namespace PhysicsEngine
 			PitchLines();
 		}
 
+		void Terrain()
+		{
+			//2km x 2km of hills centred on the pitch, the flat middle stays just below the plane
+			const PxU32 samples = 513;
+			const PxVec3 size(2048.f, 80.f, 2048.f);
+			std::vector<PxReal> heights(samples*samples);
+			for (PxU32 r = 0; r < samples; r++)
+			{
+				for (PxU32 c = 0; c < samples; c++)
+				{
+					PxReal x = r*size.x/(samples-1) - size.x*.5f;
+					PxReal z = c*size.z/(samples-1) - size.z*.5f;
+					//no hills up to 200m from the centre, full height 400m further
+					PxReal ramp = PxClamp((PxSqrt(x*x + z*z) - 200.f) / 400.f, 0.f, 1.f);
+					PxReal hills = .5f + .3f*PxSin(x*.011f)*PxCos(z*.013f) + .2f*PxSin(x*.031f + z*.027f);
+					heights[r*samples + c] = (-1.f + ramp*ramp*(3.f - 2.f*ramp)*hills*size.y) / size.y;
+				}
+			}
+
+			terrain = new HeightField(heights, samples, samples, size, PxTransform(PxVec3(-size.x*.5f, 0.f, -39.f - size.z*.5f)));
+			terrain->Color(PxVec3(60.f / 255.f, 140.f / 255.f, 40.f / 255.f));
+			terrain->Material(grassMat);
+			Add(terrain);
+		}
+
 		void PitchLines()
 		{
 			//this function spawns silver lines onto the play area of the pitch
@@ -130,6 +257,10 @@ namespace PhysicsEngine
 			outerPitchLines = new OuterPitchLines();
 			outerPitchLines->Color(PxVec3(191.f / 255.f, 191.f / 255.f, 191.f / 255.f));
 			Add(outerPitchLines);
+
+			//flat decoration, nothing to see in the debug view
+			innerPitchLines->Visualization(false);
+			outerPitchLines->Visualization(false);
 		}
 
 		void Fork(PxVec3 camPos, PxVec3 camDir)
@@ -139,6 +270,7 @@ namespace PhysicsEngine
 			pitchfork->Color(PxVec3(64.f / 255.f, 35.f / 255.f, 25.f / 255.f)); //colour set to light brown (wood)
 			pitchfork->Material(woodMat);
 			pitchfork->Get()->is<PxRigidDynamic>()->setMass(3); //mass set to 3kg
+			pitchfork->SetupFiltering(FilterGroup::PITCHFORK, FilterGroup::KNIGHT); //report hits on the knights
 			Add(pitchfork);
 			pitchfork->Get()->is<PxRigidDynamic>()->addForce(PxVec3(camDir.x, camDir.y, camDir.z)* 100000); //once spawned, force is added to the camera direction.xyz
 		}
@@ -172,11 +304,40 @@ namespace PhysicsEngine
 			//goal post and cross bar added to the scene along with a metal material
 			goalPost = new GoalPost();
 			goalPost->Material(metalMat);
+			goalPost->SetupFiltering(FilterGroup::GOALPOST, FilterGroup::BALL);
 			Add(goalPost);
 
 			goalCrossbar = new GoalCrossbar();
 			goalCrossbar->Material(metalMat);
+			goalCrossbar->SetupFiltering(FilterGroup::CROSSBAR, FilterGroup::BALL);
 			Add(goalCrossbar);
+
+			//net hanging from the back of the crossbar down to the ground, between the posts
+			goalNet = new Cloth(PxTransform(PxVec3(-2.3f, 2.5f, -72.f), PxQuat(PxHalfPi, PxVec3(1.f, 0.f, 0.f))), PxVec2(4.6f, 3.f), 23, 15);
+			goalNet->Color(PxVec3(1.f, 1.f, 1.f));
+			Add(goalNet);
+		}
+
+		void Zones()
+		{
+			//goal mouth: between the posts and above the crossbar, across the goal line
+			goalZone = new Zone(PxTransform(PxVec3(0.f, 14.75f, -71.42857145f)), PxVec3(2.3f, 11.25f, 1.f));
+			Add(goalZone);
+
+			//in-goal areas between the goal lines and the dead ball lines
+			tryZones[0] = new Zone(PxTransform(PxVec3(0.f, .5f, -78.5714286f)), PxVec3(70.f, .5f, 7.14285714f));
+			tryZones[1] = new Zone(PxTransform(PxVec3(0.f, .5f, -7.14285714f)), PxVec3(70.f, .5f, 7.14285714f));
+
+			//out of play: behind the touch lines and the dead ball lines, up to the barriers
+			outZones[0] = new Zone(PxTransform(PxVec3(70.25f, 25.f, -34.f)), PxVec3(.25f, 25.f, 55.f));
+			outZones[1] = new Zone(PxTransform(PxVec3(-70.25f, 25.f, -34.f)), PxVec3(.25f, 25.f, 55.f));
+			outZones[2] = new Zone(PxTransform(PxVec3(0.f, 25.f, 9.f)), PxVec3(70.f, 25.f, 9.f));
+			outZones[3] = new Zone(PxTransform(PxVec3(0.f, 25.f, -87.2142857f)), PxVec3(70.f, 25.f, 1.5f));
+
+			for (int i = 0; i < 2; i++)
+				Add(tryZones[i]);
+			for (int i = 0; i < 4; i++)
+				Add(outZones[i]);
 		}
 
 		void SwingArch()
@@ -198,6 +359,7 @@ namespace PhysicsEngine
 			//https://www.gilbertrugby.com/blogs/news/rugby-balls-which-ball-do-i-need#:~:text=7%20facts%20about%20Rugby%20Balls,and%20made%20of%20four%20panels.&text=It%20weighs%20410%2D460%20grams,for%20matches%20between%20young%20players.
 			//rugby ball max weight is usually 460 grams
 			rugbyBall->Get()->is<PxRigidDynamic>()->setMass(0.460); 
+			rugbyBall->SetupFiltering(FilterGroup::BALL, FilterGroup::CROSSBAR | FilterGroup::GOALPOST); //report hits on the goal
 			Add(rugbyBall);
 		}
 
@@ -213,6 +375,8 @@ namespace PhysicsEngine
 		void SwingJoint() 
 		{
 			//this function handles the swing joint and is called when pressing F1
+			if (!swingTopBar || !truncheon || !truncheon->Get()->is<PxRigidDynamic>())
+				return;
 			ballChain = new RevoluteJoint(swingTopBar, PxTransform(PxVec3(0.f, 8.f, 0.f)), truncheon, PxTransform(PxVec3(0.f, 6.f, -1.f)));
 			truncheon->Get()->is<PxRigidDynamic>()->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, false);
 			ballChain->DriveVelocity(PxReal(100));
@@ -223,12 +387,15 @@ namespace PhysicsEngine
 			//spawn function for spawing cubes "knights" that guard the goal
 			knights = new Knights(PxTransform(PxVec3(0.f, 1.f, -57.14285716f)));
 			knights->Color(PxVec3(191.f / 255.f, 128.f / 255.f, 105.f / 255.f));
+			knights->SetupFiltering(FilterGroup::KNIGHT, FilterGroup::PITCHFORK);
 			Add(knights);
 		}
 
 		void PlaneTranformation() 
 		{
 			//this function changes the plane to a glass colour and applies a glass friction material
+			if (!plane)
+				return;
 			plane->Color(PxVec3(242.f / 255.f, 242.f / 255.f, 242.f / 255.f));
 			plane->Material(glassMat);
 		}
@@ -245,10 +412,83 @@ namespace PhysicsEngine
 			cerr << "I am pressed!" << endl;
 		}
 
+		//is the PhysX actor wrapped by actor (which can be missing from a loaded layout)
+		static bool IsActor(Actor* actor, PxActor* px_actor)
+		{
+			return actor && (actor->Get() == px_actor);
+		}
+
+		//handle the zone events, the cost depends on the number of events and not on the number of balls
+		void ZoneEvents()
+		{
+			TriggerEvent event;
+			while (PollTrigger(event))
+			{
+				//only count the balls, once per ball (by their first shape)
+				if (!event.enter || !(event.other_shape->getSimulationFilterData().word0 & FilterGroup::BALL))
+					continue;
+				PxShape* first_shape = 0;
+				event.other_actor->getShapes(&first_shape, 1);
+				if (event.other_shape != first_shape)
+					continue;
+
+				if (IsActor(goalZone, event.trigger_actor))
+					cerr << "Goal! The ball cleared the crossbar" << endl;
+				else if (IsActor(tryZones[0], event.trigger_actor) || IsActor(tryZones[1], event.trigger_actor))
+					cerr << "Ball in the in-goal area" << endl;
+				else
+					cerr << "Ball out of play" << endl;
+			}
+		}
+
+		//apply the commands of the input keys, between the simulation steps
+		virtual void CustomCommand(const Command& command)
+		{
+			switch (command.value)
+			{
+			case MyCommand::SWING_JOINT:
+				SwingJoint();
+				break;
+			case MyCommand::SPAWN_BALL:
+				Ball();
+				break;
+			case MyCommand::FIRE_FORK:
+				Fork(command.position, command.direction);
+				break;
+			case MyCommand::GLASS_PLANE:
+				PlaneTranformation();
+				break;
+			case MyCommand::EXAMPLE_KEY_PRESS:
+				ExampleKeyPressHandler();
+				break;
+			case MyCommand::EXAMPLE_KEY_RELEASE:
+				ExampleKeyReleaseHandler();
+				break;
+			default:
+				break;
+			}
+		}
+
 		//Custom update function
 		virtual void CustomUpdate()
 		{
-
+			ZoneEvents();
+
+			//react to the impacts of the last step, the contact buffer is preallocated so this does not allocate
+			const ContactBuffer& contacts = GetContacts();
+			for (const ContactReport& contact : contacts)
+			{
+				if (!(contact.events & PxPairFlag::eNOTIFY_TOUCH_FOUND))
+					continue;
+
+				PxU32 groups = contact.shapes[0]->getSimulationFilterData().word0 | contact.shapes[1]->getSimulationFilterData().word0;
+				if (groups == (FilterGroup::BALL | FilterGroup::CROSSBAR))
+					cerr << "Ball hit the crossbar, impulse " << contact.impulse.magnitude() << endl;
+				else if (groups == (FilterGroup::BALL | FilterGroup::GOALPOST))
+					cerr << "Ball hit the post, impulse " << contact.impulse.magnitude() << endl;
+				else if (groups == (FilterGroup::PITCHFORK | FilterGroup::KNIGHT))
+					cerr << "Knight hit by a pitchfork, impulse " << contact.impulse.magnitude() << endl;
+			}
 		}
 	};
 }
@@ -1,14 +1,83 @@
 #include "PhysicsEngine.h"
 #include <iostream>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <map>
+#include <mutex>
 
 namespace PhysicsEngine
 {
 	using namespace physx;
 	using namespace std;
 
+	///Allocator that keeps track of the memory requested by PhysX
+	///Each block is prefixed with a 16 byte header holding its size, so the returned pointer stays 16 byte aligned.
+	class TrackingAllocator : public PxAllocatorCallback
+	{
+		static const size_t header_size = 16;
+
+		PxDefaultAllocator allocator;
+		std::atomic<size_t> allocated_bytes;
+		std::atomic<size_t> peak_bytes;
+		std::atomic<size_t> allocation_count;
+
+	public:
+		TrackingAllocator() : allocated_bytes(0), peak_bytes(0), allocation_count(0) {}
+
+		virtual void* allocate(size_t size, const char* typeName, const char* filename, int line)
+		{
+			PxU8* block = (PxU8*)allocator.allocate(size + header_size, typeName, filename, line);
+			if (!block)
+				return 0;
+
+			*(size_t*)block = size;
+			allocation_count++;
+			size_t current = (allocated_bytes += size);
+			size_t peak = peak_bytes;
+			while ((current > peak) && !peak_bytes.compare_exchange_weak(peak, current)) {}
+
+			return block + header_size;
+		}
+
+		virtual void deallocate(void* ptr)
+		{
+			if (!ptr)
+				return;
+
+			PxU8* block = (PxU8*)ptr - header_size;
+			allocated_bytes -= *(size_t*)block;
+			allocator.deallocate(block);
+		}
+
+		size_t AllocatedBytes() const { return allocated_bytes; }
+
+		size_t PeakBytes() const { return peak_bytes; }
+
+		size_t AllocationCount() const { return allocation_count; }
+
+		void ResetPeak() { peak_bytes = (size_t)allocated_bytes; }
+	};
+
+	///Error callback printing the messages, debug builds stop at a scene accessed without the lock it requires
+	class ErrorCallback : public PxDefaultErrorCallback
+	{
+	public:
+		virtual void reportError(PxErrorCode::Enum code, const char* message, const char* file, int line)
+		{
+			PxDefaultErrorCallback::reportError(code, message, file, line);
+#ifdef _DEBUG
+			//PxSceneFlag::eREQUIRE_RW_LOCK reports the unlocked calls as invalid operations:
+			//"An API read/write call (...) was made from thread ... but PxScene::lockRead()/lockWrite() was not called first"
+			assert(!((code == PxErrorCode::eINVALID_OPERATION) &&
+				(strstr(message, "PxScene::lockRead() was not called first") || strstr(message, "PxScene::lockWrite() was not called first"))));
+#endif
+		}
+	};
+
 	//default error and allocator callbacks
-	PxDefaultErrorCallback gDefaultErrorCallback;
-	PxDefaultAllocator gDefaultAllocatorCallback;
+	ErrorCallback gDefaultErrorCallback;
+	TrackingAllocator gDefaultAllocatorCallback;
 
 	//PhysX objects
 	PxFoundation* foundation = 0;
@@ -20,6 +89,11 @@ namespace PhysicsEngine
 	PxPhysics* physics = 0;
 	PxCooking* cooking = 0;
 
+	//materials and meshes shared by the scenes, the scenes can be built on different threads
+	std::mutex shared_mutex;
+	std::map<std::string, PxMaterial*> shared_materials;
+	std::map<std::string, PxConvexMesh*> shared_convex_meshes;
+
 	///PhysX functions
 	void PxInit()
 	{
@@ -70,6 +144,10 @@ namespace PhysicsEngine
 
 	void PxRelease()
 	{
+		//released with the SDK
+		shared_materials.clear();
+		shared_convex_meshes.clear();
+
 		if (cooking)
 			cooking->release();
 		if (physics)
@@ -92,9 +170,10 @@ namespace PhysicsEngine
 
 	PxMaterial* GetMaterial(PxU32 index)
 	{
-		std::vector<PxMaterial*> materials(physics->getNbMaterials());
-		if (index < physics->getMaterials((PxMaterial**)&materials.front(), (PxU32)materials.size()))
-			return materials[index];
+		//fetch only the requested material
+		PxMaterial* material = 0;
+		if (physics->getMaterials(&material, 1, index))
+			return material;
 		else
 			return 0;
 	}
@@ -104,6 +183,154 @@ namespace PhysicsEngine
 		return physics->createMaterial(sf, df, cr);
 	}
 
+	PxMaterial* SharedMaterial(PxReal sf, PxReal df, PxReal cr)
+	{
+		const PxReal coefficients[3] = { sf, df, cr };
+		std::string key((const char*)coefficients, sizeof(coefficients));
+
+		std::lock_guard<std::mutex> lock(shared_mutex);
+		PxMaterial*& material = shared_materials[key];
+		if (!material)
+			material = CreateMaterial(sf, df, cr);
+		return material;
+	}
+
+	PxConvexMesh* SharedConvexMesh(const std::vector<PxVec3>& verts)
+	{
+		std::string key((const char*)verts.data(), verts.size()*sizeof(PxVec3));
+
+		std::lock_guard<std::mutex> lock(shared_mutex);
+		PxConvexMesh*& mesh = shared_convex_meshes[key];
+		if (!mesh)
+		{
+			PxConvexMeshDesc mesh_desc;
+			mesh_desc.points.count = (PxU32)verts.size();
+			mesh_desc.points.stride = sizeof(PxVec3);
+			mesh_desc.points.data = verts.data();
+			mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
+			mesh_desc.vertexLimit = 256;
+
+			PxDefaultMemoryOutputStream stream;
+			if (!cooking->cookConvexMesh(mesh_desc, stream))
+			{
+				shared_convex_meshes.erase(key);
+				throw new Exception("PhysicsEngine::SharedConvexMesh, cooking failed.");
+			}
+			PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+			mesh = physics->createConvexMesh(input);
+		}
+		return mesh;
+	}
+
+	size_t GetAllocatedBytes()
+	{
+		return gDefaultAllocatorCallback.AllocatedBytes();
+	}
+
+	size_t GetPeakAllocatedBytes()
+	{
+		return gDefaultAllocatorCallback.PeakBytes();
+	}
+
+	void ResetPeakAllocatedBytes()
+	{
+		gDefaultAllocatorCallback.ResetPeak();
+	}
+
+	size_t GetAllocationCount()
+	{
+		return gDefaultAllocatorCallback.AllocationCount();
+	}
+
+	PxFilterFlags ContactReportFilterShader(PxFilterObjectAttributes attributes0, PxFilterData filterData0,
+		PxFilterObjectAttributes attributes1, PxFilterData filterData1,
+		PxPairFlags& pairFlags, const void* constantBlock, PxU32 constantBlockSize)
+	{
+		//let triggers through
+		if (PxFilterObjectIsTrigger(attributes0) || PxFilterObjectIsTrigger(attributes1))
+		{
+			pairFlags = PxPairFlag::eTRIGGER_DEFAULT;
+			return PxFilterFlags();
+		}
+
+		pairFlags = PxPairFlag::eCONTACT_DEFAULT;
+
+		//report contacts only when both shapes have flagged each other
+		if ((filterData0.word0 & filterData1.word1) && (filterData1.word0 & filterData0.word1))
+		{
+			pairFlags |= PxPairFlag::eNOTIFY_TOUCH_FOUND;
+			pairFlags |= PxPairFlag::eNOTIFY_TOUCH_LOST;
+			pairFlags |= PxPairFlag::eNOTIFY_CONTACT_POINTS;
+		}
+
+		return PxFilterFlags();
+	}
+
+	///SimulationEventCallback methods
+
+	void SimulationEventCallback::onContact(const PxContactPairHeader& pairHeader, const PxContactPair* pairs, PxU32 nbPairs)
+	{
+		//contact points are extracted into a fixed stack buffer, nothing is allocated here
+		const PxU32 max_points = 16;
+		PxContactPairPoint points[max_points];
+
+		for (PxU32 i = 0; i < nbPairs; i++)
+		{
+			const PxContactPair& pair = pairs[i];
+			if (pair.flags & (PxContactPairFlag::eREMOVED_SHAPE_0 | PxContactPairFlag::eREMOVED_SHAPE_1))
+				continue;
+
+			//a full buffer counts every remaining pair as dropped
+			ContactReport* report = contacts->Next();
+			if (!report)
+				continue;
+
+			report->actors[0] = pairHeader.actors[0];
+			report->actors[1] = pairHeader.actors[1];
+			report->shapes[0] = pair.shapes[0];
+			report->shapes[1] = pair.shapes[1];
+			report->events = (PxU32)(pair.events & (PxPairFlag::eNOTIFY_TOUCH_FOUND | PxPairFlag::eNOTIFY_TOUCH_PERSISTS | PxPairFlag::eNOTIFY_TOUCH_LOST));
+			report->position = PxVec3(0.f);
+			report->normal = PxVec3(0.f);
+			report->impulse = PxVec3(0.f);
+
+			PxU32 num_points = pair.extractContacts(points, max_points);
+			report->contact_count = num_points;
+			for (PxU32 j = 0; j < num_points; j++)
+			{
+				report->position += points[j].position;
+				report->normal += points[j].normal;
+				report->impulse += points[j].impulse;
+			}
+
+			if (num_points)
+			{
+				report->position /= (PxReal)num_points;
+				report->normal.normalize();
+			}
+		}
+	}
+
+	void SimulationEventCallback::onTrigger(PxTriggerPair* pairs, PxU32 count)
+	{
+		for (PxU32 i = 0; i < count; i++)
+		{
+			//ignore pairs when shapes have been deleted
+			if (pairs[i].flags & (PxTriggerPairFlag::eREMOVED_SHAPE_TRIGGER | PxTriggerPairFlag::eREMOVED_SHAPE_OTHER))
+				continue;
+
+			TriggerEvent event;
+			event.trigger_actor = pairs[i].triggerActor;
+			event.trigger_shape = pairs[i].triggerShape;
+			event.other_actor = pairs[i].otherActor;
+			event.other_shape = pairs[i].otherShape;
+			event.enter = (pairs[i].status == PxPairFlag::eNOTIFY_TOUCH_FOUND);
+
+			if (!triggers->Push(event))
+				dropped_triggers++;
+		}
+	}
+
 	///Actor methods
 
 	PxActor* Actor::Get()
@@ -136,21 +363,36 @@ namespace PhysicsEngine
 
 	void Actor::Material(PxMaterial* new_material, PxU32 shape_index)
 	{
-		std::vector<PxShape*> shape_list = GetShapes(shape_index);
-		for (PxU32 i = 0; i < shape_list.size(); i++)
+		PxU32 first = 0, last = ((PxRigidActor*)actor)->getNbShapes();
+		if (shape_index != -1)
 		{
-			std::vector<PxMaterial*> materials(shape_list[i]->getNbMaterials());
-			for (unsigned int j = 0; j < materials.size(); j++)
-				materials[j] = new_material;
-			shape_list[i]->setMaterials(materials.data(), (PxU16)materials.size());
+			first = shape_index;
+			last = PxMin(shape_index + 1, last);
+		}
+
+		for (PxU32 i = first; i < last; i++)
+		{
+			PxShape* shape = GetShape(i);
+			PxU16 num_materials = shape->getNbMaterials();
+			//single material shapes do not need a temporary list
+			if (num_materials == 1)
+			{
+				shape->setMaterials(&new_material, 1);
+			}
+			else
+			{
+				std::vector<PxMaterial*> materials(num_materials, new_material);
+				shape->setMaterials(materials.data(), num_materials);
+			}
 		}
 	}
 
 	PxShape* Actor::GetShape(PxU32 index)
 	{
-		std::vector<PxShape*> shapes(((PxRigidActor*)actor)->getNbShapes());
-		if (index < ((PxRigidActor*)actor)->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size()))
-			return shapes[index];
+		//fetch only the requested shape
+		PxShape* shape = 0;
+		if (((PxRigidActor*)actor)->getShapes(&shape, 1, index))
+			return shape;
 		else
 			return 0;
 	}
@@ -169,6 +411,38 @@ namespace PhysicsEngine
 			return std::vector<PxShape*>();
 	}
 
+	void Actor::SetupFiltering(PxU32 filterGroup, PxU32 filterMask, PxU32 shape_index)
+	{
+		std::vector<PxShape*> shape_list = GetShapes(shape_index);
+		for (PxU32 i = 0; i < shape_list.size(); i++)
+		{
+			PxFilterData filterData;
+			filterData.word0 = filterGroup; //word0 = own ID
+			filterData.word1 = filterMask;	//word1 = ID mask to filter pairs that trigger a contact callback
+			shape_list[i]->setSimulationFilterData(filterData);
+		}
+	}
+
+	void Actor::SetTrigger(bool value, PxU32 shape_index)
+	{
+		std::vector<PxShape*> shape_list = GetShapes(shape_index);
+		for (PxU32 i = 0; i < shape_list.size(); i++)
+		{
+			//a shape cannot be a simulation and a trigger shape at the same time
+			shape_list[i]->setFlag(PxShapeFlag::eSIMULATION_SHAPE, !value);
+			shape_list[i]->setFlag(PxShapeFlag::eTRIGGER_SHAPE, value);
+		}
+	}
+
+	void Actor::Visualization(bool value)
+	{
+		//the actor flag covers the actor axes and velocities, the shape flags the collision shapes
+		actor->setActorFlag(PxActorFlag::eVISUALIZATION, value);
+		std::vector<PxShape*> shape_list = GetShapes();
+		for (PxU32 i = 0; i < shape_list.size(); i++)
+			shape_list[i]->setFlag(PxShapeFlag::eVISUALIZATION, value);
+	}
+
 	void Actor::Name(const string& new_name)
 	{
 		name = new_name;
@@ -235,29 +509,47 @@ namespace PhysicsEngine
 	}
 
 	///Scene methods
+	Scene::~Scene()
+	{
+		if (px_scene)
+			px_scene->release();
+		if (cpu_dispatcher)
+			cpu_dispatcher->release();
+	}
+
 	void Scene::Init()
 	{
 		//scene
 		PxSceneDesc sceneDesc(GetPhysics()->getTolerancesScale());
 
-		if(!sceneDesc.cpuDispatcher)
+		if (shared_dispatcher)
+			sceneDesc.cpuDispatcher = shared_dispatcher;
+		else if(!sceneDesc.cpuDispatcher)
 		{
-			PxDefaultCpuDispatcher* mCpuDispatcher = PxDefaultCpuDispatcherCreate(1);
-			sceneDesc.cpuDispatcher = mCpuDispatcher;
+			cpu_dispatcher = PxDefaultCpuDispatcherCreate(num_threads);
+			sceneDesc.cpuDispatcher = cpu_dispatcher;
 		}
 
-		sceneDesc.filterShader = PxDefaultSimulationFilterShader;
+		sceneDesc.filterShader = ContactReportFilterShader;
+		sceneDesc.simulationEventCallback = &event_callback;
+		if (locking)
+			sceneDesc.flags |= PxSceneFlag::eREQUIRE_RW_LOCK;
 
 		px_scene = GetPhysics()->createScene(sceneDesc);
 
 		if (!px_scene)
 			throw new Exception("PhysicsEngine::Scene::Init, Could not initialise the scene.");
 
+		SceneWriteLock lock(*this);
+
 		//default gravity
 		px_scene->setGravity(PxVec3(0.0f, -9.81f, 0.0f));
 
 		CustomInit();
 
+		//the visualization parameters are set by CustomInit
+		Visualization(visualization);
+
 		pause = false;
 
 		selected_actor = 0;
@@ -267,20 +559,105 @@ namespace PhysicsEngine
 
 	void Scene::Update(PxReal dt)
 	{
+		//the commands are applied at a single point, between the steps
+		ApplyCommands();
+
 		if (pause)
 			return;
 
+		SceneWriteLock lock(*this);
+
 		CustomUpdate();
 
+		//contact reports are refilled during fetchResults
+		contacts.Clear();
+
 		px_scene->simulate(dt);
 		px_scene->fetchResults(true);
+
+		if (keep_poses)
+			poses.Update(px_scene);
+
+		step_count++;
+
+		const PxRenderBuffer& debug = px_scene->getRenderBuffer();
+		debug_primitives = debug.getNbPoints() + debug.getNbLines() + debug.getNbTriangles();
+	}
+
+	bool Scene::Submit(Command command)
+	{
+		command.step = step_count;
+		if (commands.Push(command))
+			return true;
+		dropped_commands++;
+		return false;
+	}
+
+	void Scene::ApplyCommands()
+	{
+		Command command;
+		while (commands.Pop(command))
+		{
+			//the scene and its lock are recreated
+			if (command.type == Command::RESET)
+			{
+				Reset();
+				continue;
+			}
+
+			SceneWriteLock lock(*this);
+			switch (command.type)
+			{
+			case Command::FORCE:
+				if (selected_actor)
+					selected_actor->addForce(command.direction);
+				break;
+			case Command::SELECT_NEXT:
+				SelectNextActor();
+				break;
+			case Command::PAUSE:
+				Pause((command.value < 0) ? !pause : (command.value != 0));
+				break;
+			case Command::CUSTOM:
+				CustomCommand(command);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	PxU32 Scene::DroppedCommands()
+	{
+		return dropped_commands;
+	}
+
+	PxU32 Scene::Steps()
+	{
+		return step_count;
 	}
 
 	void Scene::Add(Actor* actor)
 	{
+		SceneWriteLock lock(*this);
 		px_scene->addActor(*actor->Get());
 	}
 
+	void Scene::Add(Actor* const* actors, PxU32 count)
+	{
+		std::vector<PxActor*> px_actors(count);
+		for (PxU32 i = 0; i < count; i++)
+			px_actors[i] = actors[i]->Get();
+
+		Add(px_actors.data(), count);
+	}
+
+	void Scene::Add(PxActor* const* actors, PxU32 count)
+	{
+		SceneWriteLock lock(*this);
+		px_scene->addActors(actors, count);
+	}
+
 	PxScene* Scene::Get() 
 	{ 
 		return px_scene; 
@@ -289,6 +666,15 @@ namespace PhysicsEngine
 	void Scene::Reset()
 	{
 		px_scene->release();
+		if (cpu_dispatcher)
+			cpu_dispatcher->release();
+		cpu_dispatcher = 0;
+		poses.Clear();
+		//the reports and the waiting trigger events point to the released actors
+		contacts.Clear();
+		TriggerEvent event;
+		while (triggers.Pop(event))
+			;
 		Init();
 	}
 
@@ -302,6 +688,102 @@ namespace PhysicsEngine
 		return pause;
 	}
 
+	void Scene::Threads(PxU32 value)
+	{
+		num_threads = value;
+	}
+
+	PxU32 Scene::Threads()
+	{
+		return num_threads;
+	}
+
+	void Scene::Dispatcher(PxCpuDispatcher* dispatcher)
+	{
+		shared_dispatcher = dispatcher;
+	}
+
+	PxCpuDispatcher* Scene::Dispatcher()
+	{
+		return shared_dispatcher;
+	}
+
+	void Scene::Locking(bool value)
+	{
+		locking = value;
+	}
+
+	bool Scene::Locking()
+	{
+		return locking;
+	}
+
+	const ContactBuffer& Scene::GetContacts()
+	{
+		return contacts;
+	}
+
+	void Scene::ContactCapacity(PxU32 value)
+	{
+		contacts.Capacity(value);
+	}
+
+	bool Scene::PollTrigger(TriggerEvent& event)
+	{
+		return triggers.Pop(event);
+	}
+
+	void Scene::Visualization(bool value)
+	{
+		visualization = value;
+		if (!px_scene)
+			return;
+
+		SceneWriteLock lock(*this);
+
+		//a zero scale turns off all parameters, PhysX then skips the visualization pass
+		PxReal scale = px_scene->getVisualizationParameter(PxVisualizationParameter::eSCALE);
+		if (!value && (scale != 0.f))
+		{
+			visualization_scale = scale;
+			px_scene->setVisualizationParameter(PxVisualizationParameter::eSCALE, 0.f);
+		}
+		else if (value && (scale == 0.f))
+			px_scene->setVisualizationParameter(PxVisualizationParameter::eSCALE, visualization_scale);
+	}
+
+	bool Scene::Visualization()
+	{
+		return visualization;
+	}
+
+	void Scene::VisualizationCulling(const PxBounds3& box)
+	{
+		SceneWriteLock lock(*this);
+		px_scene->setVisualizationCullingBox(box);
+	}
+
+	PxU32 Scene::DebugPrimitives()
+	{
+		return debug_primitives;
+	}
+
+	void Scene::KeepPoses(bool value)
+	{
+		keep_poses = value;
+		poses.Clear();
+	}
+
+	bool Scene::KeepPoses()
+	{
+		return keep_poses;
+	}
+
+	const PoseHistory& Scene::Poses()
+	{
+		return poses;
+	}
+
 	PxRigidDynamic* Scene::GetSelectedActor()
 	{
 		return selected_actor;
@@ -309,6 +791,7 @@ namespace PhysicsEngine
 
 	void Scene::SelectNextActor()
 	{
+		SceneWriteLock lock(*this);
 #if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
 		std::vector<PxRigidDynamic*> actors(px_scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC));
 		if (actors.size() && (px_scene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, (PxActor**)&actors.front(), (PxU32)actors.size())))
@@ -338,8 +821,17 @@ namespace PhysicsEngine
 			selected_actor = 0;
 	}
 
+	void Scene::ClearSelection()
+	{
+		SceneWriteLock lock(*this);
+		if (selected_actor)
+			HighlightOff(selected_actor);
+		selected_actor = 0;
+	}
+
 	std::vector<PxActor*> Scene::GetAllActors()
 	{
+		SceneReadLock lock(*this);
 #if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
 		physx::PxActorTypeSelectionFlags selection_flag = PxActorTypeSelectionFlag::eRIGID_DYNAMIC | PxActorTypeSelectionFlag::eRIGID_STATIC |
 			PxActorTypeSelectionFlag::eCLOTH;
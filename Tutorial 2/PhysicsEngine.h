@@ -3,7 +3,9 @@
 #include <vector>
 #include "PxPhysicsAPI.h"
 #include "Exception.h"
-#include "Extras\UserData.h"
+#include "LockFreeQueue.h"
+#include "Extras/UserData.h"
+#include "Extras/PoseHistory.h"
 #include <string>
 
 namespace PhysicsEngine
@@ -29,8 +31,33 @@ namespace PhysicsEngine
 	///Create a new material
 	PxMaterial* CreateMaterial(PxReal sf=.0f, PxReal df=.0f, PxReal cr=.0f);
 
+	///Get a material shared by all scenes, created on the first request for the coefficients (thread safe)
+	///Do not change or release it.
+	PxMaterial* SharedMaterial(PxReal sf, PxReal df, PxReal cr);
+
+	///Get a convex mesh shared by all scenes, cooked on the first request for the points (thread safe)
+	PxConvexMesh* SharedConvexMesh(const std::vector<PxVec3>& verts);
+
+	///Get the number of bytes currently allocated by PhysX
+	size_t GetAllocatedBytes();
+
+	///Get the highest number of bytes allocated by PhysX since the last reset
+	size_t GetPeakAllocatedBytes();
+
+	///Reset the peak allocation counter to the current allocation
+	void ResetPeakAllocatedBytes();
+
+	///Get the total number of allocations made by PhysX
+	size_t GetAllocationCount();
+
 	static const PxVec3 default_color(.8f,.8f,.8f);
 
+	///Filter shader enabling contact reports only for flagged pairs
+	///word0 of the simulation filter data holds the group of a shape, word1 the mask of groups it wants reports for
+	PxFilterFlags ContactReportFilterShader(PxFilterObjectAttributes attributes0, PxFilterData filterData0,
+		PxFilterObjectAttributes attributes1, PxFilterData filterData1,
+		PxPairFlags& pairFlags, const void* constantBlock, PxU32 constantBlockSize);
+
 	///Abstract Actor class
 	///Inherit from this class to create your own actors
 	class Actor
@@ -47,21 +74,33 @@ namespace PhysicsEngine
 		{
 		}
 
+		///Destructor, the actors are deleted through this class (SceneLoader, BinaryScene)
+		virtual ~Actor() {}
+
 		PxActor* Get();
 
 		void Color(PxVec3 new_color, PxU32 shape_index=-1);
 
 		const PxVec3* Color(PxU32 shape_indx=0);
 
-		void Actor::Name(const string& name);
+		void Name(const string& name);
 
-		string Actor::Name();
+		string Name();
 
 		void Material(PxMaterial* new_material, PxU32 shape_index=-1);
 
 		PxShape* GetShape(PxU32 index=0);
 
-		std::vector<PxShape*> Actor::GetShapes(PxU32 index=-1);
+		///Set the filter group of the shapes and the mask of groups that generate contact reports
+		void SetupFiltering(PxU32 filterGroup, PxU32 filterMask, PxU32 shape_index=-1);
+
+		///Turn the shapes into trigger volumes (or back into simulation shapes)
+		void SetTrigger(bool value, PxU32 shape_index=-1);
+
+		///Include the actor and its shapes in the debug visualization (on by default)
+		void Visualization(bool value);
+
+		std::vector<PxShape*> GetShapes(PxU32 index=-1);
 
 		virtual void CreateShape(const PxGeometry& geometry, PxReal density) {}
 	};
@@ -88,24 +127,191 @@ namespace PhysicsEngine
 		void CreateShape(const PxGeometry& geometry, PxReal density=0.f);
 	};
 
+	///Summary of a single contact pair reported during a simulation step
+	struct ContactReport
+	{
+		PxRigidActor* actors[2];
+		PxShape* shapes[2];
+		//PxPairFlag::eNOTIFY_TOUCH_FOUND, eNOTIFY_TOUCH_PERSISTS or eNOTIFY_TOUCH_LOST
+		PxU32 events;
+		PxU32 contact_count;
+		//average contact position and normal (pointing from the second to the first actor)
+		PxVec3 position;
+		PxVec3 normal;
+		//total impulse applied by the contacts
+		PxVec3 impulse;
+	};
+
+	///Fixed capacity buffer of contact reports, filled once per simulation step
+	class ContactBuffer
+	{
+		std::vector<ContactReport> reports;
+		PxU32 count;
+		PxU32 dropped;
+
+	public:
+		ContactBuffer(PxU32 capacity=1024) : reports(capacity), count(0), dropped(0) {}
+
+		///Set the capacity (allocates, do not call during a step)
+		void Capacity(PxU32 value) { reports.resize(value); Clear(); }
+
+		PxU32 Capacity() const { return (PxU32)reports.size(); }
+
+		///Empty the buffer
+		void Clear() { count = 0; dropped = 0; }
+
+		///Get a free report, or 0 (and count it as dropped) if the buffer is full
+		ContactReport* Next()
+		{
+			if (count < reports.size())
+				return &reports[count++];
+			dropped++;
+			return 0;
+		}
+
+		///Number of reports stored
+		PxU32 Count() const { return count; }
+
+		///Number of reports that did not fit into the buffer
+		PxU32 Dropped() const { return dropped; }
+
+		const ContactReport& operator[](PxU32 index) const { return reports[index]; }
+
+		const ContactReport* begin() const { return reports.data(); }
+
+		const ContactReport* end() const { return reports.data() + count; }
+	};
+
+	///A shape entering or leaving a trigger volume
+	struct TriggerEvent
+	{
+		PxRigidActor* trigger_actor;
+		PxShape* trigger_shape;
+		PxRigidActor* other_actor;
+		PxShape* other_shape;
+		//true on enter, false on exit
+		bool enter;
+	};
+
+	typedef LockFreeQueue<TriggerEvent> TriggerQueue;
+
+	///Gameplay command sent to the simulation, e.g. from the input callbacks of the visual debugger
+	struct Command
+	{
+		enum Type
+		{
+			///add direction as a force to the selected actor
+			FORCE,
+			///select the next dynamic actor
+			SELECT_NEXT,
+			///pause (value 1), resume (value 0) or toggle (value -1) the simulation
+			PAUSE,
+			///recreate the scene
+			RESET,
+			///scene specific command, value tells Scene::CustomCommand which one
+			CUSTOM
+		};
+
+		Type type;
+		int value;
+		PxVec3 position;
+		PxVec3 direction;
+		//number of steps simulated before the command was submitted
+		PxU32 step;
+
+		Command(Type _type=CUSTOM, int _value=0, const PxVec3& _position=PxVec3(0.f), const PxVec3& _direction=PxVec3(0.f))
+			: type(_type), value(_value), position(_position), direction(_direction), step(0) {}
+	};
+
+	typedef LockFreeQueue<Command> CommandQueue;
+
+	///Simulation event callback copying the contact reports into a ContactBuffer
+	///and the trigger events into a TriggerQueue
+	class SimulationEventCallback : public PxSimulationEventCallback
+	{
+		ContactBuffer* contacts;
+		TriggerQueue* triggers;
+		PxU32 dropped_triggers;
+
+	public:
+		SimulationEventCallback(ContactBuffer* _contacts, TriggerQueue* _triggers)
+			: contacts(_contacts), triggers(_triggers), dropped_triggers(0) {}
+
+		///Number of trigger events lost because the queue was full
+		PxU32 DroppedTriggers() const { return dropped_triggers; }
+
+		virtual void onContact(const PxContactPairHeader& pairHeader, const PxContactPair* pairs, PxU32 nbPairs);
+
+		virtual void onTrigger(PxTriggerPair* pairs, PxU32 count);
+
+		virtual void onConstraintBreak(PxConstraintInfo* constraints, PxU32 count) {}
+
+		virtual void onWake(PxActor** actors, PxU32 count) {}
+
+		virtual void onSleep(PxActor** actors, PxU32 count) {}
+
+#if PX_PHYSICS_VERSION >= 0x304000
+		virtual void onAdvance(const PxRigidBody* const* bodyBuffer, const PxTransform* poseBuffer, const PxU32 count) {}
+#endif
+	};
+
 	///Generic scene class
 	class Scene
 	{
 	protected:
 		//a PhysX scene object
 		PxScene* px_scene;
+		//worker threads of the scene
+		PxDefaultCpuDispatcher* cpu_dispatcher;
+		//worker threads shared with other scenes instead, not released by the scene
+		PxCpuDispatcher* shared_dispatcher;
 		//pause simulation
 		bool pause;
 		//selected dynamic actor on the scene
 		PxRigidDynamic* selected_actor;
 		//original and modified colour of the selected actor
 		std::vector<PxVec3> sactor_color_orig;
+		//number of worker threads used by the simulation
+		PxU32 num_threads;
+		//contact reports of the last simulation step
+		ContactBuffer contacts;
+		//trigger events waiting to be processed
+		TriggerQueue triggers;
+		SimulationEventCallback event_callback;
+		//generate the debug visualization and its scale while it is off
+		bool visualization;
+		PxReal visualization_scale;
+		//debug primitives generated by the last simulation step
+		PxU32 debug_primitives;
+		//poses of the dynamic actors around the last step, kept for the interpolation of the rendered frames
+		bool keep_poses;
+		PoseHistory poses;
+		//commands of the input thread, applied at the start of Update
+		CommandQueue commands;
+		std::atomic<PxU32> dropped_commands;
+		//number of simulated steps
+		std::atomic<PxU32> step_count;
+		//create the scene with PxSceneFlag::eREQUIRE_RW_LOCK
+		bool locking;
+
+		void ApplyCommands();
 
 		void HighlightOn(PxRigidDynamic* actor);
 
 		void HighlightOff(PxRigidDynamic* actor);
 
 	public:
+		///Constructor
+		Scene()
+			: px_scene(0), cpu_dispatcher(0), shared_dispatcher(0), pause(false), selected_actor(0), num_threads(1), event_callback(&contacts, &triggers),
+			visualization(true), visualization_scale(1.f), debug_primitives(0), keep_poses(false),
+			commands(256), dropped_commands(0), step_count(0), locking(false)
+		{
+		}
+
+		///Destructor, releases the PhysX scene
+		virtual ~Scene();
+
 		///Init the scene
 		void Init();
 
@@ -118,9 +324,28 @@ namespace PhysicsEngine
 		///User defined update step
 		virtual void CustomUpdate() {}
 
+		///Queue a command, it is applied by the simulation thread before the next step (even while paused)
+		///Single producer: call from one thread only. Returns false when the queue is full.
+		bool Submit(Command command);
+
+		///User defined handler of the Command::CUSTOM commands
+		virtual void CustomCommand(const Command& command) {}
+
+		///Number of commands lost because the queue was full
+		PxU32 DroppedCommands();
+
+		///Number of simulated steps
+		PxU32 Steps();
+
 		///Add actors
 		void Add(Actor* actor);
 
+		///Add rigid actors with a single PxScene::addActors, faster than one by one for many actors
+		void Add(Actor* const* actors, PxU32 count);
+
+		///Add PhysX actors with a single PxScene::addActors
+		void Add(PxActor* const* actors, PxU32 count);
+
 		///Get the PxScene object
 		PxScene* Get();
 
@@ -133,16 +358,110 @@ namespace PhysicsEngine
 		///Get pause
 		bool Pause();
 
+		///Set the number of worker threads (applied on Init/Reset)
+		void Threads(PxU32 value);
+
+		///Get the number of worker threads
+		PxU32 Threads();
+
+		///Run the simulation on the worker threads of a shared dispatcher instead of Threads() of its own
+		///(applied on Init/Reset, 0 to create its own again). The dispatcher has to outlive the scene.
+		void Dispatcher(PxCpuDispatcher* dispatcher);
+
+		///Get the shared dispatcher, or 0
+		PxCpuDispatcher* Dispatcher();
+
+		///Require the read and write locks for every access to the PxScene (applied on Init/Reset)
+		///The SDK checks the locks in its debug and checked builds, the scene methods take the locks they need.
+		///Outside of the scene, take a SceneReadLock or a SceneWriteLock before accessing PhysX objects.
+		void Locking(bool value);
+
+		///Get locking
+		bool Locking();
+
+		///Contact reports generated by the last simulation step
+		const ContactBuffer& GetContacts();
+
+		///Set the maximum number of contact reports stored per step
+		void ContactCapacity(PxU32 value);
+
+		///Take the oldest trigger event from the queue, returns false if there are none
+		bool PollTrigger(TriggerEvent& event);
+
+		///Turn the generation of the debug visualization on/off, the parameters set by CustomInit are kept
+		void Visualization(bool value);
+
+		///Get visualization
+		bool Visualization();
+
+		///Generate the debug visualization only inside of the box (e.g. the camera view)
+		void VisualizationCulling(const PxBounds3& box);
+
+		///Number of points, lines and triangles of the debug visualization generated by the last simulation step
+		PxU32 DebugPrimitives();
+
+		///Keep the poses of the dynamic actors before and after every step (off by default)
+		void KeepPoses(bool value);
+
+		///Get keep poses
+		bool KeepPoses();
+
+		///Poses of the dynamic actors before and after the last step (see KeepPoses)
+		const PoseHistory& Poses();
+
 		///Get the selected dynamic actor on the scene
 		PxRigidDynamic* GetSelectedActor();
 
 		///Switch to the next dynamic actor
 		void SelectNextActor();
 
+		///Remove the highlight and deselect the actor
+		void ClearSelection();
+
 		///a list with all actors
 		std::vector<PxActor*> GetAllActors();
 	};
 
+	///Scoped read lock of a Scene, does nothing unless the scene requires locking
+	///Any number of readers (e.g. the renderer and the picking code) can hold it at the same time.
+	class SceneReadLock
+	{
+		PxScene* scene;
+
+	public:
+		SceneReadLock(Scene& _scene, const char* file=0, PxU32 line=0) : scene(_scene.Locking() ? _scene.Get() : 0)
+		{
+			if (scene)
+				scene->lockRead(file, line);
+		}
+
+		~SceneReadLock()
+		{
+			if (scene)
+				scene->unlockRead();
+		}
+	};
+
+	///Scoped write lock of a Scene, does nothing unless the scene requires locking
+	///Excludes all readers and writers of other threads, the thread holding it can also read and write recursively.
+	class SceneWriteLock
+	{
+		PxScene* scene;
+
+	public:
+		SceneWriteLock(Scene& _scene, const char* file=0, PxU32 line=0) : scene(_scene.Locking() ? _scene.Get() : 0)
+		{
+			if (scene)
+				scene->lockWrite(file, line);
+		}
+
+		~SceneWriteLock()
+		{
+			if (scene)
+				scene->unlockWrite();
+		}
+	};
+
 	///Generic Joint class
 	class Joint
 	{
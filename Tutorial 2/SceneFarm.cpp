@@ -0,0 +1,194 @@
+#include "SceneFarm.h"
+#include <chrono>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	SceneFarm::SceneFarm(PxU32 threads)
+		: generation(0), job(Job::STEP), dt(0.f), next_scene(0), busy(0), closing(false), error(0), scene_steps(0), step_seconds(0.)
+	{
+		if (!threads)
+			threads = PxMax(std::thread::hardware_concurrency(), 1u);
+
+		//no threads: the tasks run right away on the thread submitting them
+		dispatcher = PxDefaultCpuDispatcherCreate(0);
+		if (!dispatcher)
+			throw new Exception("SceneFarm::SceneFarm, could not create the dispatcher.");
+
+		for (PxU32 i = 1; i < threads; i++)
+			workers.push_back(std::thread(&SceneFarm::Run, this));
+	}
+
+	SceneFarm::~SceneFarm()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closing = true;
+		}
+		job_started.notify_all();
+		for (unsigned int i = 0; i < workers.size(); i++)
+			workers[i].join();
+
+		dispatcher->release();
+	}
+
+	void SceneFarm::Add(Scene* scene)
+	{
+		scene->Dispatcher(dispatcher);
+		scene->Init();
+		scenes.push_back(scene);
+	}
+
+	void SceneFarm::Add(const std::vector<Scene*>& new_scenes)
+	{
+		pending = new_scenes;
+		InitPending();
+		scenes.insert(scenes.end(), new_scenes.begin(), new_scenes.end());
+	}
+
+	Scene* SceneFarm::Replace(PxU32 index, Scene* scene)
+	{
+		scene->Dispatcher(dispatcher);
+		scene->Init();
+
+		Scene* replaced = scenes[index];
+		scenes[index] = scene;
+		return replaced;
+	}
+
+	std::vector<Scene*> SceneFarm::Replace(const std::vector<PxU32>& indices, const std::vector<Scene*>& new_scenes)
+	{
+		if (indices.size() != new_scenes.size())
+			throw new Exception("SceneFarm::Replace, the number of indices and scenes differ.");
+
+		pending = new_scenes;
+		InitPending();
+
+		std::vector<Scene*> replaced(indices.size());
+		for (unsigned int i = 0; i < indices.size(); i++)
+		{
+			replaced[i] = scenes[indices[i]];
+			scenes[indices[i]] = new_scenes[i];
+		}
+		return replaced;
+	}
+
+	void SceneFarm::Clear()
+	{
+		scenes.clear();
+	}
+
+	void SceneFarm::Step(PxReal _dt, PxU32 count)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		dt = _dt;
+		for (PxU32 i = 0; i < count; i++)
+		{
+			Dispatch(Job::STEP);
+
+			scene_steps += scenes.size();
+
+			if (error)
+			{
+				Exception* exc = error;
+				error = 0;
+				step_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				throw exc;
+			}
+		}
+
+		step_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void SceneFarm::ResetStats()
+	{
+		scene_steps = 0;
+		step_seconds = 0.;
+	}
+
+	void SceneFarm::InitPending()
+	{
+		for (unsigned int i = 0; i < pending.size(); i++)
+			pending[i]->Dispatcher(dispatcher);
+
+		Dispatch(Job::INIT);
+		pending.clear();
+
+		if (error)
+		{
+			Exception* exc = error;
+			error = 0;
+			throw exc;
+		}
+	}
+
+	void SceneFarm::Dispatch(Job::Enum _job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = _job;
+			next_scene = 0;
+			busy = (PxU32)workers.size();
+			generation++;
+		}
+		job_started.notify_all();
+
+		RunJob(_job);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		job_finished.wait(lock, [this] { return busy == 0; });
+	}
+
+	void SceneFarm::Run()
+	{
+		PxU64 done = 0;
+		for (;;)
+		{
+			Job::Enum current;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				job_started.wait(lock, [this, done] { return closing || (generation != done); });
+				if (closing)
+					return;
+				done = generation;
+				current = job;
+			}
+
+			RunJob(current);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--busy == 0)
+					job_finished.notify_all();
+			}
+		}
+	}
+
+	void SceneFarm::RunJob(Job::Enum current)
+	{
+		std::vector<Scene*>& targets = (current == Job::STEP) ? scenes : pending;
+
+		//the scenes are taken one at a time, a worker stuck on a slow scene does not hold up the others
+		for (PxU32 i = next_scene++; i < targets.size(); i = next_scene++)
+		{
+			try
+			{
+				if (current == Job::STEP)
+					targets[i]->Update(dt);
+				else
+					targets[i]->Init();
+			}
+			catch (Exception* exc)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!error)
+					error = exc;
+				else
+					delete exc;
+			}
+		}
+	}
+}
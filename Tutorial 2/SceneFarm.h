@@ -0,0 +1,110 @@
+#pragma once
+
+#include "PhysicsEngine.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace PhysicsEngine
+{
+	///Many independent scenes stepped in parallel, e.g. for batch evaluation
+	///
+	///The scenes share the PhysX SDK, the shared materials and meshes (SharedMaterial, SharedConvexMesh) and
+	///a pool of worker threads. On every step the workers take the scenes one at a time and run Scene::Update,
+	///simulate and fetchResults, on them: a scene is always stepped by a single thread and the scenes run side
+	///by side, so the throughput grows with the cores without any synchronisation inside a step. The scenes
+	///get a PhysX dispatcher without threads of its own, the tasks of a scene run on the worker stepping it.
+	///
+	///The batches of new scenes given to Add and Replace are initialised on the pool as well, one scene per thread at
+	///a time, so loading and cooking a batch does not leave the workers waiting for the calling thread.
+	///
+	///The farm does not own the scenes. Touch them only between the calls to Step. The scenes keep simulating
+	///on the dispatcher of the farm, release all of them (including the replaced ones) before the farm.
+	class SceneFarm
+	{
+		///Work handed to the pool
+		struct Job
+		{
+			enum Enum
+			{
+				//Scene::Update on every scene
+				STEP,
+				//Scene::Init on the pending scenes
+				INIT
+			};
+		};
+
+		std::vector<Scene*> scenes;
+		//scenes being initialised by an INIT job
+		std::vector<Scene*> pending;
+		PxDefaultCpuDispatcher* dispatcher;
+		//the thread calling Step works as well
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable job_started, job_finished;
+		//current job: its number and kind, the time step, the next scene to take and the workers still busy
+		PxU64 generation;
+		Job::Enum job;
+		PxReal dt;
+		std::atomic<PxU32> next_scene;
+		PxU32 busy;
+		bool closing;
+		//first exception thrown by a scene during the job, rethrown by Step, Add or Replace
+		Exception* error;
+		PxU64 scene_steps;
+		double step_seconds;
+
+		void Run();
+		//run a job on the workers and the calling thread, returns when all of them are done
+		void Dispatch(Job::Enum job);
+		void RunJob(Job::Enum job);
+		void InitPending();
+
+	public:
+		///Start the worker pool, threads=0 uses a thread per core
+		SceneFarm(PxU32 threads=0);
+
+		///Stop the workers and release the dispatcher, the scenes must have been released already
+		~SceneFarm();
+
+		///Add a scene, it is initialised on the shared dispatcher
+		void Add(Scene* scene);
+
+		///Add scenes initialised in parallel on the threads of the farm
+		///Throws the first Exception of Scene::Init, none of the scenes is added then.
+		void Add(const std::vector<Scene*>& new_scenes);
+
+		///Put a new scene in the place of another one (e.g. a finished one), initialised like in Add
+		///Returns the replaced scene, which is not stepped anymore but still uses the dispatcher of the farm.
+		Scene* Replace(PxU32 index, Scene* scene);
+
+		///Put new scenes in the place of the ones at indices, initialised in parallel like in Add
+		///Returns the replaced scenes in the order of the indices, or throws like Add (nothing replaced).
+		std::vector<Scene*> Replace(const std::vector<PxU32>& indices, const std::vector<Scene*>& new_scenes);
+
+		///Remove all scenes (without releasing them)
+		void Clear();
+
+		///Step every scene count times by dt, throws the first Exception of a scene after the step
+		void Step(PxReal dt, PxU32 count=1);
+
+		///Number of scenes
+		PxU32 Count() const { return (PxU32)scenes.size(); }
+
+		///Get a scene
+		Scene* Get(PxU32 index) { return scenes[index]; }
+
+		///Number of threads stepping the scenes, including the caller of Step
+		PxU32 Threads() const { return (PxU32)workers.size() + 1; }
+
+		///Number of scene steps since the last ResetStats
+		PxU64 SceneSteps() const { return scene_steps; }
+
+		///Scene steps per second of wall time spent in Step since the last ResetStats
+		double SceneStepsPerSecond() const { return step_seconds > 0. ? scene_steps / step_seconds : 0.; }
+
+		///Reset the throughput counters
+		void ResetStats();
+	};
+}
@@ -0,0 +1,592 @@
+#include "SceneLoader.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	SceneLoader::~SceneLoader()
+	{
+		Clear();
+	}
+
+	void SceneLoader::Load(const std::string& filename)
+	{
+		std::ifstream file(filename.c_str());
+		if (!file)
+			throw new Exception("SceneLoader::Load, could not open " + filename + ".");
+
+		Load(file, filename);
+	}
+
+	void SceneLoader::Load(std::istream& stream, const std::string& _source)
+	{
+		source = _source;
+		size_t separator = source.find_last_of("/\\");
+		directory = (separator == std::string::npos) ? "" : source.substr(0, separator + 1);
+		line = 0;
+		stats = SceneLoadStats();
+		start = split = std::chrono::steady_clock::now();
+
+		while (NextStatement(stream))
+		{
+			const std::string& keyword = tokens[0];
+			if (skipped.count(keyword))
+				continue;
+			if (keyword == "material")
+				ParseMaterial();
+			else if ((keyword == "static") || (keyword == "dynamic"))
+				ParseActor(stream, keyword == "dynamic");
+			else if (keyword == "heightfield")
+				ParseHeightField();
+			else if (keyword == "cloth")
+				ParseCloth();
+			else if (keyword == "joint")
+				ParseJoint();
+			else
+				Fail("unknown statement " + keyword);
+		}
+
+		Flush();
+		stats.total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void SceneLoader::Clear()
+	{
+		SceneWriteLock lock(*scene);
+
+		//the joints go first, they refer to the actors
+		for (unsigned int i = 0; i < joints.size(); i++)
+		{
+			joints[i]->Get()->release();
+			delete joints[i];
+		}
+
+		//the wrappers free the user data of the shapes
+		for (unsigned int i = 0; i < actors.size(); i++)
+		{
+			PxActor* px_actor = actors[i]->Get();
+			delete actors[i];
+			px_actor->release();
+		}
+
+		//the shapes keep their own references
+		for (std::map<std::string, PxMaterial*>::iterator it = materials.begin(); it != materials.end(); ++it)
+			it->second->release();
+
+		joints.clear();
+		actors.clear();
+		batch.clear();
+		named_actors.clear();
+		materials.clear();
+	}
+
+	void SceneLoader::Skip(const std::string& statement)
+	{
+		//the actor blocks span several lines
+		if ((statement != "heightfield") && (statement != "cloth") && (statement != "joint"))
+			throw new Exception("SceneLoader::Skip, " + statement + " statements cannot be skipped.");
+
+		skipped.insert(statement);
+	}
+
+	Actor* SceneLoader::Find(const std::string& name)
+	{
+		std::map<std::string, Actor*>::iterator it = named_actors.find(name);
+		return (it != named_actors.end()) ? it->second : 0;
+	}
+
+	bool SceneLoader::NextStatement(std::istream& stream)
+	{
+		std::string text;
+		while (std::getline(stream, text))
+		{
+			line++;
+			tokens.clear();
+
+			//split on whitespace up to the comment
+			size_t end = text.find('#');
+			if (end == std::string::npos)
+				end = text.size();
+			size_t first = 0;
+			while (first < end)
+			{
+				while ((first < end) && isspace((unsigned char)text[first]))
+					first++;
+				size_t last = first;
+				while ((last < end) && !isspace((unsigned char)text[last]))
+					last++;
+				if (last > first)
+					tokens.push_back(text.substr(first, last - first));
+				first = last;
+			}
+
+			if (tokens.size())
+				return true;
+		}
+		return false;
+	}
+
+	void SceneLoader::Loaded(Actor* actor, bool batched)
+	{
+		if (batched)
+		{
+			batch.push_back(actor);
+			if (batch.size() >= batch_size)
+				Flush();
+		}
+		else
+			scene->Add(actor);
+
+		stats.actors++;
+		if ((stats.actors % 10000) == 0)
+		{
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			stats.split_ms.push_back(std::chrono::duration<double, std::milli>(now - split).count());
+			split = now;
+		}
+	}
+
+	void SceneLoader::Flush()
+	{
+		if (batch.empty())
+			return;
+
+		std::chrono::steady_clock::time_point add_start = std::chrono::steady_clock::now();
+		scene->Add(&batch.front(), (PxU32)batch.size());
+		stats.add_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - add_start).count();
+		stats.batches++;
+		batch.clear();
+	}
+
+	void SceneLoader::Fail(const std::string& message)
+	{
+		std::stringstream text;
+		text << "SceneLoader::Load, " << source << ":" << line << ": " << message << ".";
+		throw new Exception(text.str());
+	}
+
+	const std::string& SceneLoader::Word(PxU32& i)
+	{
+		if (i >= tokens.size())
+			Fail("missing value after " + tokens[i-1]);
+		return tokens[i++];
+	}
+
+	PxReal SceneLoader::Number(PxU32& i)
+	{
+		const std::string& word = Word(i);
+		char* end = 0;
+		PxReal value = (PxReal)strtod(word.c_str(), &end);
+		if (*end || (end == word.c_str()))
+			Fail("expected a number instead of " + word);
+		return value;
+	}
+
+	PxVec3 SceneLoader::Vector(PxU32& i)
+	{
+		PxReal x = Number(i);
+		PxReal y = Number(i);
+		PxReal z = Number(i);
+		return PxVec3(x, y, z);
+	}
+
+	bool SceneLoader::Pose(PxU32& i, PxTransform& pose)
+	{
+		if (tokens[i] == "at")
+		{
+			i++;
+			pose.p = Vector(i);
+			return true;
+		}
+		if (tokens[i] == "rot")
+		{
+			i++;
+			PxReal angle = Number(i);
+			PxVec3 axis = Vector(i);
+			if (axis.isZero())
+				Fail("rotation without an axis");
+			pose.q = PxQuat(angle * PxPi / 180.f, axis.getNormalized());
+			return true;
+		}
+		return false;
+	}
+
+	PxMaterial* SceneLoader::FindMaterial(const std::string& name)
+	{
+		if (name == "default")
+			return GetMaterial();
+
+		std::map<std::string, PxMaterial*>::iterator it = materials.find(name);
+		if (it == materials.end())
+			Fail("unknown material " + name);
+		return it->second;
+	}
+
+	Actor* SceneLoader::FindActor(const std::string& name)
+	{
+		Actor* actor = Find(name);
+		if (!actor)
+			Fail("unknown actor " + name);
+		return actor;
+	}
+
+	void SceneLoader::ParseMaterial()
+	{
+		PxU32 i = 1;
+		std::string name = Word(i);
+		PxReal static_friction = Number(i);
+		PxReal dynamic_friction = Number(i);
+		PxReal restitution = Number(i);
+		if (i < tokens.size())
+			Fail("unexpected " + tokens[i]);
+		if ((name == "default") || materials.count(name))
+			Fail("material " + name + " is already defined");
+
+		materials[name] = CreateMaterial(static_friction, dynamic_friction, restitution);
+		stats.materials++;
+	}
+
+	void SceneLoader::ParseActor(std::istream& stream, bool dynamic)
+	{
+		PxTransform pose(PxIdentity);
+		PxReal density = 1.f, mass = 0.f;
+		bool kinematic = false, gravity = true, trigger = false, visual = true, filter = false;
+		PxU32 group = 0, mask = 0;
+		PxMaterial* material = 0;
+		PxVec3 color = default_color;
+		std::string name;
+
+		for (PxU32 i = 1; i < tokens.size();)
+		{
+			if (Pose(i, pose))
+				continue;
+
+			const std::string& key = tokens[i++];
+			if (key == "name")
+				name = Word(i);
+			else if (dynamic && (key == "density"))
+				density = Number(i);
+			else if (dynamic && (key == "mass"))
+				mass = Number(i);
+			else if (dynamic && (key == "kinematic"))
+				kinematic = true;
+			else if (dynamic && (key == "nogravity"))
+				gravity = false;
+			else if (key == "trigger")
+				trigger = true;
+			else if (key == "novisual")
+				visual = false;
+			else if (key == "filter")
+			{
+				filter = true;
+				group = (PxU32)Number(i);
+				mask = (PxU32)Number(i);
+			}
+			else if (key == "material")
+				material = FindMaterial(Word(i));
+			else if (key == "color")
+				color = Vector(i) / 255.f;
+			else
+				Fail("unknown option " + key);
+		}
+
+		if (!(density > 0.f) || (mass < 0.f))
+			Fail("the density has to be positive and the mass not negative");
+		if (name.size() && named_actors.count(name))
+			Fail("actor " + name + " is already defined");
+
+		//kept right away, so an error in the shapes does not leak the actor
+		Actor* actor = dynamic ? (Actor*)new DynamicActor(pose) : (Actor*)new StaticActor(pose);
+		actors.push_back(actor);
+
+		bool closed = false;
+		while (NextStatement(stream))
+		{
+			if (tokens[0] == "end")
+			{
+				if (tokens.size() > 1)
+					Fail("unexpected " + tokens[1]);
+				closed = true;
+				break;
+			}
+			ParseShape(actor, dynamic, density, material, color);
+			stats.shapes++;
+		}
+		if (!closed)
+			Fail("missing end of the actor");
+
+		PxRigidActor* rigid_actor = (PxRigidActor*)actor->Get();
+		if (!rigid_actor->getNbShapes())
+			Fail("actor without shapes");
+
+		if (dynamic)
+		{
+			//the shapes have been moved to their local poses since they were created
+			PxRigidDynamic* body = (PxRigidDynamic*)rigid_actor;
+			PxRigidBodyExt::updateMassAndInertia(*body, density);
+			if (mass > 0.f)
+				PxRigidBodyExt::setMassAndUpdateInertia(*body, mass);
+			if (kinematic)
+				((DynamicActor*)actor)->SetKinematic(true);
+			if (!gravity)
+				body->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, true);
+		}
+
+		if (trigger)
+			actor->SetTrigger(true);
+		if (filter)
+			actor->SetupFiltering(group, mask);
+		if (!visual)
+			actor->Visualization(false);
+		if (name.size())
+		{
+			actor->Name(name);
+			named_actors[name] = actor;
+		}
+
+		Loaded(actor);
+	}
+
+	void SceneLoader::ParseShape(Actor* actor, bool dynamic, PxReal density, PxMaterial* material, const PxVec3& color)
+	{
+		const std::string& type = tokens[0];
+		PxU32 i = 1;
+		PxBoxGeometry box;
+		PxSphereGeometry sphere;
+		PxCapsuleGeometry capsule;
+		PxPlaneGeometry plane;
+		PxConvexMeshGeometry convex;
+		const PxGeometry* geometry = 0;
+
+		if (type == "box")
+		{
+			box = PxBoxGeometry(Vector(i));
+			geometry = &box;
+		}
+		else if (type == "sphere")
+		{
+			sphere = PxSphereGeometry(Number(i));
+			geometry = &sphere;
+		}
+		else if (type == "capsule")
+		{
+			PxReal radius = Number(i);
+			capsule = PxCapsuleGeometry(radius, Number(i));
+			geometry = &capsule;
+		}
+		else if (type == "plane")
+		{
+			if (dynamic)
+				Fail("planes need a static actor");
+			geometry = &plane;
+		}
+		else if (type == "convex")
+		{
+			PxU32 count = (PxU32)Number(i);
+			if (count < 4)
+				Fail("convex shapes need at least 4 points");
+			std::vector<PxVec3> points(count);
+			for (PxU32 j = 0; j < count; j++)
+				points[j] = Vector(i);
+
+			//cooked once for all the loads of the file (see SharedConvexMesh)
+			try
+			{
+				convex = PxConvexMeshGeometry(SharedConvexMesh(points));
+			}
+			catch (Exception* exc)
+			{
+				delete exc;
+				Fail("convex cooking failed");
+			}
+			geometry = &convex;
+		}
+		else
+			Fail("unknown shape " + type);
+
+		PxTransform pose(PxIdentity);
+		PxMaterial* shape_material = material;
+		PxVec3 shape_color = color;
+		while (i < tokens.size())
+		{
+			if (Pose(i, pose))
+				continue;
+
+			const std::string& key = tokens[i++];
+			if (key == "material")
+				shape_material = FindMaterial(Word(i));
+			else if (key == "color")
+				shape_color = Vector(i) / 255.f;
+			else
+				Fail("unknown option " + key);
+		}
+
+		actor->CreateShape(*geometry, density);
+
+		PxU32 index = ((PxRigidActor*)actor->Get())->getNbShapes() - 1;
+		actor->GetShape(index)->setLocalPose(pose);
+		if (shape_material)
+			actor->Material(shape_material, index);
+		actor->Color(shape_color, index);
+	}
+
+	void SceneLoader::ParseHeightField()
+	{
+		PxU32 i = 1;
+		std::string image = Word(i);
+		PxVec3 size = Vector(i);
+		PxTransform pose(PxIdentity);
+		PxMaterial* material = 0;
+		PxVec3 color = default_color;
+		std::string name;
+
+		while (i < tokens.size())
+		{
+			if (Pose(i, pose))
+				continue;
+
+			const std::string& key = tokens[i++];
+			if (key == "name")
+				name = Word(i);
+			else if (key == "material")
+				material = FindMaterial(Word(i));
+			else if (key == "color")
+				color = Vector(i) / 255.f;
+			else
+				Fail("unknown option " + key);
+		}
+
+		if (name.size() && named_actors.count(name))
+			Fail("actor " + name + " is already defined");
+
+		//relative to the scene file
+		bool absolute = image.size() && ((image[0] == '/') || (image[0] == '\\') || ((image.size() > 1) && (image[1] == ':')));
+		HeightField* height_field = new HeightField(absolute ? image : directory + image, size, pose);
+		actors.push_back(height_field);
+		if (material)
+			height_field->Material(material);
+		height_field->Color(color);
+		if (name.size())
+		{
+			height_field->Name(name);
+			named_actors[name] = height_field;
+		}
+
+		stats.shapes++;
+		Loaded(height_field);
+	}
+
+	void SceneLoader::ParseCloth()
+	{
+		PxU32 i = 1;
+		PxReal width = Number(i);
+		PxReal height = Number(i);
+		PxU32 columns = (PxU32)Number(i);
+		PxU32 rows = (PxU32)Number(i);
+		PxTransform pose(PxIdentity);
+		PxVec3 color = default_color;
+		std::string name;
+
+		while (i < tokens.size())
+		{
+			if (Pose(i, pose))
+				continue;
+
+			const std::string& key = tokens[i++];
+			if (key == "name")
+				name = Word(i);
+			else if (key == "color")
+				color = Vector(i) / 255.f;
+			else
+				Fail("unknown option " + key);
+		}
+
+		if (!columns || !rows)
+			Fail("cloth needs at least one column and row");
+		if (name.size() && named_actors.count(name))
+			Fail("actor " + name + " is already defined");
+
+		Cloth* cloth = new Cloth(pose, PxVec2(width, height), columns, rows);
+		actors.push_back(cloth);
+		cloth->Color(color);
+		if (name.size())
+		{
+			cloth->Name(name);
+			named_actors[name] = cloth;
+		}
+
+		//cloth is not a rigid actor, it is added on its own
+		Loaded(cloth, false);
+	}
+
+	void SceneLoader::ParseJoint()
+	{
+		PxU32 i = 1;
+		std::string type = Word(i);
+		if ((type != "revolute") && (type != "distance"))
+			Fail("unknown joint " + type);
+
+		std::string name0 = Word(i);
+		Actor* actor0 = (name0 == "world") ? 0 : FindActor(name0);
+		PxTransform frame0(PxIdentity), frame1(PxIdentity);
+		while ((i < tokens.size()) && Pose(i, frame0)) {}
+		Actor* actor1 = FindActor(Word(i));
+		while ((i < tokens.size()) && Pose(i, frame1)) {}
+
+		bool drive = false, limits = false, stiffness = false, damping = false;
+		PxReal drive_velocity = 0.f, lower = 0.f, upper = 0.f, stiffness_value = 0.f, damping_value = 0.f;
+		bool revolute = (type == "revolute");
+		while (i < tokens.size())
+		{
+			const std::string& key = tokens[i++];
+			if (revolute && (key == "drive"))
+			{
+				drive = true;
+				drive_velocity = Number(i);
+			}
+			else if (revolute && (key == "limits"))
+			{
+				limits = true;
+				lower = Number(i) * PxPi / 180.f;
+				upper = Number(i) * PxPi / 180.f;
+			}
+			else if (!revolute && (key == "stiffness"))
+			{
+				stiffness = true;
+				stiffness_value = Number(i);
+			}
+			else if (!revolute && (key == "damping"))
+			{
+				damping = true;
+				damping_value = Number(i);
+			}
+			else
+				Fail("unknown option " + key);
+		}
+
+		if (revolute)
+		{
+			RevoluteJoint* joint = new RevoluteJoint(actor0, frame0, actor1, frame1);
+			joints.push_back(joint);
+			if (limits)
+				joint->SetLimits(lower, upper);
+			if (drive)
+				joint->DriveVelocity(drive_velocity);
+		}
+		else
+		{
+			DistanceJoint* joint = new DistanceJoint(actor0, frame0, actor1, frame1);
+			joints.push_back(joint);
+			if (stiffness)
+				joint->Stiffness(stiffness_value);
+			if (damping)
+				joint->Damping(damping_value);
+		}
+
+		stats.joints++;
+	}
+}
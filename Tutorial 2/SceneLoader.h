@@ -0,0 +1,114 @@
+#pragma once
+
+#include "BasicActors.h"
+#include <istream>
+#include <map>
+#include <set>
+#include <chrono>
+
+namespace PhysicsEngine
+{
+	///Timings and counts of the last SceneLoader::Load
+	struct SceneLoadStats
+	{
+		PxU32 actors, shapes, joints, materials, batches;
+		//whole load, and the part spent in PxScene::addActors
+		double total_ms, add_ms;
+		//time taken by every complete block of 10k actors
+		std::vector<double> split_ms;
+
+		SceneLoadStats() : actors(0), shapes(0), joints(0), materials(0), batches(0), total_ms(0.), add_ms(0.) {}
+
+		///Average load time per 10k actors
+		double PerTenThousand() const { return actors ? total_ms * 10000. / actors : 0.; }
+	};
+
+	///Streaming loader of text scene files
+	///
+	///The file is read line by line, every line is a statement and # starts a comment. Angles are in degrees
+	///and colors in 0-255. A pose is "at x y z", "rot degrees ax ay az" or both, the options come in any order.
+	///
+	///  material <name> <static friction> <dynamic friction> <restitution>
+	///  static|dynamic [name n] [pose] [density d] [mass m] [kinematic] [nogravity] [trigger] [novisual]
+	///                 [filter group mask] [material m] [color r g b]
+	///    box <hx> <hy> <hz> [pose] [material m] [color r g b]
+	///    sphere <radius> ...
+	///    capsule <radius> <half height> ...
+	///    plane ...                          (static actors, normal along x: "rot 90 0 0 1" for the ground)
+	///    convex <n> <x y z>*n ...           (at least 4 points, shared by all loads, see SharedConvexMesh)
+	///  end
+	///  heightfield <image> <sx> <sy> <sz> [name n] [pose] [material m] [color r g b]
+	///  cloth <w> <h> <columns> <rows> [name n] [pose] [color r g b]
+	///  joint revolute|distance <actor|world> [pose] <actor> [pose] [drive v] [limits lower upper]
+	///                                                        [stiffness s] [damping d]
+	///
+	///The material and color of the actor line are the defaults of its shapes, joints refer to the
+	///actors by name and images to files next to the scene file. The actors are created while parsing
+	///and added to the scene in batches with a single PxScene::addActors per batch.
+	class SceneLoader
+	{
+		Scene* scene;
+		PxU32 batch_size;
+		//actors waiting for the next batch
+		std::vector<Actor*> batch;
+		//loaded actors and joints, kept for the renderer (the actors hold the shape colors)
+		std::vector<Actor*> actors;
+		std::vector<Joint*> joints;
+		std::map<std::string, Actor*> named_actors;
+		std::map<std::string, PxMaterial*> materials;
+		//single line statements left out of the loads
+		std::set<std::string> skipped;
+		SceneLoadStats stats;
+
+		//statement of the current line
+		std::vector<std::string> tokens;
+		std::string source, directory;
+		PxU32 line;
+		std::chrono::steady_clock::time_point start, split;
+
+		bool NextStatement(std::istream& stream);
+		void Loaded(Actor* actor, bool batched=true);
+		void Flush();
+		void Fail(const std::string& message);
+		const std::string& Word(PxU32& i);
+		PxReal Number(PxU32& i);
+		PxVec3 Vector(PxU32& i);
+		bool Pose(PxU32& i, PxTransform& pose);
+		PxMaterial* FindMaterial(const std::string& name);
+		Actor* FindActor(const std::string& name);
+		void ParseMaterial();
+		void ParseActor(std::istream& stream, bool dynamic);
+		void ParseShape(Actor* actor, bool dynamic, PxReal density, PxMaterial* material, const PxVec3& color);
+		void ParseHeightField();
+		void ParseCloth();
+		void ParseJoint();
+
+	public:
+		///Actors are added to the scene batch_size at a time
+		SceneLoader(Scene* _scene, PxU32 _batch_size=1024) : scene(_scene), batch_size(PxMax(_batch_size, 1u)), line(0) {}
+
+		///Releases the loaded actors and joints
+		~SceneLoader();
+
+		///Load a scene file, throws an Exception naming the line of the first error
+		void Load(const std::string& filename);
+
+		///Load a scene from a stream, source names the stream in the error messages
+		void Load(std::istream& stream, const std::string& source);
+
+		///Release the loaded actors and joints (e.g. before the scene is recreated)
+		void Clear();
+
+		///Leave out the heightfield, cloth or joint statements of the following loads (e.g. decoration of a headless run)
+		void Skip(const std::string& statement);
+
+		///Get a named actor, or 0
+		Actor* Find(const std::string& name);
+
+		///Number of loaded actors
+		PxU32 Count() const { return (PxU32)actors.size(); }
+
+		///Statistics of the last load
+		const SceneLoadStats& Stats() const { return stats; }
+	};
+}
@@ -1,18 +1,83 @@
 #include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
 #include "VisualDebugger.h"
 
 using namespace std;
 
-int main()
+int main(int argc, char** argv)
 {
-	try 
-	{ 
-		VisualDebugger::Init("Tutorial 2", 800, 800); 
+	//offscreen recording: --offscreen 1280x720 [--frames 600] [--stride 1] [--output frame_] [--raw]
+	//simulation steps per second: --rate 30
+	//layout from a scene file: --scene Scenes/pitch.scene
+	//convert the layout (built-in or --scene) into a binary scene file and exit: --convert pitch.pxscene
+	int width = 0, height = 0;
+	float rate = 60.f;
+	physx::PxU32 frames = 600, stride = 1;
+	string output = "frame_";
+	string layout_file, convert_file;
+	bool raw = false;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		bool has_value = (i + 1 < argc);
+		if ((arg == "--offscreen") && has_value)
+		{
+			const char* size = argv[++i];
+			const char* separator = strchr(size, 'x');
+			width = atoi(size);
+			height = separator ? atoi(separator + 1) : 0;
+		}
+		else if ((arg == "--frames") && has_value)
+			frames = (physx::PxU32)atoi(argv[++i]);
+		else if ((arg == "--stride") && has_value)
+			stride = (physx::PxU32)atoi(argv[++i]);
+		else if ((arg == "--output") && has_value)
+			output = argv[++i];
+		else if (arg == "--raw")
+			raw = true;
+		else if ((arg == "--rate") && has_value)
+			rate = (float)atof(argv[++i]);
+		else if ((arg == "--scene") && has_value)
+			layout_file = argv[++i];
+		else if ((arg == "--convert") && has_value)
+			convert_file = argv[++i];
 	}
-	catch (Exception exc) 
-	{ 
-		cerr << exc.what() << endl;
-		return 0; 
+
+	try
+	{
+		if (convert_file.size())
+		{
+			PhysicsEngine::PxInit();
+			PhysicsEngine::MyScene* scene = new PhysicsEngine::MyScene();
+			scene->LayoutFile(layout_file);
+			scene->Init();
+			//the selected actor is highlighted
+			scene->ClearSelection();
+			size_t size = PhysicsEngine::BinaryScene::Write(*scene, convert_file);
+			cerr << "Wrote " << convert_file << " (" << size << " bytes)" << endl;
+			delete scene;
+			PhysicsEngine::PxRelease();
+			return 0;
+		}
+
+		VisualDebugger::LayoutFile(layout_file);
+		VisualDebugger::SimulationRate(rate);
+
+		if ((width > 0) && (height > 0))
+		{
+			VisualDebugger::InitOffscreen(width, height);
+			VisualDebugger::Record(frames, stride, output, raw);
+			return 0;
+		}
+
+		VisualDebugger::Init("Tutorial 2", 800, 800);
+	}
+	catch (Exception* exc)
+	{
+		cerr << exc->what() << endl;
+		return 1;
 	}
 
 	VisualDebugger::Start();
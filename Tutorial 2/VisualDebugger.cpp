@@ -1,8 +1,13 @@
 #include "VisualDebugger.h"
 #include <vector>
-#include "Extras\Camera.h"
-#include "Extras\Renderer.h"
-#include "Extras\HUD.h"
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <chrono>
+#include "Extras/Camera.h"
+#include "Extras/Renderer.h"
+#include "Extras/HUD.h"
+#include "Extras/FrameWriter.h"
 
 namespace VisualDebugger
 {
@@ -19,12 +24,16 @@ namespace VisualDebugger
 	{
 		EMPTY = 0,
 		HELP = 1,
-		PAUSE = 2
+		PAUSE = 2,
+		PERF = 3
 	};
 
 	//function declarations
 	void KeyHold();
+	void KeyHoldStep();
+#ifndef RENDERER_EGL
 	void KeySpecial(int key, int x, int y);
+#endif
 	void KeyRelease(unsigned char key, int x, int y);
 	void KeyPress(unsigned char key, int x, int y);
 
@@ -33,31 +42,79 @@ namespace VisualDebugger
 	void exitCallback(void);
 
 	void RenderScene();
+	void RenderFrame();
 	void ToggleRenderMode();
+	void ToggleShadows();
+	void ToggleCapture();
 	void HUDInit();
+	void PerfUpdate();
+	void PerfRender();
 
 	///simulation objects
 	Camera* camera;
 	PhysicsEngine::MyScene* scene;
 	PxReal delta_time = 1.f / 60.f;
+	//scene file of the layout, the built-in layout when empty
+	std::string layout_file;
+	//simulated time behind the real time, the frames are drawn between the poses of the last two steps
+	PxReal step_accumulator = 0.f;
+	//steps taken at most per frame, a slower simulation falls behind the real time instead of stalling the frames
+	const PxU32 MAX_STEPS_PER_FRAME = 4;
+	//real time of the last frame (s), moves the camera independently of the simulation rate
+	PxReal frame_time = 1.f / 60.f;
 	PxReal gForceStrength = 20;
 	RenderMode render_mode = NORMAL;
+	//debug visualization is generated only this far from the camera
+	PxReal visualization_distance = 100.f;
 	const int MAX_KEYS = 256;
 	bool key_state[MAX_KEYS];
-	bool hud_show = true;
+	//screen chosen with F5, the help screen is replaced by the pause screen while paused
+	HUDState hud_screen = HELP;
+	const PxReal hud_font_size = 0.018f;
 	HUD hud;
-
-	//Init the debugger
-	void Init(const char* window_name, int width, int height)
+	//statistics of the rendered frames in the bottom line, shown with every screen but the empty one
+	HUDScreen stats_screen(EMPTY, PxVec3(0.f, 0.f, 0.f), hud_font_size, hud_font_size);
+	//history of the frame, simulation step, render and GPU times (ms) and of the PhysX heap (MB)
+	HUDGraph perf_frame, perf_step, perf_render, perf_gpu, perf_heap;
+	//the performance and statistics text is rebuilt a few times per second only, the graphs are scaled at the same time
+	const PxReal perf_update_interval = .25f;
+	PxReal perf_scale[4] = { 1.f, 1.f, 1.f, 1.f };
+	PxU32 perf_frames = 0;
+	std::chrono::steady_clock::time_point perf_last_frame, perf_last_update;
+	//line of the first graph label on the performance screen, every graph takes four lines
+	const PxU32 PERF_GRAPH_LINE = 9;
+	//frames of the interactive session written while capturing
+	Renderer::FrameWriter* capture = 0;
+	int capture_session = 0;
+
+	//Init PhysX, the scene and the renderer settings shared by the window and the offscreen mode
+	void InitScene()
 	{
 		///Init PhysX
 		PhysicsEngine::PxInit();
 		scene = new PhysicsEngine::MyScene();
+		scene->LayoutFile(layout_file);
+		scene->Visualization(render_mode != NORMAL);
+#ifdef _DEBUG
+		//catch the accesses without a lock
+		scene->Locking(true);
+#endif
 		scene->Init();
 
 		///Init renderer
 		Renderer::BackgroundColor(PxVec3(150.f / 255.f, 150.f / 255.f, 150.f / 255.f));
 		Renderer::SetRenderDetail(40);
+	}
+
+	//Init the debugger
+	void Init(const char* window_name, int width, int height)
+	{
+#ifdef RENDERER_EGL
+		throw new Exception("VisualDebugger::Init, the window needs GLUT, this build (RENDERER_EGL) renders offscreen only.");
+#else
+		InitScene();
+		//the window draws at its own rate, between the simulation steps
+		scene->KeepPoses(true);
 		Renderer::InitWindow(window_name, width, height);
 		Renderer::Init();
 
@@ -84,6 +141,7 @@ namespace VisualDebugger
 
 		//init motion callback
 		motionCallback(0, 0);
+#endif
 	}
 
 	void HUDInit()
@@ -102,14 +160,15 @@ namespace VisualDebugger
 		hud.AddLine(HELP, "    F12 - reset");
 		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, " Display");
-		hud.AddLine(HELP, "    F5 - help on/off");
-		hud.AddLine(HELP, "    F6 - shadows on/off");
+		hud.AddLine(HELP, "    F5 - help/performance/off");
+		hud.AddLine(HELP, "    F6 - shadows (map/blob/projected/off)");
 		hud.AddLine(HELP, "    F7 - render mode");
 		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, " Camera");
 		hud.AddLine(HELP, "    W,S,A,D,Q,Z - forward,backward,left,right,up,down");
 		hud.AddLine(HELP, "    mouse + click - change orientation");
 		hud.AddLine(HELP, "    F8 - reset view");
+		hud.AddLine(HELP, "    F11 - capture frames on/off");
 		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, " Force (applied to the selected actor)");
 		hud.AddLine(HELP, "    I,K,J,L,U,M - forward,backward,left,right,up,down");
@@ -118,58 +177,278 @@ namespace VisualDebugger
 		hud.AddLine(PAUSE, "");
 		hud.AddLine(PAUSE, "");
 		hud.AddLine(PAUSE, "   Simulation paused. Press F10 to continue.");
+		//the performance screen is filled by PerfUpdate
+		hud.AddLine(PERF, "");
 		//set font size for all screens
-		hud.FontSize(0.018f);
+		hud.FontSize(hud_font_size);
 		//set font color for all screens
 		hud.Color(PxVec3(0.f, 0.f, 0.f));
 	}
 
+	//Init the debugger without a window
+	void InitOffscreen(int width, int height)
+	{
+		InitScene();
+		if (!Renderer::InitOffscreen(width, height))
+			throw new Exception("VisualDebugger::InitOffscreen, could not create the offscreen surface (build with RENDERER_EGL).");
+		Renderer::Init();
+
+		camera = new Camera(PxVec3(0.0f, 5.0f, 15.0f), PxVec3(0.f, -.1f, -1.f), 5.f);
+
+		//the recorded frames show the scene only
+		HUDInit();
+		hud_screen = EMPTY;
+
+		atexit(exitCallback);
+	}
+
+	//Set the number of simulation steps per second (60 by default)
+	void SimulationRate(PxReal steps_per_second)
+	{
+		delta_time = 1.f / PxMax(steps_per_second, 1.f);
+	}
+
+	//Set the scene file of the layout (the built-in layout when empty)
+	void LayoutFile(const std::string& filename)
+	{
+		layout_file = filename;
+	}
+
 	//Start the main loop
 	void Start()
 	{
+#ifndef RENDERER_EGL
 		glutMainLoop();
+#endif
 	}
 
-	//Render the scene and perform a single simulation step
+	//Simulate and write the frames without a window
+	void Record(PxU32 frames, PxU32 stride, const std::string& path, bool raw)
+	{
+		Renderer::FrameWriter writer(path, raw ? Renderer::FRAMES_RAW : Renderer::FRAMES_PPM);
+		stride = PxMax(stride, 1u);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (PxU32 i = 0; i < frames; i++)
+		{
+			//the steps between the recorded frames are simulated only
+			for (PxU32 j = 1; j < stride; j++)
+				scene->Update(delta_time);
+
+			RenderFrame();
+			writer.Capture();
+			scene->Update(delta_time);
+		}
+		double render_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		writer.Close();
+		double total_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (writer.Failed())
+			throw new Exception("VisualDebugger::Record, could not write the frames to " + path + ".");
+
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		std::cout << "recorded " << writer.Written() << " frames (" << viewport[2] << "x" << viewport[3] << ", stride " << stride << ")"
+			<< ": " << frames / render_time << " fps rendered, " << frames / total_time << " fps written" << std::endl;
+	}
+
+	//Perform the simulation steps due since the last frame and render the scene
 	void RenderScene()
 	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (perf_last_frame.time_since_epoch().count())
+		{
+			frame_time = std::chrono::duration<PxReal>(start - perf_last_frame).count();
+			perf_frame.Add(frame_time * 1000.f);
+			perf_frames++;
+		}
+		perf_last_frame = start;
+		//a long stall (e.g. a moved window) is not caught up with
+		frame_time = PxMin(frame_time, .25f);
+
 		//handle pressed keys
 		KeyHold();
 
-		//start rendering
-		Renderer::Start(camera->getEye(), camera->getDir());
+		//fixed simulation steps, as many as the real time has advanced
+		step_accumulator += frame_time;
+		PxU32 steps = 0;
+		while ((step_accumulator >= delta_time) && (steps < MAX_STEPS_PER_FRAME))
+		{
+			KeyHoldStep();
+			scene->Update(delta_time);
+			step_accumulator -= delta_time;
+			steps++;
+		}
+		if (steps == MAX_STEPS_PER_FRAME)
+			step_accumulator = PxMin(step_accumulator, delta_time);
+		perf_step.Add(std::chrono::duration<PxReal, std::milli>(std::chrono::steady_clock::now() - start).count());
 
-		if ((render_mode == DEBUG) || (render_mode == BOTH))
+		//the frame shows the fraction of the next step elapsed so far, blended from the last two poses
+		if (scene->Pause())
 		{
-			Renderer::Render(scene->Get()->getRenderBuffer());
+			step_accumulator = 0.f;
+			Renderer::InterpolatePoses(0, 1.f);
 		}
+		else
+			Renderer::InterpolatePoses(&scene->Poses(), step_accumulator / delta_time);
+
+		RenderFrame();
+	}
+
+	//Render the scene without simulating it
+	void RenderFrame()
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		//start rendering
+		Renderer::GpuTiming(hud_screen == PERF);
+		Renderer::Start(camera->getEye(), camera->getDir());
 
-		if ((render_mode == NORMAL) || (render_mode == BOTH))
 		{
-			std::vector<PxActor*> actors = scene->GetAllActors();
-			if (actors.size())
-				Renderer::Render(&actors[0], (PxU32)actors.size());
+			//the renderer only reads the scene
+			PhysicsEngine::SceneReadLock lock(*scene);
+
+			if ((render_mode == DEBUG) || (render_mode == BOTH))
+			{
+				Renderer::Render(scene->Get()->getRenderBuffer());
+			}
+
+			if ((render_mode == NORMAL) || (render_mode == BOTH))
+			{
+				std::vector<PxActor*> actors = scene->GetAllActors();
+				if (actors.size())
+					Renderer::Render(&actors[0], (PxU32)actors.size());
+			}
 		}
 
 		//adjust the HUD state
-		if (hud_show)
+		if ((hud_screen == HELP) && scene->Pause())
+			hud.ActiveScreen(PAUSE);
+		else
+			hud.ActiveScreen(hud_screen);
+
+		if ((hud_screen != EMPTY) && (std::chrono::duration<PxReal>(start - perf_last_update).count() >= perf_update_interval))
 		{
-			if (scene->Pause())
-				hud.ActiveScreen(PAUSE);
-			else
-				hud.ActiveScreen(HELP);
+			PerfUpdate();
+			perf_last_update = start;
 		}
-		else
-			hud.ActiveScreen(EMPTY);
 
 		//render HUD
 		hud.Render();
+		if (hud_screen == PERF)
+			PerfRender();
+
+		//render statistics of the frame
+		if ((hud_screen != EMPTY) && Renderer::BeginText())
+		{
+			stats_screen.Render();
+			Renderer::EndText();
+		}
+
+		perf_render.Add(std::chrono::duration<PxReal, std::milli>(std::chrono::steady_clock::now() - start).count());
+		perf_gpu.Add(PxMax(Renderer::GpuFrameTime(), 0.f));
+		perf_heap.Add(PhysicsEngine::GetAllocatedBytes() / (1024.f*1024.f));
+
+		//read the back buffer before it is swapped
+		if (capture)
+			capture->Capture();
 
 		//finish rendering
 		Renderer::Finish();
 
-		//perform a single simulation step
-		scene->Update(delta_time);
+		//the debug visualization of the next step covers the current view only
+		if (render_mode != NORMAL)
+			scene->VisualizationCulling(Renderer::ViewBounds(visualization_distance));
+	}
+
+	//Rebuild the text of the performance screen and of the frame statistics, the times are averaged over the frames since the last update
+	void PerfUpdate()
+	{
+		const Renderer::RenderStats& render_stats = Renderer::GetRenderStats();
+		std::stringstream stats_line;
+		stats_line << " shapes drawn: " << render_stats.drawn_shapes << "  culled: " << render_stats.culled_shapes;
+		stats_line << "  lod:";
+		for (PxU32 i = 0; i < Renderer::LOD_TIERS; i++)
+			stats_line << " " << render_stats.lod_shapes[i];
+		if (render_stats.lod_scale > 1.f)
+			stats_line << " (x" << render_stats.lod_scale << ")";
+		if (render_mode != NORMAL)
+			stats_line << "  debug primitives: " << scene->DebugPrimitives();
+		if (capture)
+			stats_line << "  capture: " << capture->Captured() << " frames, " << capture->CaptureTime() << " ms/frame";
+		stats_screen.Clear();
+		stats_screen.AddLine(stats_line.str());
+
+		PxU32 frames = PxMax(perf_frames, 1u);
+		perf_frames = 0;
+		PxReal frame_ms = perf_frame.Average(frames);
+		PxReal gpu_ms = Renderer::GpuFrameTime();
+
+		PxSimulationStatistics stats;
+		{
+			PhysicsEngine::SceneReadLock lock(*scene);
+			scene->Get()->getSimulationStatistics(stats);
+		}
+
+		//the graphs are scaled to the largest sample of their history
+		const HUDGraph* graphs[] = { &perf_frame, &perf_step, &perf_render, &perf_heap };
+		for (PxU32 i = 0; i < 4; i++)
+			perf_scale[i] = PxMax(graphs[i]->Max(), 0.01f);
+		if (gpu_ms >= 0.f)
+			perf_scale[2] = PxMax(perf_scale[2], perf_gpu.Max());
+
+		hud.Clear(PERF);
+		std::stringstream line;
+		line << std::fixed << std::setprecision(2);
+		line << " Performance" << (scene->Pause() ? " (simulation paused)" : "");
+		hud.AddLine(PERF, line.str()); line.str("");
+		line << "    fps: " << ((frame_ms > 0.f) ? 1000.f / frame_ms : 0.f) << "  frame: " << frame_ms << " ms";
+		hud.AddLine(PERF, line.str()); line.str("");
+		line << "    simulation: " << perf_step.Average(frames) << " ms per frame, steps at " << 1.f / delta_time << " Hz";
+		hud.AddLine(PERF, line.str()); line.str("");
+		line << "    render: " << perf_render.Average(frames) << " ms cpu, ";
+		if (gpu_ms >= 0.f)
+			line << perf_gpu.Average(frames) << " ms gpu";
+		else
+			line << "gpu n/a";
+		hud.AddLine(PERF, line.str()); line.str("");
+		line << "    actors: " << stats.nbActiveDynamicBodies << " awake / " << stats.nbDynamicBodies << " dynamic, " << stats.nbStaticBodies << " static";
+		hud.AddLine(PERF, line.str()); line.str("");
+		line << "    contact pairs: " << stats.nbDiscreteContactPairsTotal << "  broadphase pairs: +" << stats.nbNewPairs << " -" << stats.nbLostPairs;
+		hud.AddLine(PERF, line.str()); line.str("");
+		line << "    PhysX heap: " << PhysicsEngine::GetAllocatedBytes() / (1024.f*1024.f) << " MB (peak "
+			<< PhysicsEngine::GetPeakAllocatedBytes() / (1024.f*1024.f) << " MB)";
+		hud.AddLine(PERF, line.str()); line.str("");
+		hud.AddLine(PERF, "");
+
+		//labels of the graphs drawn by PerfRender, each one followed by the space of its graph
+		const char* labels[] = { "frame ms", "simulation ms per frame", "render ms, cpu black / gpu blue", "PhysX heap MB" };
+		line << " Last " << perf_frame.Capacity() << " frames";
+		hud.AddLine(PERF, line.str()); line.str("");
+		for (PxU32 i = 0; i < 4; i++)
+		{
+			line << "    " << labels[i] << " (max " << perf_scale[i] << ")";
+			hud.AddLine(PERF, line.str()); line.str("");
+			hud.AddLine(PERF, "");
+			hud.AddLine(PERF, "");
+			hud.AddLine(PERF, "");
+		}
+	}
+
+	//Draw the graphs of the performance screen below their labels
+	void PerfRender()
+	{
+		const HUDGraph* graphs[] = { &perf_frame, &perf_step, &perf_render, &perf_heap };
+		const PxVec3 colors[] = { PxVec3(.6f, 0.f, 0.f), PxVec3(0.f, .4f, 0.f), PxVec3(0.f, 0.f, 0.f), PxVec3(.4f, 0.f, .5f) };
+		for (PxU32 i = 0; i < 4; i++)
+		{
+			PxVec2 size(.3f, 2.5f*hud_font_size);
+			PxVec2 location(.02f, 1.f - (PERF_GRAPH_LINE + i*4 + 1.3f)*hud_font_size - size.y);
+			graphs[i]->Render(perf_scale[i], location, size, colors[i]);
+			if ((graphs[i] == &perf_render) && (Renderer::GpuFrameTime() >= 0.f))
+				perf_gpu.Render(perf_scale[i], location, size, PxVec3(0.f, 0.f, .8f), false);
+		}
 	}
 
 	//user defined keyboard handlers
@@ -179,7 +458,7 @@ namespace VisualDebugger
 		{
 			//implement your own
 		case 'R':
-			scene->ExampleKeyPressHandler();
+			scene->Submit(PhysicsEngine::Command(PhysicsEngine::Command::CUSTOM, PhysicsEngine::MyCommand::EXAMPLE_KEY_PRESS));
 			break;
 		default:
 			break;
@@ -192,7 +471,7 @@ namespace VisualDebugger
 		{
 			//implement your own
 		case 'R':
-			scene->ExampleKeyReleaseHandler();
+			scene->Submit(PhysicsEngine::Command(PhysicsEngine::Command::CUSTOM, PhysicsEngine::MyCommand::EXAMPLE_KEY_RELEASE));
 			break;
 		default:
 			break;
@@ -209,60 +488,61 @@ namespace VisualDebugger
 		switch (toupper(key))
 		{
 		case 'W':
-			camera->MoveForward(delta_time);
+			camera->MoveForward(frame_time);
 			break;
 		case 'S':
-			camera->MoveBackward(delta_time);
+			camera->MoveBackward(frame_time);
 			break;
 		case 'A':
-			camera->MoveLeft(delta_time);
+			camera->MoveLeft(frame_time);
 			break;
 		case 'D':
-			camera->MoveRight(delta_time);
+			camera->MoveRight(frame_time);
 			break;
 		case 'Q':
-			camera->MoveUp(delta_time);
+			camera->MoveUp(frame_time);
 			break;
 		case 'Z':
-			camera->MoveDown(delta_time);
+			camera->MoveDown(frame_time);
 			break;
 		default:
 			break;
 		}
 	}
 
-	//handle force control keys
+	//handle force control keys, the forces are applied to the selected actor by the simulation
 	void ForceInput(int key)
 	{
-		if (!scene->GetSelectedActor())
-			return;
-
+		PxVec3 direction(0.f);
 		switch (toupper(key))
 		{
 			// Force controls on the selected actor
 		case 'I': //forward
-			scene->GetSelectedActor()->addForce(PxVec3(0, 0, -1) * gForceStrength);
+			direction = PxVec3(0, 0, -1);
 			break;
 		case 'K': //backward
-			scene->GetSelectedActor()->addForce(PxVec3(0, 0, 1) * gForceStrength);
+			direction = PxVec3(0, 0, 1);
 			break;
 		case 'J': //left
-			scene->GetSelectedActor()->addForce(PxVec3(-1, 0, 0) * gForceStrength);
+			direction = PxVec3(-1, 0, 0);
 			break;
 		case 'L': //right
-			scene->GetSelectedActor()->addForce(PxVec3(1, 0, 0) * gForceStrength);
+			direction = PxVec3(1, 0, 0);
 			break;
 		case 'U': //up
-			scene->GetSelectedActor()->addForce(PxVec3(0, 1, 0) * gForceStrength);
+			direction = PxVec3(0, 1, 0);
 			break;
 		case 'M': //down
-			scene->GetSelectedActor()->addForce(PxVec3(0, -1, 0) * gForceStrength);
+			direction = PxVec3(0, -1, 0);
 			break;
 		default:
-			break;
+			return;
 		}
+
+		scene->Submit(PhysicsEngine::Command(PhysicsEngine::Command::FORCE, 0, PxVec3(0.f), direction * gForceStrength));
 	}
 
+#ifndef RENDERER_EGL
 	///handle special keys
 	void KeySpecial(int key, int x, int y)
 	{
@@ -272,27 +552,33 @@ namespace VisualDebugger
 			//display control
 		case GLUT_KEY_F1:
 			//turn on joint motor
-			scene->SwingJoint();
+			scene->Submit(PhysicsEngine::Command(PhysicsEngine::Command::CUSTOM, PhysicsEngine::MyCommand::SWING_JOINT));
 			break;
 		case GLUT_KEY_F2:
 			//spawn new ball
-			scene->Ball();
+			scene->Submit(PhysicsEngine::Command(PhysicsEngine::Command::CUSTOM, PhysicsEngine::MyCommand::SPAWN_BALL));
 			break;
 		case GLUT_KEY_F3:
 			//fire pitchfork
-			scene->Fork(camera->getEye(), camera->getDir());
+			scene->Submit(PhysicsEngine::Command(PhysicsEngine::Command::CUSTOM, PhysicsEngine::MyCommand::FIRE_FORK,
+				camera->getEye(), camera->getDir()));
 			break;
 		case GLUT_KEY_F4:
 			//turn plane into glass
-			scene->PlaneTranformation();
+			scene->Submit(PhysicsEngine::Command(PhysicsEngine::Command::CUSTOM, PhysicsEngine::MyCommand::GLASS_PLANE));
 			break;
 		case GLUT_KEY_F5:
-			//hud on/off
-			hud_show = !hud_show;
+			//cycle the hud: help, performance, off
+			if (hud_screen == HELP)
+				hud_screen = PERF;
+			else if (hud_screen == PERF)
+				hud_screen = EMPTY;
+			else
+				hud_screen = HELP;
 			break;
 		case GLUT_KEY_F6:
-			//shadows on/off
-			Renderer::ShowShadows(!Renderer::ShowShadows());
+			//cycle shadows: shadow map, blob, projected, off
+			ToggleShadows();
 			break;
 		case GLUT_KEY_F7:
 			//toggle render mode
@@ -306,20 +592,25 @@ namespace VisualDebugger
 			//simulation control
 		case GLUT_KEY_F9:
 			//select next actor
-			scene->SelectNextActor();
+			scene->Submit(PhysicsEngine::Command(PhysicsEngine::Command::SELECT_NEXT));
 			break;
 		case GLUT_KEY_F10:
 			//toggle scene pause
-			scene->Pause(!scene->Pause());
+			scene->Submit(PhysicsEngine::Command(PhysicsEngine::Command::PAUSE, -1));
+			break;
+		case GLUT_KEY_F11:
+			//start or stop writing the frames
+			ToggleCapture();
 			break;
 		case GLUT_KEY_F12:
 			//resect scene
-			scene->Reset();
+			scene->Submit(PhysicsEngine::Command(PhysicsEngine::Command::RESET));
 			break;
 		default:
 			break;
 		}
 	}
+#endif
 
 	//handle single key presses
 	void KeyPress(unsigned char key, int x, int y)
@@ -332,7 +623,12 @@ namespace VisualDebugger
 
 		//exit
 		if (key == 27)
+		{
+			//the capture needs the GL context to read the last frames
+			if (capture)
+				ToggleCapture();
 			exit(0);
+		}
 
 		UserKeyPress(key);
 	}
@@ -344,7 +640,7 @@ namespace VisualDebugger
 		UserKeyRelease(key);
 	}
 
-	//handle holded keys
+	//handle holded keys, once per frame
 	void KeyHold()
 	{
 		for (int i = 0; i < MAX_KEYS; i++)
@@ -352,12 +648,21 @@ namespace VisualDebugger
 			if (key_state[i]) // if key down
 			{
 				CameraInput(i);
-				ForceInput(i);
 				UserKeyHold(i);
 			}
 		}
 	}
 
+	//handle holded keys acting on the simulation, once per simulation step
+	void KeyHoldStep()
+	{
+		for (int i = 0; i < MAX_KEYS; i++)
+		{
+			if (key_state[i])
+				ForceInput(i);
+		}
+	}
+
 	///mouse handling
 	int mMouseX = 0;
 	int mMouseY = 0;
@@ -367,7 +672,8 @@ namespace VisualDebugger
 		int dx = mMouseX - x;
 		int dy = mMouseY - y;
 
-		camera->Motion(dx, dy, delta_time);
+		//the sensitivity does not depend on the frame or the simulation rate
+		camera->Motion(dx, dy, 1.f / 60.f);
 
 		mMouseX = x;
 		mMouseY = y;
@@ -387,11 +693,49 @@ namespace VisualDebugger
 			render_mode = BOTH;
 		else if (render_mode == BOTH)
 			render_mode = NORMAL;
+
+		//nothing to generate when the debug geometry is not shown
+		scene->Visualization(render_mode != NORMAL);
+	}
+
+	void ToggleShadows()
+	{
+		if (!Renderer::ShowShadows())
+		{
+			Renderer::ShowShadows(true);
+			Renderer::SetShadowType(Renderer::SHADOWS_MAP);
+		}
+		else if (Renderer::GetShadowType() == Renderer::SHADOWS_MAP)
+			Renderer::SetShadowType(Renderer::SHADOWS_BLOB);
+		else if (Renderer::GetShadowType() == Renderer::SHADOWS_BLOB)
+			Renderer::SetShadowType(Renderer::SHADOWS_PROJECTED);
+		else
+			Renderer::ShowShadows(false);
+	}
+
+	void ToggleCapture()
+	{
+		if (!capture)
+		{
+			std::stringstream prefix;
+			prefix << "capture" << capture_session++ << "_";
+			capture = new Renderer::FrameWriter(prefix.str(), Renderer::FRAMES_PPM, 16);
+			return;
+		}
+
+		capture->Close();
+		std::cout << "captured " << capture->Written() << " frames" << (capture->PixelBuffers() ? " through pixel buffers" : "")
+			<< ", " << capture->CaptureTime() << " ms/frame on the rendering thread" << std::endl;
+		if (capture->Failed())
+			std::cerr << "some frames could not be written" << std::endl;
+		delete capture;
+		capture = 0;
 	}
 
 	///exit callback
 	void exitCallback(void)
 	{
+		delete capture;
 		delete camera;
 		delete scene;
 		PhysicsEngine::PxRelease();
@@ -11,5 +11,18 @@ namespace VisualDebugger
 
 	///Start visualisation
 	void Start();
+
+	///Set the number of fixed simulation steps per second (60 by default), the window still draws at the display rate
+	void SimulationRate(PxReal steps_per_second);
+
+	///Build the scene from a scene file instead of the built-in layout, call before Init or InitOffscreen
+	void LayoutFile(const std::string& filename);
+
+	///Init visualisation without a window, rendering into an offscreen surface (needs a build with RENDERER_EGL)
+	void InitOffscreen(int width, int height);
+
+	///Simulate and render frames without a window, every stride-th simulation step is rendered and written
+	///to numbered files starting with path. Prints the frames per second of the rendering and of the writer.
+	void Record(PxU32 frames, PxU32 stride, const std::string& path, bool raw=false);
 }
 